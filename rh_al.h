@@ -26,10 +26,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "rh_realloc.h"
+#include "rh_stat.h"
+
 #define RH_AL_MAKE(NAME, TYPE)					 		\
 	RH_AL_DEF(NAME, TYPE);							\
 	RH_AL_IMPL(NAME, TYPE);
 
+#define RH_AL_MAKE_ALLOC(NAME, TYPE, REALLOC, FREE)				\
+	RH_AL_DEF(NAME, TYPE);							\
+	RH_AL_IMPL_ALLOC(NAME, TYPE, REALLOC, FREE);
+
 // Useful iteration macro
 #define rh_al_for(iter, al)							\
 if (al.items)									\
@@ -51,16 +58,23 @@ typedef struct {								\
 } NAME;										\
 
 #define RH_AL_IMPL(NAME, TYPE)							\
+	RH_AL_IMPL_ALLOC(NAME, TYPE, RH_REALLOC, RH_FREE)
+
+#define RH_AL_IMPL_ALLOC(NAME, TYPE, REALLOC, FREE)				\
+RH_STAT_DEF(NAME, 0)								\
+										\
 static inline size_t NAME##_resize(NAME *al, size_t to) {			\
 	if (!to || al->top > to) {						\
 		return 0;							\
 	}									\
 										\
-	TYPE *new = realloc(al->items, to * sizeof(TYPE));			\
+	TYPE *new = REALLOC(al->items, al->size * sizeof(TYPE)			\
+			, to * sizeof(TYPE));					\
 	if (!new) {								\
 		return 0;							\
 	}									\
 										\
+	RH_STAT_RESIZE(NAME, al->size * sizeof(TYPE), to * sizeof(TYPE));	\
 	al->items = new;							\
 	al->size = to;								\
 										\
@@ -68,7 +82,8 @@ static inline size_t NAME##_resize(NAME *al, size_t to) {			\
 }										\
 										\
 static inline void NAME##_free(NAME *al) {					\
-	free(al->items);							\
+	RH_STAT_FREE(NAME, al->size * sizeof(TYPE), al->top * sizeof(TYPE));	\
+	FREE(al->items, al->size * sizeof(TYPE));				\
 }										\
 										\
 static inline NAME NAME##_new(size_t size) {					\
@@ -86,6 +101,7 @@ static inline NAME NAME##_clone(NAME *al) {					\
 	NAME ret = {0};								\
 	NAME##_resize(&ret, al->size);						\
 	ret.top = al->top;							\
+	RH_STAT_USE(NAME, ret.top * sizeof(TYPE));				\
 	memcpy(ret.items, al->items, al->top * sizeof(*al->items));		\
 	return ret;								\
 }										\
@@ -104,6 +120,7 @@ static inline int NAME##_push(NAME *al, TYPE push) {				\
 	}									\
 										\
 	al->items[al->top++] = push;						\
+	RH_STAT_USE(NAME, sizeof(TYPE));					\
 	return 1;								\
 }										\
 										\
@@ -112,6 +129,7 @@ static inline TYPE NAME##_pop(NAME *al) {					\
 		return (TYPE) {0};						\
 	}									\
 										\
+	RH_STAT_UNUSE(NAME, sizeof(TYPE));					\
 	return al->items[--al->top];						\
 }										\
 										\
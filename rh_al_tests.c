@@ -21,9 +21,12 @@
 *******************************************************************************/
 
 #include "rh_al.h"
+#include "rh_short_al.h"
 #include <stdio.h>
 
 RH_AL_MAKE(test_al, const char *);
+RH_SMALL_VEC_MAKE(test_vec, int, 4);
+RH_SHORT_AL_MAKE(test_short, char);
 
 void print_al(test_al *al) {
 	puts("Array List Stats:");
@@ -41,6 +44,7 @@ void print_al(test_al *al) {
 
 #define DEBUG_PRINT(HASH) print_h(&HASH);
 #define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__); print_al(&al)
+#define VEC_ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
 
 int push(void) {
 	test_al al = test_al_new(2);
@@ -79,6 +83,121 @@ int push_zero(void) {
 	return 0;
 }
 
+int vec_spill(void) {
+	test_vec vec = {0};
+	for (int i = 0;i < 4;++i) {
+		test_vec_push(&vec, i);
+	}
+	if (vec.size > 4 || test_vec_items(&vec) != vec.short_items) {
+		VEC_ERROR_MSG("Small vec inline test FAILED!");
+		return 1;
+	}
+
+	test_vec_push(&vec, 4);
+	int errors = vec.size != 8 || test_vec_items(&vec) == vec.short_items;
+	for (int i = 0;i < 5;++i) {
+		errors += test_vec_view(&vec, i) != i;
+	}
+	test_vec_free(&vec);
+	if (errors) {
+		VEC_ERROR_MSG("Small vec spill test FAILED!");
+		return 1;
+	}
+
+	return 0;
+}
+
+int vec_shrink(void) {
+	test_vec vec = test_vec_new(16);
+	for (int i = 0;i < 6;++i) {
+		test_vec_push(&vec, i);
+	}
+	test_vec_pop(&vec);
+	test_vec_pop(&vec);
+	test_vec_pop(&vec);
+	// Popping leaves the items on the heap, resizing moves them back
+	int errors = vec.size != 16;
+	errors += test_vec_resize(&vec, 2) != 0;
+	errors += test_vec_resize(&vec, 3) != 4;
+	errors += vec.size != 4 || test_vec_items(&vec) != vec.short_items;
+	for (int i = 0;i < 3;++i) {
+		errors += test_vec_view(&vec, i) != i;
+	}
+	test_vec_free(&vec);
+	if (errors) {
+		VEC_ERROR_MSG("Small vec shrink test FAILED!");
+		return 1;
+	}
+
+	return 0;
+}
+
+int vec_clone(void) {
+	test_vec vec = {0};
+	test_vec_push(&vec, 1);
+	test_vec_push(&vec, 2);
+	test_vec inline_copy = test_vec_clone(&vec);
+	for (int i = 3;i < 10;++i) {
+		test_vec_push(&vec, i);
+	}
+	test_vec copy = test_vec_clone(&vec);
+	// The heap copy is its own
+	*test_vec_peek(&copy) = 0;
+
+	int errors = inline_copy.top != 2 || test_vec_view(&inline_copy, 1) != 2;
+	errors += copy.top != 9 || copy.items == vec.items;
+	errors += test_vec_view(&vec, 8) != 9 || test_vec_pick(&copy, 1) != 8;
+	test_vec_free(&inline_copy);
+	test_vec_free(&copy);
+	test_vec_free(&vec);
+	if (errors) {
+		VEC_ERROR_MSG("Small vec clone test FAILED!");
+		return 1;
+	}
+
+	return 0;
+}
+
+int vec_for(void) {
+	int errors = 0;
+	for (int n = 3;n <= 6;n += 3) {
+		test_vec vec = {0};
+		for (int i = 1;i <= n;++i) {
+			test_vec_push(&vec, i);
+		}
+		rh_small_vec_ref_for(int *item, vec) {
+			*item *= 2;
+		}
+		int sum = 0;
+		rh_small_vec_for(int item, vec) {
+			sum += item;
+		}
+		errors += sum != n * (n + 1);
+		test_vec_free(&vec);
+	}
+
+	// Short array lists hold as many chars inline as their heap pointer and
+	// size take up
+	test_short str = {0};
+	const char *text = "short array lists";
+	for (const char *c = text;*c;++c) {
+		test_short_push(&str, *c);
+	}
+	size_t i = 0;
+	rh_short_al_for(char c, str) {
+		errors += c != text[i++];
+	}
+	errors += RH_SMALL_VEC_N(str) != sizeof(size_t) + sizeof(char *);
+	errors += i != strlen(text);
+	test_short_free(&str);
+	if (errors) {
+		VEC_ERROR_MSG("Small vec for test FAILED!");
+		return 1;
+	}
+
+	return 0;
+}
+
 int main() {
 	int no_errors = 0;
 
@@ -87,6 +206,12 @@ int main() {
 	no_errors += push_resize();
 	no_errors += push_zero();
 
+	// Small vec tests
+	no_errors += vec_spill();
+	no_errors += vec_shrink();
+	no_errors += vec_clone();
+	no_errors += vec_for();
+
 	if (no_errors) {
 		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
 	}
@@ -0,0 +1,233 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_ALLOC_H
+#define RH_ALLOC_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "rh_pool.h"
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+// General purpose allocator built from size classes of pooled objects
+// Requests up to RH_ALLOC_MAX bytes are rounded up to one of RH_ALLOC_CLASSES
+// sizes, four per doubling, and taken from that class's free list or carved
+// from its current chunk; larger requests are mapped directly
+// Chunks are mapped aligned to RH_ALLOC_CHUNK with a header naming their
+// class, so rh_alloc_free finds it by masking the pointer
+// Not thread safe; chunks are only returned to the system by
+// rh_alloc_heap_free, which also frees everything still allocated except
+// large allocations
+// Without MAP_ANONYMOUS, as in strict C modes, chunks and large allocations
+// come from aligned_alloc, rounded up to whole chunks
+
+#define RH_ALLOC_CHUNK ((size_t) 1 << 18)
+#define RH_ALLOC_MAX ((size_t) 1 << 15)
+#define RH_ALLOC_CLASSES 41
+// Objects start this far into a chunk
+#define RH_ALLOC_HEADER 64
+
+typedef struct rh_alloc_class {
+	size_t size;
+	rh_mem_link *free;
+
+	// Unused end of the newest chunk
+	unsigned char *bump;
+	unsigned char *end;
+} rh_alloc_class;
+
+// Chunks are kept in a list of slabs, their size being the bytes mapped
+typedef struct {
+	rh_slab slab;
+	// NULL for a large allocation
+	rh_alloc_class *class;
+} rh_alloc_chunk;
+
+typedef struct {
+	rh_alloc_class classes[RH_ALLOC_CLASSES];
+	rh_slab *chunks;
+} rh_alloc_heap;
+
+// 8, then multiples of 16 to 128, then four steps per power of two
+static inline size_t rh_alloc_class_of(size_t size) {
+	if (size <= 8) {
+		return 0;
+	}
+	if (size <= 128) {
+		return (size + 15) >> 4;
+	}
+
+	size_t p = 63 - __builtin_clzll(size - 1);
+	return 9 + (p - 7) * 4 + ((size - 1 - ((size_t) 1 << p)) >> (p - 2));
+}
+
+static inline size_t rh_alloc_class_size(size_t class) {
+	if (!class) {
+		return 8;
+	}
+	if (class <= 8) {
+		return class << 4;
+	}
+
+	size_t p = 7 + (class - 9) / 4;
+	return ((size_t) 1 << p) + (((class - 9) % 4 + 1) << (p - 2));
+}
+
+static inline void rh_alloc_init(rh_alloc_heap *h) {
+	for (size_t i = 0;i < RH_ALLOC_CLASSES;++i) {
+		h->classes[i] = (rh_alloc_class) {rh_alloc_class_size(i), NULL, NULL, NULL};
+	}
+	h->chunks = NULL;
+}
+
+// Maps size bytes aligned to RH_ALLOC_CHUNK, by trimming a larger mapping
+static inline rh_alloc_chunk *rh_alloc_map(size_t size) {
+#ifdef MAP_ANONYMOUS
+	size_t over = size + RH_ALLOC_CHUNK;
+	unsigned char *map = mmap(NULL, over, PROT_READ | PROT_WRITE
+			, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		return NULL;
+	}
+
+	unsigned char *start = (unsigned char *) (((uintptr_t) map + RH_ALLOC_CHUNK - 1)
+			& ~(uintptr_t) (RH_ALLOC_CHUNK - 1));
+	if (start != map) {
+		munmap(map, start - map);
+	}
+	munmap(start + size, map + over - (start + size));
+#else
+	size = (size + RH_ALLOC_CHUNK - 1) & ~(RH_ALLOC_CHUNK - 1);
+	unsigned char *start = aligned_alloc(RH_ALLOC_CHUNK, size);
+	if (!start) {
+		return NULL;
+	}
+#endif
+
+	rh_alloc_chunk *chunk = (rh_alloc_chunk *) start;
+	chunk->slab.size = size;
+	return chunk;
+}
+
+static inline void rh_alloc_unmap(rh_slab *chunk) {
+#ifdef MAP_ANONYMOUS
+	munmap(chunk, chunk->size);
+#else
+	free(chunk);
+#endif
+}
+
+static inline void *rh_alloc(rh_alloc_heap *h, size_t size) {
+	if (size > RH_ALLOC_MAX) {
+		size_t bytes = (size + RH_ALLOC_HEADER + 4095) & ~(size_t) 4095;
+		rh_alloc_chunk *chunk = rh_alloc_map(bytes);
+		if (!chunk) {
+			return NULL;
+		}
+		chunk->class = NULL;
+		return (unsigned char *) chunk + RH_ALLOC_HEADER;
+	}
+
+	rh_alloc_class *c = &h->classes[rh_alloc_class_of(size)];
+	if (c->free) {
+		rh_mem_link *mem = c->free;
+		c->free = mem->link;
+		return mem;
+	}
+
+	if (c->bump + c->size > c->end) {
+		rh_alloc_chunk *chunk = rh_alloc_map(RH_ALLOC_CHUNK);
+		if (!chunk) {
+			return NULL;
+		}
+		chunk->class = c;
+		chunk->slab.link = h->chunks;
+		h->chunks = &chunk->slab;
+
+		c->bump = (unsigned char *) chunk + RH_ALLOC_HEADER;
+		c->end = (unsigned char *) chunk + RH_ALLOC_CHUNK;
+	}
+
+	void *ret = c->bump;
+	c->bump += c->size;
+	return ret;
+}
+
+static inline rh_alloc_chunk *rh_alloc_chunk_of(void *ptr) {
+	return (rh_alloc_chunk *) ((uintptr_t) ptr & ~(uintptr_t) (RH_ALLOC_CHUNK - 1));
+}
+
+// Bytes usable at ptr, which may be more than were asked for
+static inline size_t rh_alloc_usable(void *ptr) {
+	rh_alloc_chunk *chunk = rh_alloc_chunk_of(ptr);
+	return chunk->class ? chunk->class->size
+		: chunk->slab.size - RH_ALLOC_HEADER;
+}
+
+static inline void rh_alloc_free(void *ptr) {
+	if (!ptr) {
+		return;
+	}
+
+	rh_alloc_chunk *chunk = rh_alloc_chunk_of(ptr);
+	if (!chunk->class) {
+		rh_alloc_unmap(&chunk->slab);
+		return;
+	}
+	rh_pool_free_sized(&chunk->class->free, ptr, chunk->class->size);
+}
+
+static inline void *rh_alloc_realloc(rh_alloc_heap *h, void *ptr, size_t size) {
+	if (!ptr) {
+		return rh_alloc(h, size);
+	}
+
+	size_t usable = rh_alloc_usable(ptr);
+	if (size <= usable && size > usable / 2) {
+		return ptr;
+	}
+
+	void *new = rh_alloc(h, size);
+	if (!new) {
+		return NULL;
+	}
+	memcpy(new, ptr, size < usable ? size : usable);
+	rh_alloc_free(ptr);
+	return new;
+}
+
+static inline void rh_alloc_heap_free(rh_alloc_heap *h) {
+	while (h->chunks) {
+		rh_slab *chunk = h->chunks;
+		h->chunks = chunk->link;
+		rh_alloc_unmap(chunk);
+	}
+	rh_alloc_init(h);
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_alloc.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define OPS (1 << 23)
+#define LIVE (1 << 16)
+#define PHASE (1 << 20)
+
+static rh_alloc_heap heap;
+
+static void *bench_alloc(int use_heap, size_t size) {
+	void *p = use_heap ? rh_alloc(&heap, size) : malloc(size);
+	// Touch the memory, as a real program would
+	memset(p, 0, size < 64 ? size : 64);
+	return p;
+}
+
+static void bench_free(int use_heap, void *p) {
+	if (use_heap) {
+		rh_alloc_free(p);
+	} else {
+		free(p);
+	}
+}
+
+// Mostly small sizes with a tail up to max
+static size_t trace_size(uint64_t *seed, size_t max) {
+	uint64_t r = rh_bench_rand(seed);
+	switch (r % 100) {
+	case 0:
+		return 1 + (r >> 8) % max;
+	case 1 ... 25:
+		return 128 + (r >> 8) % 1920;
+	default:
+		return 8 + (r >> 8) % 120;
+	}
+}
+
+// A window of LIVE objects, each step replacing a random one
+static uint64_t churn(int use_heap, size_t max) {
+	void **live = calloc(LIVE, sizeof(*live));
+	uint64_t seed = 13;
+
+	uint64_t start = rh_bench_now();
+	for (size_t i = 0;i < OPS;++i) {
+		size_t j = rh_bench_rand(&seed) % LIVE;
+		bench_free(use_heap, live[j]);
+		live[j] = bench_alloc(use_heap, trace_size(&seed, max));
+	}
+	for (size_t i = 0;i < LIVE;++i) {
+		bench_free(use_heap, live[i]);
+	}
+	uint64_t end = rh_bench_now();
+
+	free(live);
+	return end - start;
+}
+
+// Build up and tear down PHASE objects, each phase with different sizes
+static uint64_t phases(int use_heap, size_t max) {
+	(void) max;
+	void **live = malloc(PHASE * sizeof(*live));
+	uint64_t seed = 14;
+
+	uint64_t start = rh_bench_now();
+	for (size_t phase = 0;phase < OPS / PHASE;++phase) {
+		size_t base = 16 << (phase % 4);
+		for (size_t i = 0;i < PHASE;++i) {
+			live[i] = bench_alloc(use_heap, base + rh_bench_rand(&seed) % base);
+		}
+		for (size_t i = 0;i < PHASE;++i) {
+			bench_free(use_heap, live[i]);
+		}
+	}
+	uint64_t end = rh_bench_now();
+
+	free(live);
+	return end - start;
+}
+
+// Runs a trace in a child process so its peak RSS can be measured alone
+static void run(const char *name, uint64_t trace(int, size_t), int use_heap, size_t max) {
+	fflush(stdout);
+	if (!fork()) {
+		rh_alloc_init(&heap);
+		uint64_t ns = trace(use_heap, max);
+
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		char label[64];
+		snprintf(label, sizeof(label), "%s %s", use_heap ? "rh_alloc" : "malloc", name);
+		rh_bench_report(label, OPS, ns);
+		printf("%-40s %12ld KiB peak RSS\n", label, usage.ru_maxrss);
+
+		rh_alloc_heap_free(&heap);
+		exit(0);
+	}
+	wait(NULL);
+}
+
+int main() {
+	for (int use_heap = 1;use_heap >= 0;--use_heap) {
+		run("churn to 32 KiB", churn, use_heap, RH_ALLOC_MAX);
+		run("churn to 1 MiB", churn, use_heap, 1 << 20);
+		run("phases", phases, use_heap, 0);
+	}
+	return 0;
+}
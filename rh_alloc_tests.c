@@ -0,0 +1,183 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_alloc.h"
+#include <stdio.h>
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+int classes(void) {
+	// Every size maps to the smallest class holding it
+	for (size_t s = 0;s <= RH_ALLOC_MAX;++s) {
+		size_t c = rh_alloc_class_of(s);
+		if (c >= RH_ALLOC_CLASSES || rh_alloc_class_size(c) < s
+		|| (c && rh_alloc_class_size(c - 1) >= s)) {
+			ERROR_MSG("Class of test FAILED! %zu in %zu", s, c);
+			return 1;
+		}
+	}
+
+	// And every class size maps back to its class
+	for (size_t c = 0;c < RH_ALLOC_CLASSES;++c) {
+		size_t size = rh_alloc_class_size(c);
+		if (rh_alloc_class_of(size) != c
+		|| (c && size <= rh_alloc_class_size(c - 1))) {
+			ERROR_MSG("Class size test FAILED! class %zu", c);
+			return 1;
+		}
+	}
+	if (rh_alloc_class_size(RH_ALLOC_CLASSES - 1) != RH_ALLOC_MAX) {
+		ERROR_MSG("Class max test FAILED!");
+		return 1;
+	}
+	return 0;
+}
+
+static void fill(unsigned char *mem, size_t size, unsigned char seed) {
+	for (size_t i = 0;i < size;++i) {
+		mem[i] = seed + i * 7;
+	}
+}
+
+static int check(unsigned char *mem, size_t size, unsigned char seed) {
+	for (size_t i = 0;i < size;++i) {
+		if (mem[i] != (unsigned char) (seed + i * 7)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int alloc_free(void) {
+	rh_alloc_heap h;
+	rh_alloc_init(&h);
+	int errors = 0;
+
+	size_t sizes[] = {1, 8, 9, 100, 129, 1000, 4097, RH_ALLOC_MAX
+		, RH_ALLOC_MAX + 1, 100000, RH_ALLOC_CHUNK * 3};
+	const size_t no_sizes = sizeof(sizes) / sizeof(sizes[0]);
+	unsigned char *mem[sizeof(sizes) / sizeof(sizes[0])];
+	for (size_t i = 0;i < no_sizes;++i) {
+		mem[i] = rh_alloc(&h, sizes[i]);
+		errors += !mem[i] || rh_alloc_usable(mem[i]) < sizes[i];
+		errors += sizes[i] > 8 && (uintptr_t) mem[i] % 16;
+		fill(mem[i], sizes[i], i);
+	}
+	for (size_t i = 0;i < no_sizes;++i) {
+		errors += !check(mem[i], sizes[i], i);
+	}
+
+	// Small objects are reused newest first from their class, large ones
+	// are unmapped
+	for (size_t i = 0;i < no_sizes;++i) {
+		rh_alloc_free(mem[i]);
+	}
+	rh_alloc_free(NULL);
+	for (size_t i = no_sizes;i--;) {
+		if (sizes[i] <= RH_ALLOC_MAX) {
+			errors += rh_alloc(&h, sizes[i]) != mem[i];
+		}
+	}
+
+	// Enough of one class to span several chunks, all distinct
+	size_t many = 3 * RH_ALLOC_CHUNK / 64;
+	unsigned char **all = malloc(many * sizeof(*all));
+	for (size_t i = 0;i < many;++i) {
+		all[i] = rh_alloc(&h, 64);
+		fill(all[i], 64, i);
+	}
+	for (size_t i = 0;i < many;++i) {
+		errors += !check(all[i], 64, i);
+	}
+	for (size_t i = 0;i < many;++i) {
+		rh_alloc_free(all[i]);
+	}
+	free(all);
+
+	rh_alloc_heap_free(&h);
+	errors += h.chunks != NULL;
+	if (errors) {
+		ERROR_MSG("Alloc free test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+int realloc_boundary(void) {
+	rh_alloc_heap h;
+	rh_alloc_init(&h);
+	int errors = 0;
+
+	// Growing from small to large and back keeps the common prefix
+	size_t steps[] = {5, 24, 300, RH_ALLOC_MAX - 1, RH_ALLOC_MAX
+		, RH_ALLOC_MAX + 1, RH_ALLOC_MAX * 4, RH_ALLOC_MAX + 1
+		, RH_ALLOC_MAX, 1000, 16};
+	unsigned char *mem = NULL;
+	size_t size = 0;
+	for (size_t i = 0;i < sizeof(steps) / sizeof(steps[0]);++i) {
+		mem = rh_alloc_realloc(&h, mem, steps[i]);
+		size_t kept = size < steps[i] ? size : steps[i];
+		errors += !mem || !check(mem, kept, 3);
+		errors += rh_alloc_usable(mem) < steps[i];
+		size = steps[i];
+		fill(mem, size, 3);
+	}
+
+	// Within a class realloc stays put, shrinking past half of it moves
+	unsigned char *a = rh_alloc_realloc(&h, NULL, 1000);
+	fill(a, 1000, 9);
+	errors += rh_alloc_realloc(&h, a, 1024) != a;
+	unsigned char *b = rh_alloc_realloc(&h, a, 100);
+	errors += b == a || !check(b, 100, 9);
+	// The old object went back to its class
+	errors += rh_alloc(&h, 1000) != a;
+
+	// Large to large shrinks too, and large to small frees the mapping
+	unsigned char *c = rh_alloc_realloc(&h, NULL, RH_ALLOC_MAX * 8);
+	fill(c, RH_ALLOC_MAX * 8, 5);
+	c = rh_alloc_realloc(&h, c, RH_ALLOC_MAX * 2);
+	errors += !check(c, RH_ALLOC_MAX * 2, 5);
+	c = rh_alloc_realloc(&h, c, 64);
+	errors += !check(c, 64, 5) || rh_alloc_usable(c) != 64;
+
+	rh_alloc_free(mem);
+	rh_alloc_heap_free(&h);
+	if (errors) {
+		ERROR_MSG("Realloc boundary test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += classes();
+	no_errors += alloc_free();
+	no_errors += realloc_boundary();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
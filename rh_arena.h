@@ -0,0 +1,164 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_ARENA_H
+#define RH_ARENA_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Bump allocator for memory which all dies together
+// Allocations are carved from the current chunk, starting a new chunk when
+// it runs out; nothing is freed individually, only by rewinding to a mark or
+// resetting, except that freeing or resizing the latest allocation is done in
+// place, so a growing array list needs no copies
+// Generators taking REALLOC(ptr, old, new) and FREE(ptr, size) can use an
+// arena through rh_arena_realloc and rh_arena_release
+
+#define RH_ARENA_CHUNK (1 << 16)
+#define RH_ARENA_ALIGN _Alignof(max_align_t)
+
+typedef struct rh_arena_chunk {
+	struct rh_arena_chunk *prev;
+	size_t size;
+	_Alignas(max_align_t) unsigned char data[];
+} rh_arena_chunk;
+
+typedef struct {
+	// Newest chunk, which allocations are taken from
+	rh_arena_chunk *chunk;
+	size_t used;
+	size_t chunk_size;
+
+	// Latest allocation, which can be resized in place
+	unsigned char *last;
+} rh_arena;
+
+typedef struct {
+	rh_arena_chunk *chunk;
+	size_t used;
+} rh_arena_mark;
+
+static inline rh_arena rh_arena_new(size_t chunk_size) {
+	return (rh_arena) {.chunk_size = chunk_size ?: RH_ARENA_CHUNK};
+}
+
+// Frees every chunk
+static inline void rh_arena_free(rh_arena *a) {
+	while (a->chunk) {
+		rh_arena_chunk *prev = a->chunk->prev;
+		free(a->chunk);
+		a->chunk = prev;
+	}
+	*a = rh_arena_new(a->chunk_size);
+}
+
+// Align must be a power of two
+static inline void *rh_arena_alloc_aligned(rh_arena *a, size_t size, size_t align) {
+	size_t at = 0;
+	if (a->chunk) {
+		uintptr_t base = (uintptr_t) a->chunk->data;
+		at = ((base + a->used + align - 1) & ~(uintptr_t) (align - 1)) - base;
+	}
+
+	if (!a->chunk || at + size > a->chunk->size) {
+		// Larger allocations get a chunk of their own
+		size_t need = size + (align > RH_ARENA_ALIGN ? align : 0);
+		size_t to = need > a->chunk_size ? need : a->chunk_size;
+		rh_arena_chunk *chunk = malloc(sizeof(*chunk) + to);
+		if (!chunk) {
+			return NULL;
+		}
+		chunk->prev = a->chunk;
+		chunk->size = to;
+		a->chunk = chunk;
+
+		uintptr_t base = (uintptr_t) chunk->data;
+		at = ((base + align - 1) & ~(uintptr_t) (align - 1)) - base;
+	}
+
+	a->used = at + size;
+	a->last = a->chunk->data + at;
+	return a->last;
+}
+
+static inline void *rh_arena_alloc(rh_arena *a, size_t size) {
+	return rh_arena_alloc_aligned(a, size, RH_ARENA_ALIGN);
+}
+
+// Extends or shrinks the latest allocation in place, otherwise copies
+static inline void *rh_arena_realloc(rh_arena *a, void *ptr, size_t old, size_t size) {
+	if (ptr && ptr == a->last) {
+		size_t at = a->last - a->chunk->data;
+		if (at + size <= a->chunk->size) {
+			a->used = at + size;
+			return ptr;
+		}
+	} else if (ptr && size <= old) {
+		return ptr;
+	}
+
+	void *new = rh_arena_alloc(a, size);
+	if (new && ptr) {
+		memcpy(new, ptr, old < size ? old : size);
+	}
+	return new;
+}
+
+// Only the latest allocation is actually released
+static inline void rh_arena_release(rh_arena *a, void *ptr, size_t size) {
+	(void) size;
+	if (ptr && ptr == a->last) {
+		a->used = a->last - a->chunk->data;
+		a->last = NULL;
+	}
+}
+
+static inline rh_arena_mark rh_arena_get_mark(rh_arena *a) {
+	return (rh_arena_mark) {a->chunk, a->used};
+}
+
+// Frees everything allocated since the mark was taken
+static inline void rh_arena_rewind(rh_arena *a, rh_arena_mark mark) {
+	while (a->chunk != mark.chunk) {
+		rh_arena_chunk *prev = a->chunk->prev;
+		if (!prev && !mark.chunk) {
+			// Keep the first chunk for reuse
+			a->used = 0;
+			a->last = NULL;
+			return;
+		}
+		free(a->chunk);
+		a->chunk = prev;
+	}
+	a->used = mark.used;
+	a->last = NULL;
+}
+
+// Frees everything, keeping the first chunk for reuse
+static inline void rh_arena_reset(rh_arena *a) {
+	rh_arena_rewind(a, (rh_arena_mark) {0});
+}
+
+#endif
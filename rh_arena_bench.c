@@ -0,0 +1,146 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_arena.h"
+#include "rh_al.h"
+#include "rh_hash.h"
+#include "rh_deq.h"
+#include "rh_heap.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+// Each request's containers are allocated from this arena, which is reset
+// once the request is done
+static rh_arena request;
+
+#define ARENA_REALLOC(PTR, OLD, NEW) rh_arena_realloc(&request, PTR, OLD, NEW)
+#define ARENA_FREE(PTR, SIZE) rh_arena_release(&request, PTR, SIZE)
+
+static inline uint64_t hash_u64(uint64_t key) {
+	key *= 0x9E3779B97F4A7C15LU;
+	return (key ^ key >> 32) ?: 1;
+}
+
+#define EQ_U64(A, B) ((A) == (B))
+#define CMP_U64(A, B) (((A) > (B)) - ((A) < (B)))
+
+RH_AL_MAKE(malloc_al, uint64_t);
+RH_HASH_MAKE(malloc_map, uint64_t, uint64_t, hash_u64, EQ_U64, 0.9);
+RH_DEQ_MAKE(malloc_deq, uint64_t);
+RH_HEAP_MAKE(malloc_heap, uint64_t, CMP_U64);
+
+RH_AL_MAKE_ALLOC(arena_al, uint64_t, ARENA_REALLOC, ARENA_FREE);
+RH_HASH_MAKE_ALLOC(arena_map, uint64_t, uint64_t, hash_u64, EQ_U64, 0.9
+		, ARENA_REALLOC, ARENA_FREE);
+RH_DEQ_MAKE_ALLOC(arena_deq, uint64_t, ARENA_REALLOC, ARENA_FREE);
+RH_HEAP_MAKE_ALLOC(arena_heap, uint64_t, CMP_U64, ARENA_REALLOC, ARENA_FREE);
+
+#define REQUESTS (1 << 14)
+#define LISTS 32
+
+// A request tokenizes into a few small lists, counts tokens in a map, and
+// queues and orders some of them
+#define BENCH_REQUEST(PREFIX, DONE)						\
+static uint64_t PREFIX##_request(uint64_t *seed) {				\
+	PREFIX##_al lists[LISTS] = {0};						\
+	PREFIX##_map counts = {0};						\
+	PREFIX##_deq queue = {0};						\
+	PREFIX##_heap order = {0};						\
+	uint64_t sum = 0;							\
+										\
+	for (size_t i = 0;i < LISTS;++i) {					\
+		size_t n = rh_bench_rand(seed) % 64;				\
+		for (size_t j = 0;j < n;++j) {					\
+			uint64_t token = rh_bench_rand(seed) % 512;		\
+			PREFIX##_al_push(&lists[i], token);			\
+			PREFIX##_map_bucket *b = PREFIX##_map_find(&counts, token);\
+			if (b) {						\
+				++b->value;					\
+			} else {						\
+				PREFIX##_map_set(&counts, token, 1);		\
+			}							\
+			if (token & 1) {					\
+				PREFIX##_deq_push(&queue, token);		\
+			} else {						\
+				PREFIX##_heap_ins(&order, token);		\
+			}							\
+		}								\
+	}									\
+	while (!PREFIX##_deq_empty(&queue)) {					\
+		sum += PREFIX##_deq_pop(&queue);				\
+	}									\
+	while (order.top) {							\
+		sum += PREFIX##_heap_rem(&order);				\
+	}									\
+	sum += counts.no_items;							\
+										\
+	DONE									\
+	return sum;								\
+}										\
+										\
+static void bench_##PREFIX(void) {						\
+	uint64_t seed = 10;							\
+	uint64_t sum = 0;							\
+	uint64_t start = rh_bench_now();					\
+	for (size_t i = 0;i < REQUESTS;++i) {					\
+		sum += PREFIX##_request(&seed);					\
+	}									\
+	uint64_t end = rh_bench_now();						\
+	rh_bench_use(sum);							\
+	rh_bench_report(#PREFIX " request", REQUESTS, end - start);		\
+}
+
+BENCH_REQUEST(malloc, {
+	for (size_t i = 0;i < LISTS;++i) {
+		malloc_al_free(&lists[i]);
+	}
+	malloc_map_free(&counts);
+	malloc_deq_free(&queue);
+	malloc_heap_free(&order);
+})
+
+BENCH_REQUEST(arena, {
+	rh_arena_reset(&request);
+})
+
+int main() {
+	request = rh_arena_new(RH_ARENA_CHUNK);
+
+	bench_malloc();
+	bench_arena();
+
+	// Marks nest, e.g. for scratch space inside a request
+	uint64_t start = rh_bench_now();
+	for (size_t i = 0;i < REQUESTS * 64;++i) {
+		rh_arena_mark mark = rh_arena_get_mark(&request);
+		uint64_t *scratch = rh_arena_alloc(&request, 256 * sizeof(*scratch));
+		scratch[i % 256] = i;
+		rh_bench_use(scratch[i % 256]);
+		rh_arena_rewind(&request, mark);
+	}
+	rh_bench_report("arena mark+alloc+rewind", REQUESTS * 64
+			, rh_bench_now() - start);
+
+	rh_arena_free(&request);
+	return 0;
+}
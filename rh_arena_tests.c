@@ -0,0 +1,120 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_arena.h"
+#include <stdio.h>
+
+static rh_arena arena;
+
+#define ARENA_REALLOC(PTR, OLD, NEW) rh_arena_realloc(&arena, PTR, OLD, NEW)
+#define ARENA_FREE(PTR, SIZE) rh_arena_release(&arena, PTR, SIZE)
+
+#include "rh_al.h"
+
+RH_AL_MAKE_ALLOC(test_al, int, ARENA_REALLOC, ARENA_FREE);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+int aligned(void) {
+	arena = rh_arena_new(256);
+	char *a = rh_arena_alloc_aligned(&arena, 1, 1);
+	char *b = rh_arena_alloc_aligned(&arena, 8, 64);
+	char *c = rh_arena_alloc(&arena, 1000);
+	if (!a || (uintptr_t) b % 64 || (uintptr_t) c % RH_ARENA_ALIGN
+	|| !arena.chunk->prev) {
+		ERROR_MSG("Aligned test FAILED!");
+		return 1;
+	}
+
+	rh_arena_free(&arena);
+	return 0;
+}
+
+int realloc_in_place(void) {
+	arena = rh_arena_new(1024);
+	int *a = rh_arena_alloc(&arena, 4 * sizeof(int));
+	a[3] = 3;
+	int *b = rh_arena_realloc(&arena, a, 4 * sizeof(int), 64 * sizeof(int));
+	int *c = rh_arena_alloc(&arena, sizeof(int));
+	int *d = rh_arena_realloc(&arena, b, 64 * sizeof(int), 128 * sizeof(int));
+	if (a != b || d == b || d[3] != 3 || c != b + 64) {
+		ERROR_MSG("Realloc in place test FAILED!");
+		return 1;
+	}
+
+	rh_arena_free(&arena);
+	return 0;
+}
+
+int mark_rewind(void) {
+	arena = rh_arena_new(128);
+	void *a = rh_arena_alloc(&arena, 16);
+	rh_arena_mark mark = rh_arena_get_mark(&arena);
+	void *b = rh_arena_alloc(&arena, 16);
+	for (size_t i = 0;i < 64;++i) {
+		rh_arena_alloc(&arena, 100);
+	}
+	rh_arena_rewind(&arena, mark);
+	void *c = rh_arena_alloc(&arena, 16);
+	rh_arena_reset(&arena);
+	void *d = rh_arena_alloc(&arena, 16);
+	if (b != c || a != d || arena.chunk->prev) {
+		ERROR_MSG("Mark rewind test FAILED!");
+		return 1;
+	}
+
+	rh_arena_free(&arena);
+	return 0;
+}
+
+int container(void) {
+	arena = rh_arena_new(0);
+	test_al al = {0};
+	for (int i = 0;i < 1000;++i) {
+		test_al_push(&al, i);
+	}
+	int *first = al.items;
+	test_al_free(&al);
+	int *again = rh_arena_alloc(&arena, sizeof(int));
+	if (first != again || arena.chunk->prev) {
+		ERROR_MSG("Container test FAILED!");
+		return 1;
+	}
+
+	rh_arena_free(&arena);
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += aligned();
+	no_errors += realloc_in_place();
+	no_errors += mark_rewind();
+	no_errors += container();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -0,0 +1,298 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_BENCH_H
+#define RH_BENCH_H
+
+// Small helpers shared by the *_bench.c programs
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+// Defining RH_BENCH_PERF reads hardware counters through perf_event_open,
+// which needs perf_event_paranoid to allow it; counters that cannot be opened
+// are left out of the results
+#if defined(RH_BENCH_PERF) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static inline uint64_t rh_bench_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// xorshift64*, good enough for generating workloads
+static inline uint64_t rh_bench_rand(uint64_t *state) {
+	uint64_t x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 2685821657736338717LU;
+}
+
+// Stops the compiler from discarding benchmarked work
+static inline void rh_bench_use(uint64_t value) {
+	__asm__ volatile("" : : "r"(value) : "memory");
+}
+
+static inline void rh_bench_report(const char *name, uint64_t ops, uint64_t ns) {
+	printf("%-40s %12lu ops %10.2f ns/op\n", name, ops, (double) ns / (ops?:1));
+}
+
+// A uniform double in [0, 1)
+static inline double rh_bench_unit(uint64_t *state) {
+	return (rh_bench_rand(state) >> 11) * 0x1p-53;
+}
+
+// Zipfian ranks in [0, n), rank r drawn with weight 1 / (r + 1)^theta for
+// theta in (0, 1), by Gray et al's method as YCSB uses, which is exact for
+// the first two ranks and approximates the rest
+// Rank 0 is the most popular, so callers scramble ranks to scatter hot keys
+typedef struct {
+	uint64_t n;
+	double theta, alpha, zetan, eta, half;
+} rh_bench_zipf;
+
+// Sums exactly up to 2^20 terms, then by the midpoint integral of the rest,
+// which is within 1e-12 of the sum
+static inline double rh_bench_zeta(uint64_t n, double theta) {
+	uint64_t exact = n < (1 << 20) ? n : (1 << 20);
+	double sum = 0;
+	for (uint64_t i = exact;i;--i) {
+		sum += pow(i, -theta);
+	}
+	if (n > exact) {
+		sum += (pow(n + 0.5, 1 - theta) - pow(exact + 0.5, 1 - theta))
+			/ (1 - theta);
+	}
+	return sum;
+}
+
+static inline rh_bench_zipf rh_bench_zipf_new(uint64_t n, double theta) {
+	rh_bench_zipf z = {
+		.n = n,
+		.theta = theta,
+		.alpha = 1 / (1 - theta),
+		.zetan = rh_bench_zeta(n, theta),
+		.half = 1 + pow(0.5, theta),
+	};
+	z.eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - rh_bench_zeta(2, theta)
+			/ z.zetan);
+	return z;
+}
+
+static inline uint64_t rh_bench_zipf_next(const rh_bench_zipf *z
+		, uint64_t *state) {
+	double u = rh_bench_unit(state);
+	double uz = u * z->zetan;
+	if (uz < 1) {
+		return 0;
+	}
+	if (uz < z->half) {
+		return 1;
+	}
+	uint64_t r = z->n * pow(z->eta * u - z->eta + 1, z->alpha);
+	return r < z->n ? r : z->n - 1;
+}
+
+// Per op latencies, each sample the mean over a batch of ops, as reading
+// the clock costs more than most single ops take
+typedef struct {
+	size_t count, size;
+	double *ns;
+} rh_bench_lat;
+
+static inline rh_bench_lat rh_bench_lat_new(size_t size) {
+	rh_bench_lat lat = {0, size, malloc(size * sizeof(double))};
+	if (!lat.ns) {
+		lat.size = 0;
+	}
+	return lat;
+}
+
+static inline void rh_bench_lat_free(rh_bench_lat *lat) {
+	free(lat->ns);
+	*lat = (rh_bench_lat) {0};
+}
+
+static inline void rh_bench_lat_add(rh_bench_lat *lat, uint64_t ns
+		, uint64_t ops) {
+	if (lat->count < lat->size) {
+		lat->ns[lat->count++] = (double) ns / (ops?:1);
+	}
+}
+
+static inline int rh_bench_cmp_double(const void *a, const void *b) {
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+static inline void rh_bench_lat_sort(rh_bench_lat *lat) {
+	qsort(lat->ns, lat->count, sizeof(double), rh_bench_cmp_double);
+}
+
+static inline double rh_bench_lat_mean(const rh_bench_lat *lat) {
+	double sum = 0;
+	for (size_t i = 0;i < lat->count;++i) {
+		sum += lat->ns[i];
+	}
+	return lat->count ? sum / lat->count : 0;
+}
+
+// p in [0, 1], by the nearest rank; the samples must have been sorted
+static inline double rh_bench_lat_pct(const rh_bench_lat *lat, double p) {
+	if (!lat->count) {
+		return 0;
+	}
+	size_t i = p * lat->count;
+	return lat->ns[i < lat->count ? i : lat->count - 1];
+}
+
+// Hardware counters over a region, opened once and read per region
+#define RH_BENCH_PERF_NO 4
+
+static const char *const rh_bench_perf_names[RH_BENCH_PERF_NO] = {
+	"cycles", "instructions", "cache_misses", "branch_misses",
+};
+
+typedef struct {
+	int fd[RH_BENCH_PERF_NO];
+	uint64_t value[RH_BENCH_PERF_NO];
+} rh_bench_perf;
+
+#if defined(RH_BENCH_PERF) && defined(__linux__)
+static inline rh_bench_perf rh_bench_perf_open(void) {
+	static const uint64_t config[RH_BENCH_PERF_NO] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+	};
+	rh_bench_perf perf = {0};
+	for (int i = 0;i < RH_BENCH_PERF_NO;++i) {
+		struct perf_event_attr attr = {
+			.type = PERF_TYPE_HARDWARE,
+			.size = sizeof(attr),
+			.config = config[i],
+			.disabled = 1,
+			.exclude_kernel = 1,
+			.exclude_hv = 1,
+		};
+		perf.fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+	return perf;
+}
+
+static inline void rh_bench_perf_close(rh_bench_perf *perf) {
+	for (int i = 0;i < RH_BENCH_PERF_NO;++i) {
+		if (perf->fd[i] >= 0) {
+			close(perf->fd[i]);
+		}
+		perf->fd[i] = -1;
+	}
+}
+
+static inline void rh_bench_perf_start(rh_bench_perf *perf) {
+	for (int i = 0;i < RH_BENCH_PERF_NO;++i) {
+		if (perf->fd[i] >= 0) {
+			ioctl(perf->fd[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(perf->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+static inline void rh_bench_perf_stop(rh_bench_perf *perf) {
+	for (int i = 0;i < RH_BENCH_PERF_NO;++i) {
+		if (perf->fd[i] >= 0) {
+			ioctl(perf->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+			if (read(perf->fd[i], &perf->value[i], sizeof(uint64_t))
+					!= sizeof(uint64_t)) {
+				perf->value[i] = 0;
+			}
+		}
+	}
+}
+#else
+static inline rh_bench_perf rh_bench_perf_open(void) {
+	rh_bench_perf perf = {0};
+	for (int i = 0;i < RH_BENCH_PERF_NO;++i) {
+		perf.fd[i] = -1;
+	}
+	return perf;
+}
+
+static inline void rh_bench_perf_close(rh_bench_perf *perf) {
+	(void) perf;
+}
+
+static inline void rh_bench_perf_start(rh_bench_perf *perf) {
+	(void) perf;
+}
+
+static inline void rh_bench_perf_stop(rh_bench_perf *perf) {
+	(void) perf;
+}
+#endif
+
+// One line per result, of tab separated key=value pairs so runs can be
+// diffed or loaded by other tools; counters are per op
+// Given latency samples, ns_op is their mean and the percentiles and max
+// their spread, so all come from the same batches; a few slow batches (page
+// faults, interrupts) can pull the mean above even p999, which max shows
+// Sorts the samples
+static inline void rh_bench_record(FILE *out, const char *name
+		, const char *dist, size_t size, uint64_t ops, uint64_t ns
+		, rh_bench_lat *lat, const rh_bench_perf *perf) {
+	int samples = lat && lat->count;
+	double ns_op = (double) ns / (ops?:1);
+	if (samples) {
+		rh_bench_lat_sort(lat);
+		ns_op = rh_bench_lat_mean(lat);
+	}
+
+	fprintf(out, "bench=%s\tdist=%s\tsize=%zu\tops=%lu\tns_op=%.3f", name
+			, dist, size, ops, ns_op);
+	if (samples) {
+		fprintf(out, "\tp50=%.3f\tp90=%.3f\tp99=%.3f\tp999=%.3f"
+				"\tmax=%.3f"
+				, rh_bench_lat_pct(lat, 0.5)
+				, rh_bench_lat_pct(lat, 0.9)
+				, rh_bench_lat_pct(lat, 0.99)
+				, rh_bench_lat_pct(lat, 0.999)
+				, lat->ns[lat->count - 1]);
+	}
+	for (int i = 0;perf && i < RH_BENCH_PERF_NO;++i) {
+		if (perf->fd[i] >= 0) {
+			fprintf(out, "\t%s=%.3f", rh_bench_perf_names[i]
+					, (double) perf->value[i] / (ops?:1));
+		}
+	}
+	fprintf(out, "\n");
+}
+
+#endif
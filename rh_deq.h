@@ -26,17 +26,27 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "rh_realloc.h"
+#include "rh_stat.h"
+
 #define RH_DEQ_MAKE(NAME, TYPE)					 		\
 	RH_DEQ_DEF(NAME, TYPE);							\
 	RH_DEQ_IMPL(NAME, TYPE);
 
-// Useful iteration macro
+#define RH_DEQ_MAKE_ALLOC(NAME, TYPE, REALLOC, FREE)				\
+	RH_DEQ_DEF(NAME, TYPE);							\
+	RH_DEQ_IMPL_ALLOC(NAME, TYPE, REALLOC, FREE);
+
+// Useful iteration macro, from the rpop end to the pop end
 #define rh_deq_for(iter, deq)							\
 if (deq.items)									\
-	for (size_t _i = deq.end;						\
-		iter = deq.items[_i], _i != deq.start;				\
-		_i = (_i - 1) % deq.size)	 				\
+	for (size_t _i = deq.end, _j = 0;					\
+		_i != deq.start;						\
+		_i = (_i + 1) & (deq.size - 1), _j = 0)				\
+		for (iter = deq.items[_i]; !_j; _j = 1)
 
+// Size is always a power of two so indices wrap with a mask
+// Items are held in [end, start), so one slot is always left empty
 #define RH_DEQ_DEF(NAME, TYPE) 							\
 typedef struct {								\
 	size_t size;								\
@@ -44,40 +54,110 @@ typedef struct {								\
 										\
 	TYPE *items;								\
 } NAME;										\
+										\
+typedef struct {								\
+	TYPE *items;								\
+	size_t len;								\
+} NAME##_span;									\
 
 #define RH_DEQ_IMPL(NAME, TYPE)							\
+	RH_DEQ_IMPL_ALLOC(NAME, TYPE, RH_REALLOC, RH_FREE)
+
+#define RH_DEQ_IMPL_ALLOC(NAME, TYPE, REALLOC, FREE)				\
+RH_STAT_DEF(NAME, 0)								\
+										\
+static inline size_t NAME##_count(NAME *deq) {					\
+	return deq->size ? (deq->start - deq->end) & (deq->size - 1) : 0;	\
+}										\
+										\
+/* Sets a and b to the contiguous runs of items, oldest (rpop end) first */	\
+/* Returns the number of non empty spans */					\
+static inline int NAME##_spans(NAME *deq, NAME##_span *a, NAME##_span *b) {	\
+	*a = *b = (NAME##_span) {0};						\
+	if (!deq->size || deq->start == deq->end) {				\
+		return 0;							\
+	}									\
+										\
+	if (deq->end < deq->start) {						\
+		*a = (NAME##_span) {&deq->items[deq->end], deq->start - deq->end};\
+		return 1;							\
+	}									\
+										\
+	*a = (NAME##_span) {&deq->items[deq->end], deq->size - deq->end};	\
+	*b = (NAME##_span) {deq->items, deq->start};				\
+	return deq->start ? 2 : 1;						\
+}										\
+										\
+/* Rounds up to a power of two, and must leave room for the items held */	\
 static inline size_t NAME##_resize(NAME *deq, size_t to) {			\
-	if (!to || (deq->size && (deq->start - deq->end) % deq->size > to)) {	\
+	size_t count = NAME##_count(deq);					\
+	if (!to || count >= to) {						\
 		return 0;							\
 	}									\
 										\
-	TYPE *new = realloc(deq->items, to * sizeof(TYPE));			\
+	size_t size = 2;							\
+	while (size < to) {							\
+		size <<= 1;							\
+	}									\
+	if (size == deq->size) {						\
+		return deq->size;						\
+	}									\
+										\
+	if (size < deq->size) {							\
+		/* Shrinking may cut off wrapped items, so copy them out */	\
+		TYPE *new = REALLOC(NULL, 0, size * sizeof(TYPE));		\
+		if (!new) {							\
+			return 0;						\
+		}								\
+		NAME##_span a, b;						\
+		NAME##_spans(deq, &a, &b);					\
+		memcpy(new, a.items, a.len * sizeof(TYPE));			\
+		if (b.len) {							\
+			memcpy(new + a.len, b.items, b.len * sizeof(TYPE));	\
+		}								\
+		FREE(deq->items, deq->size * sizeof(TYPE));			\
+		RH_STAT_RESIZE(NAME, deq->size * sizeof(TYPE)			\
+				, size * sizeof(TYPE));				\
+										\
+		deq->items = new;						\
+		deq->size = size;						\
+		deq->end = 0;							\
+		deq->start = count;						\
+		return deq->size;						\
+	}									\
+										\
+	TYPE *new = REALLOC(deq->items, deq->size * sizeof(TYPE)		\
+			, size * sizeof(TYPE));					\
 	if (!new) {								\
 		return 0;							\
 	}									\
 										\
 	if (deq->start < deq->end) {						\
 		size_t end_size = deq->size - deq->end;				\
-		memmove(&new[to - end_size],					\
+		memmove(&new[size - end_size],					\
 			&new[deq->end],						\
 			end_size * sizeof(TYPE));				\
-		deq->end = to - end_size;					\
+		deq->end = size - end_size;					\
 	}									\
 										\
+	RH_STAT_RESIZE(NAME, deq->size * sizeof(TYPE), size * sizeof(TYPE));	\
 	deq->items = new;							\
-	deq->size = to;								\
+	deq->size = size;							\
 										\
 	return deq->size;							\
 }										\
 										\
 static inline void NAME##_free(NAME *deq) {					\
-	free(deq->items);							\
+	RH_STAT_FREE(NAME, deq->size * sizeof(TYPE)				\
+			, NAME##_count(deq) * sizeof(TYPE));			\
+	FREE(deq->items, deq->size * sizeof(TYPE));				\
 }										\
 										\
 static inline NAME NAME##_new(size_t size) {					\
 	NAME ret = {0};								\
-	NAME##_resize(&ret, size);						\
-	memset(ret.items, 0, size);						\
+	if (NAME##_resize(&ret, size)) {					\
+		memset(ret.items, 0, ret.size * sizeof(TYPE));			\
+	}									\
 	return ret;								\
 }										\
 										\
@@ -89,6 +169,9 @@ static inline NAME NAME##_clone(NAME *deq) {					\
 	NAME ret = {0};								\
 	NAME##_resize(&ret, deq->size);						\
 	memcpy(ret.items, deq->items, deq->size * sizeof(TYPE));		\
+	ret.start = deq->start;							\
+	ret.end = deq->end;							\
+	RH_STAT_USE(NAME, NAME##_count(&ret) * sizeof(TYPE));			\
 	return ret;								\
 }										\
 										\
@@ -96,24 +179,25 @@ static inline TYPE *NAME##_peek(NAME *deq) {					\
 	if (deq->start == deq->end) {						\
 		return NULL;							\
 	}									\
-	return &deq->items[deq->end -1];					\
+	return &deq->items[(deq->start - 1) & (deq->size - 1)];			\
 }										\
 										\
 static inline TYPE *NAME##_rpeek(NAME *deq) {					\
 	if (deq->start == deq->end) {						\
 		return NULL;							\
 	}									\
-	return &deq->items[(deq->start - 1) % deq->size];			\
+	return &deq->items[deq->end];						\
 }										\
 										\
 static inline int NAME##_push(NAME *deq, TYPE push) {				\
-	if ((!deq->size || (deq->start + 1) % deq->size == deq->end)		\
+	if ((!deq->size || ((deq->start + 1) & (deq->size - 1)) == deq->end)	\
 	&& !NAME##_resize(deq, (deq->size?:8) * 2)) {				\
 		return 0;							\
 	}									\
 										\
 	deq->items[deq->start] = push;						\
-	deq->start = (deq->start + 1) % deq->size;				\
+	deq->start = (deq->start + 1) & (deq->size - 1);			\
+	RH_STAT_USE(NAME, sizeof(TYPE));					\
 	return 1;								\
 }										\
 										\
@@ -122,18 +206,20 @@ static inline TYPE NAME##_pop(NAME *deq) {					\
 		return (TYPE) {0};						\
 	}									\
 										\
-	deq->start = (deq->start - 1) % deq->size;				\
+	deq->start = (deq->start - 1) & (deq->size - 1);			\
+	RH_STAT_UNUSE(NAME, sizeof(TYPE));					\
 	return deq->items[deq->start];						\
 }										\
 										\
 static inline int NAME##_rpush(NAME *deq, TYPE push) {				\
-	if ((!deq->size || (deq->end - 1) % deq->size == deq->start)		\
+	if ((!deq->size || ((deq->end - 1) & (deq->size - 1)) == deq->start)	\
 	&& !NAME##_resize(deq, (deq->size?:8) * 2)) {				\
 		return 0;							\
 	}									\
 										\
-	deq->end = (deq->end - 1) % deq->size;					\
+	deq->end = (deq->end - 1) & (deq->size - 1);				\
 	deq->items[deq->end] = push;						\
+	RH_STAT_USE(NAME, sizeof(TYPE));					\
 	return 1;								\
 }										\
 										\
@@ -143,16 +229,71 @@ static inline TYPE NAME##_rpop(NAME *deq) {					\
 	}									\
 										\
 	TYPE pop = deq->items[deq->end];					\
-	deq->end = (deq->end + 1) % deq->size;					\
+	deq->end = (deq->end + 1) & (deq->size - 1);				\
+	RH_STAT_UNUSE(NAME, sizeof(TYPE));					\
 	return pop;								\
 }										\
 										\
+/* Pushes n items in order, as n calls to push would */				\
+static inline int NAME##_push_n(NAME *deq, const TYPE *push, size_t n) {	\
+	size_t count = NAME##_count(deq);					\
+	if (count + n >= deq->size && !NAME##_resize(deq, count + n + 1)) {	\
+		return 0;							\
+	}									\
+										\
+	size_t first = deq->size - deq->start;					\
+	first = first < n ? first : n;						\
+	memcpy(&deq->items[deq->start], push, first * sizeof(TYPE));		\
+	memcpy(deq->items, push + first, (n - first) * sizeof(TYPE));		\
+	deq->start = (deq->start + n) & (deq->size - 1);			\
+	RH_STAT_USE(NAME, n * sizeof(TYPE));					\
+	return 1;								\
+}										\
+										\
+/* Removes up to n items from the pop end, writing them oldest first so */	\
+/* that push_n then pop_n round trips; returns the number removed */		\
+static inline size_t NAME##_pop_n(NAME *deq, TYPE *pop, size_t n) {		\
+	size_t count = NAME##_count(deq);					\
+	n = n < count ? n : count;						\
+	if (!n) {								\
+		return 0;							\
+	}									\
+										\
+	size_t from = (deq->start - n) & (deq->size - 1);			\
+	size_t first = deq->size - from;					\
+	first = first < n ? first : n;						\
+	memcpy(pop, &deq->items[from], first * sizeof(TYPE));			\
+	memcpy(pop + first, deq->items, (n - first) * sizeof(TYPE));		\
+	deq->start = from;							\
+	RH_STAT_UNUSE(NAME, n * sizeof(TYPE));					\
+	return n;								\
+}										\
+										\
+/* Removes up to n items from the rpop end, in rpop order */			\
+/* Returns the number removed */						\
+static inline size_t NAME##_rpop_n(NAME *deq, TYPE *pop, size_t n) {		\
+	size_t count = NAME##_count(deq);					\
+	n = n < count ? n : count;						\
+	if (!n) {								\
+		return 0;							\
+	}									\
+										\
+	size_t first = deq->size - deq->end;					\
+	first = first < n ? first : n;						\
+	memcpy(pop, &deq->items[deq->end], first * sizeof(TYPE));		\
+	memcpy(pop + first, deq->items, (n - first) * sizeof(TYPE));		\
+	deq->end = (deq->end + n) & (deq->size - 1);				\
+	RH_STAT_UNUSE(NAME, n * sizeof(TYPE));					\
+	return n;								\
+}										\
+										\
+/* Position 0 is the oldest item, at the rpop end */				\
 static inline TYPE NAME##_view(NAME *deq, size_t pos) {				\
-	if (!deq->size || pos >= (deq->start - deq->end) % deq->size) {		\
+	if (pos >= NAME##_count(deq)) {						\
 		return (TYPE) {0};						\
 	}									\
 										\
-	return deq->items[(deq->start + pos) % deq->size];			\
+	return deq->items[(deq->end + pos) & (deq->size - 1)];			\
 }										\
 										\
 static inline int NAME##_empty(NAME *deq) {					\
@@ -0,0 +1,160 @@
+/*******************************************************************************
+* Copyright 2017 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_deq.h"
+#include <stdio.h>
+
+RH_DEQ_MAKE(test_deq, int);
+
+void print_deq(test_deq *deq) {
+	puts("Deque Stats:");
+	fprintf(stderr, "Size: %lu, Start: %lu, End: %lu, Allocted block: %s\n"
+			, deq->size, deq->start, deq->end, deq->items?"True":"False");
+
+	if (!deq->items) {
+		return;
+	}
+	puts("Deque items:");
+	for (size_t i = 0;i < deq->size;++i) {
+		fprintf(stderr, "value:%d\n", deq->items[i]);
+	}
+}
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__); print_deq(&deq)
+
+int push_pop(void) {
+	test_deq deq = {0};
+	test_deq_push(&deq, 1);
+	test_deq_push(&deq, 2);
+	if (*test_deq_peek(&deq) != 2 || test_deq_pop(&deq) != 2
+	|| test_deq_pop(&deq) != 1 || !test_deq_empty(&deq)) {
+		ERROR_MSG("Push pop test FAILED!");
+		return 1;
+	}
+
+	test_deq_free(&deq);
+	return 0;
+}
+
+int rpush_wrap(void) {
+	test_deq deq = test_deq_new(4);
+	test_deq_rpush(&deq, 1);
+	test_deq_rpush(&deq, 2);
+	if (deq.end != deq.size - 2 || *test_deq_rpeek(&deq) != 2
+	|| test_deq_pop(&deq) != 1 || test_deq_rpop(&deq) != 2) {
+		ERROR_MSG("Rpush wrap test FAILED!");
+		return 1;
+	}
+
+	test_deq_free(&deq);
+	return 0;
+}
+
+int resize_wrapped(void) {
+	test_deq deq = test_deq_new(4);
+	test_deq_rpush(&deq, 1);
+	test_deq_push(&deq, 2);
+	test_deq_push(&deq, 3);
+	test_deq_push(&deq, 4);
+	if (deq.size != 8 || test_deq_count(&deq) != 4
+	|| test_deq_view(&deq, 0) != 1 || test_deq_view(&deq, 3) != 4) {
+		ERROR_MSG("Resize wrapped test FAILED!");
+		return 1;
+	}
+
+	test_deq_free(&deq);
+	return 0;
+}
+
+int shrink_wrapped(void) {
+	test_deq deq = test_deq_new(16);
+	test_deq_rpush(&deq, 1);
+	test_deq_push(&deq, 2);
+	if (!test_deq_resize(&deq, 4) || deq.size != 4
+	|| test_deq_rpop(&deq) != 1 || test_deq_rpop(&deq) != 2) {
+		ERROR_MSG("Shrink wrapped test FAILED!");
+		return 1;
+	}
+
+	test_deq_free(&deq);
+	return 0;
+}
+
+int push_n_pop_n(void) {
+	test_deq deq = test_deq_new(8);
+	int in[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+	int out[16] = {0};
+	/* Start part way round so the copy wraps */
+	deq.start = deq.end = 6;
+	test_deq_push_n(&deq, in, 5);
+	test_deq_pop_n(&deq, out, 2);
+	if (test_deq_count(&deq) != 3 || out[0] != 3 || out[1] != 4) {
+		ERROR_MSG("Push_n pop_n test FAILED!");
+		return 1;
+	}
+
+	test_deq_push_n(&deq, in, 10);
+	if (test_deq_rpop_n(&deq, out, 16) != 13 || out[0] != 0 || out[2] != 2
+	|| out[3] != 0 || out[12] != 9 || !test_deq_empty(&deq)) {
+		ERROR_MSG("Push_n rpop_n test FAILED!");
+		return 1;
+	}
+
+	test_deq_free(&deq);
+	return 0;
+}
+
+int spans(void) {
+	test_deq deq = test_deq_new(8);
+	test_deq_span a, b;
+	deq.start = deq.end = 6;
+	for (int i = 0;i < 4;++i) {
+		test_deq_push(&deq, i);
+	}
+	if (test_deq_spans(&deq, &a, &b) != 2 || a.len != 2 || b.len != 2
+	|| a.items[0] != 0 || b.items[1] != 3) {
+		ERROR_MSG("Spans test FAILED!");
+		return 1;
+	}
+
+	test_deq_free(&deq);
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += push_pop();
+	no_errors += rpush_wrap();
+	no_errors += resize_wrapped();
+	no_errors += shrink_wrapped();
+
+	// Bulk tests
+	no_errors += push_n_pop_n();
+	no_errors += spans();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -0,0 +1,268 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_DMAT_H
+#define RH_DMAT_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rh_simd.h"
+
+// Defining RH_DMAT_TASKS splits mul across the workers of the running
+// rh_task pool; outside a pool, or without it, mul runs on the calling thread
+#ifdef RH_DMAT_TASKS
+#include "rh_task.h"
+#endif
+
+// Dynamically sized dense matrices, row major, with each row starting on an
+// RH_DMAT_ALIGN byte boundary
+// Views share the storage of the matrix they were taken from, so only
+// matrices from _new are freed, and only once no view of them is used
+#define RH_DMAT_ALIGN 64
+
+// Blocking for mul, sized so a packed KC by NR strip of b stays in L1 and a
+// packed MC by KC block of a in L2, with the KC by NC panel of b in L3
+// MC must be a multiple of RH_SIMD_GEMM_MR
+#ifndef RH_DMAT_KC
+#define RH_DMAT_KC 256
+#endif
+#ifndef RH_DMAT_MC
+#define RH_DMAT_MC 64
+#endif
+#ifndef RH_DMAT_NC
+#define RH_DMAT_NC 2048
+#endif
+
+#define RH_DMAT_MAKE(TYPE)							\
+	RH_DMAT_DEF(TYPE);							\
+	RH_DMAT_IMPL(TYPE);
+
+#define RH_DMAT_DEF(TYPE)							\
+typedef struct {								\
+	size_t rows, cols;							\
+	/* Items from the start of one row to the next */			\
+	size_t stride;								\
+	TYPE *data;								\
+} dm##TYPE;
+
+// Blocks run one at a time on each worker, so mul needs one packing panel
+// of a per worker, taken by the id of the worker running the block
+#ifdef RH_DMAT_TASKS
+#define RH_DMAT_FOR(BEGIN, END, FN, ARG)					\
+	rh_task_parallel_for(BEGIN, END, 1, FN, ARG)
+#define RH_DMAT_WORKERS() (rh_task_self ? rh_task_self->pool->no_workers : 1)
+#define RH_DMAT_WORKER() (rh_task_self ? rh_task_self->id : 0)
+#else
+#define RH_DMAT_FOR(BEGIN, END, FN, ARG) FN(ARG, BEGIN, END)
+#define RH_DMAT_WORKERS() 1
+#define RH_DMAT_WORKER() 0
+#endif
+
+#define RH_DMAT_IMPL(TYPE)							\
+RH_SIMD_GEMM_SCALAR(TYPE, _##TYPE)						\
+										\
+static inline dm##TYPE dm##TYPE##_new(size_t rows, size_t cols) {		\
+	if (!rows || !cols) {							\
+		return (dm##TYPE) {0};						\
+	}									\
+										\
+	size_t per = RH_DMAT_ALIGN / sizeof(TYPE) ?: 1;				\
+	size_t stride = (cols + per - 1) / per * per;				\
+	size_t bytes = rows * stride * sizeof(TYPE);				\
+	bytes = (bytes + RH_DMAT_ALIGN - 1) & ~(size_t) (RH_DMAT_ALIGN - 1);	\
+	TYPE *data = aligned_alloc(RH_DMAT_ALIGN, bytes);			\
+	if (!data) {								\
+		return (dm##TYPE) {0};						\
+	}									\
+	memset(data, 0, bytes);							\
+	return (dm##TYPE) {rows, cols, stride, data};				\
+}										\
+										\
+static inline void dm##TYPE##_free(dm##TYPE *m) {				\
+	free(m->data);								\
+	*m = (dm##TYPE) {0};							\
+}										\
+										\
+static inline TYPE *dm##TYPE##_at(const dm##TYPE *m, size_t row, size_t col) {	\
+	return &m->data[row * m->stride + col];					\
+}										\
+										\
+/* The rows by cols block from row, col, sharing m's storage */			\
+static inline dm##TYPE dm##TYPE##_view(const dm##TYPE *m, size_t row		\
+		, size_t col, size_t rows, size_t cols) {			\
+	if (!rows || !cols || row > m->rows || rows > m->rows - row		\
+	|| col > m->cols || cols > m->cols - col) {				\
+		return (dm##TYPE) {0};						\
+	}									\
+	return (dm##TYPE) {rows, cols, m->stride, dm##TYPE##_at(m, row, col)};	\
+}										\
+										\
+static inline void dm##TYPE##_fill(dm##TYPE *m, TYPE value) {			\
+	for (size_t y = 0;y < m->rows;++y) {					\
+		TYPE *row = dm##TYPE##_at(m, y, 0);				\
+		for (size_t x = 0;x < m->cols;++x) {				\
+			row[x] = value;						\
+		}								\
+	}									\
+}										\
+										\
+static inline int dm##TYPE##_copy(dm##TYPE *c, const dm##TYPE *a) {		\
+	if (c->rows != a->rows || c->cols != a->cols) {				\
+		return 0;							\
+	}									\
+	for (size_t y = 0;y < a->rows;++y) {					\
+		memmove(dm##TYPE##_at(c, y, 0), dm##TYPE##_at(a, y, 0)		\
+				, a->cols * sizeof(TYPE));			\
+	}									\
+	return 1;								\
+}										\
+										\
+/* c, which must not overlap a, is a->cols by a->rows */			\
+/* Done in square tiles so both sides stay in cache */				\
+static inline int dm##TYPE##_transpose(dm##TYPE *c, const dm##TYPE *a) {	\
+	if (c->rows != a->cols || c->cols != a->rows) {				\
+		return 0;							\
+	}									\
+	const size_t tile = RH_DMAT_ALIGN / sizeof(TYPE) ?: 1;			\
+	for (size_t y0 = 0;y0 < a->rows;y0 += tile) {				\
+	for (size_t x0 = 0;x0 < a->cols;x0 += tile) {				\
+		size_t y1 = y0 + tile < a->rows ? y0 + tile : a->rows;		\
+		size_t x1 = x0 + tile < a->cols ? x0 + tile : a->cols;		\
+		for (size_t x = x0;x < x1;++x) {				\
+			TYPE *out = dm##TYPE##_at(c, x, 0);			\
+			for (size_t y = y0;y < y1;++y) {			\
+				out[y] = *dm##TYPE##_at(a, y, x);		\
+			}							\
+		}								\
+	}									\
+	}									\
+	return 1;								\
+}										\
+										\
+/* Strips of MR rows of a, MR values per column, zero padded at the end */	\
+static inline void dm##TYPE##_pack_a(TYPE *ap, const dm##TYPE *a		\
+		, size_t row, size_t rows, size_t col, size_t cols) {		\
+	for (size_t i0 = 0;i0 < rows;i0 += RH_SIMD_GEMM_MR) {			\
+		for (size_t p = 0;p < cols;++p) {				\
+			for (size_t i = i0;i < i0 + RH_SIMD_GEMM_MR;++i) {	\
+				*ap++ = i < rows				\
+					? *dm##TYPE##_at(a, row + i, col + p)	\
+					: 0;					\
+			}							\
+		}								\
+	}									\
+}										\
+										\
+/* Strips of NR columns of b, NR values per row, zero padded at the end */	\
+static inline void dm##TYPE##_pack_b(TYPE *bp, const dm##TYPE *b		\
+		, size_t row, size_t rows, size_t col, size_t cols) {		\
+	const size_t nr = RH_SIMD_GEMM_NR(TYPE);				\
+	for (size_t j0 = 0;j0 < cols;j0 += nr) {				\
+		size_t n = cols - j0 < nr ? cols - j0 : nr;			\
+		for (size_t p = 0;p < rows;++p) {				\
+			const TYPE *from = dm##TYPE##_at(b, row + p, col + j0);	\
+			for (size_t j = 0;j < nr;++j) {				\
+				*bp++ = j < n ? from[j] : 0;			\
+			}							\
+		}								\
+	}									\
+}										\
+										\
+typedef struct {								\
+	dm##TYPE *c;								\
+	const dm##TYPE *a;							\
+	const TYPE *bp;								\
+	/* MC by KC of packing space per worker */				\
+	TYPE *ap;								\
+	size_t kc, pc, nc, jc;							\
+} dm##TYPE##_mul_job;								\
+										\
+/* Adds the blocks [begin, end) of MC rows of a times the packed panel */	\
+static inline void dm##TYPE##_mul_blocks(void *arg, size_t begin		\
+		, size_t end) {							\
+	dm##TYPE##_mul_job *job = arg;						\
+	const size_t nr = RH_SIMD_GEMM_NR(TYPE);				\
+	for (size_t block = begin;block < end;++block) {			\
+		TYPE *ap = job->ap + RH_DMAT_WORKER() * RH_DMAT_MC * RH_DMAT_KC;\
+		size_t ic = block * RH_DMAT_MC;					\
+		size_t mc = job->a->rows - ic < RH_DMAT_MC			\
+			? job->a->rows - ic : RH_DMAT_MC;			\
+		dm##TYPE##_pack_a(ap, job->a, ic, mc, job->pc, job->kc);	\
+										\
+		for (size_t jr = 0;jr < job->nc;jr += nr) {			\
+			size_t n = job->nc - jr < nr ? job->nc - jr : nr;	\
+			for (size_t ir = 0;ir < mc;ir += RH_SIMD_GEMM_MR) {	\
+				size_t m = mc - ir < RH_SIMD_GEMM_MR		\
+					? mc - ir : RH_SIMD_GEMM_MR;		\
+				RH_SIMD_SPAN_FN(TYPE, gemm)(job->kc		\
+					, (const void *) &ap[ir * job->kc]	\
+					, (const void *) &job->bp[jr * job->kc]	\
+					, (void *) dm##TYPE##_at(job->c, ic + ir\
+						, job->jc + jr)			\
+					, job->c->stride, m, n);		\
+			}							\
+		}								\
+	}									\
+}										\
+										\
+/* c = a * b, where c is a->rows by b->cols and overlaps neither */		\
+/* b is packed a KC by NC panel at a time, then each MC block of a is */	\
+/* packed and multiplied into c strip by strip by the SIMD kernel */		\
+/* Returns 0, leaving c alone, if the shapes differ or memory runs out */	\
+static inline int dm##TYPE##_mul(dm##TYPE *c, const dm##TYPE *a			\
+		, const dm##TYPE *b) {						\
+	if (a->cols != b->rows || c->rows != a->rows || c->cols != b->cols) {	\
+		return 0;							\
+	}									\
+	const size_t nr = RH_SIMD_GEMM_NR(TYPE);				\
+	size_t panel = RH_DMAT_KC * ((RH_DMAT_NC + nr - 1) / nr * nr);		\
+	size_t blocks = (a->rows + RH_DMAT_MC - 1) / RH_DMAT_MC;		\
+	TYPE *bp = aligned_alloc(RH_DMAT_ALIGN, panel * sizeof(TYPE));		\
+	TYPE *ap = aligned_alloc(RH_DMAT_ALIGN, RH_DMAT_WORKERS() * RH_DMAT_MC	\
+			* RH_DMAT_KC * sizeof(TYPE));				\
+	if (!bp || !ap) {							\
+		free(bp);							\
+		free(ap);							\
+		return 0;							\
+	}									\
+										\
+	for (size_t y = 0;y < c->rows;++y) {					\
+		memset(dm##TYPE##_at(c, y, 0), 0, c->cols * sizeof(TYPE));	\
+	}									\
+	for (size_t jc = 0;jc < b->cols;jc += RH_DMAT_NC) {			\
+		size_t nc = b->cols - jc < RH_DMAT_NC				\
+			? b->cols - jc : RH_DMAT_NC;				\
+		for (size_t pc = 0;pc < a->cols;pc += RH_DMAT_KC) {		\
+			size_t kc = a->cols - pc < RH_DMAT_KC			\
+				? a->cols - pc : RH_DMAT_KC;			\
+			dm##TYPE##_pack_b(bp, b, pc, kc, jc, nc);		\
+			dm##TYPE##_mul_job job = {c, a, bp, ap, kc, pc, nc, jc};\
+			RH_DMAT_FOR(0, blocks, dm##TYPE##_mul_blocks, &job);	\
+		}								\
+	}									\
+	free(bp);								\
+	free(ap);								\
+	return 1;								\
+}
+
+#endif
@@ -0,0 +1,118 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#define RH_DMAT_TASKS
+
+#include "rh_dmat.h"
+#include "rh_bench.h"
+
+#include <stdio.h>
+
+RH_DMAT_MAKE(float);
+RH_DMAT_MAKE(double);
+
+// Enough repeats that each timing covers roughly the same work
+#define FLOPS (1LU << 31)
+// The naive loop takes minutes beyond this
+#define NAIVE_MAX 1024
+
+// The loop RH_IMPL_SIZED_MAT uses for the fixed size matrices
+#define NAIVE(TYPE)								\
+static void naive_##TYPE(dm##TYPE *c, const dm##TYPE *a, const dm##TYPE *b) {	\
+	for (size_t y = 0;y < c->rows;++y) {					\
+	for (size_t x = 0;x < c->cols;++x) {					\
+		TYPE acc = 0;							\
+		for (size_t i = 0;i < a->cols;++i) {				\
+			acc += *dm##TYPE##_at(a, y, i) * *dm##TYPE##_at(b, i, x);\
+		}								\
+		*dm##TYPE##_at(c, y, x) = acc;					\
+	}									\
+	}									\
+}
+
+NAIVE(float)
+NAIVE(double)
+
+static void report(const char *name, size_t n, uint64_t reps, uint64_t ns) {
+	char label[64];
+	snprintf(label, sizeof(label), "%s %zu", name, n);
+	printf("%-40s %12lu ops %10.2f ns/op %8.2f GFLOPS\n", label, reps
+			, (double) ns / reps, 2.0 * n * n * n * reps / ns);
+}
+
+#define BENCH(TYPE)								\
+static void bench_##TYPE(size_t n, int threaded) {				\
+	dm##TYPE a = dm##TYPE##_new(n, n), b = dm##TYPE##_new(n, n);		\
+	dm##TYPE c = dm##TYPE##_new(n, n);					\
+	uint64_t seed = n;							\
+	for (size_t y = 0;y < n;++y) {						\
+	for (size_t x = 0;x < n;++x) {						\
+		*dm##TYPE##_at(&a, y, x) = (rh_bench_rand(&seed) >> 40) * 0x1p-24;\
+		*dm##TYPE##_at(&b, y, x) = (rh_bench_rand(&seed) >> 40) * 0x1p-24;\
+	}									\
+	}									\
+										\
+	uint64_t reps = FLOPS / (2 * n * n * n) ?: 1;				\
+	uint64_t start = rh_bench_now();					\
+	for (uint64_t r = 0;r < reps;++r) {					\
+		dm##TYPE##_mul(&c, &a, &b);					\
+	}									\
+	uint64_t end = rh_bench_now();						\
+	report(threaded ? "dm" #TYPE " mul threaded" : "dm" #TYPE " mul"	\
+			, n, reps, end - start);				\
+										\
+	if (!threaded && n <= NAIVE_MAX) {					\
+		reps = reps / 8 ?: 1;						\
+		start = rh_bench_now();						\
+		for (uint64_t r = 0;r < reps;++r) {				\
+			naive_##TYPE(&c, &a, &b);				\
+		}								\
+		end = rh_bench_now();						\
+		report("dm" #TYPE " naive", n, reps, end - start);		\
+	}									\
+	rh_bench_use(*dm##TYPE##_at(&c, n - 1, n - 1));				\
+										\
+	dm##TYPE##_free(&a);							\
+	dm##TYPE##_free(&b);							\
+	dm##TYPE##_free(&c);							\
+}
+
+BENCH(float)
+BENCH(double)
+
+int main() {
+	for (size_t n = 64;n <= 2048;n *= 2) {
+		bench_float(n, 0);
+		bench_double(n, 0);
+	}
+
+	rh_task_pool pool;
+	if (!rh_task_pool_init(&pool, 0)) {
+		return 1;
+	}
+	for (size_t n = 64;n <= 2048;n *= 2) {
+		bench_float(n, 1);
+		bench_double(n, 1);
+	}
+	rh_task_pool_free(&pool);
+	return 0;
+}
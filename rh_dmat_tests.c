@@ -0,0 +1,183 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+// Small blocks, so modest matrices cross every block boundary
+#define RH_DMAT_KC 32
+#define RH_DMAT_MC 8
+#define RH_DMAT_NC 48
+#define RH_DMAT_TASKS
+
+#include "rh_dmat.h"
+#include "rh_bench.h"
+
+#include <stdio.h>
+#include <math.h>
+
+RH_DMAT_MAKE(float);
+RH_DMAT_MAKE(double);
+RH_DMAT_MAKE(int);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+// Checks mul against the triple loop, to within a bound on the rounding of a
+// k long sum; exact for integers
+#define CHECK_MUL(TYPE, EPS)							\
+static int check_mul_##TYPE(const dm##TYPE *a, const dm##TYPE *b) {		\
+	dm##TYPE c = dm##TYPE##_new(a->rows, b->cols);				\
+	if (!dm##TYPE##_mul(&c, a, b)) {					\
+		dm##TYPE##_free(&c);						\
+		return 1;							\
+	}									\
+										\
+	int errors = 0;								\
+	for (size_t y = 0;y < a->rows;++y) {					\
+	for (size_t x = 0;x < b->cols;++x) {					\
+		double want = 0, mag = 0;					\
+		for (size_t i = 0;i < a->cols;++i) {				\
+			double t = (double) *dm##TYPE##_at(a, y, i)		\
+				* *dm##TYPE##_at(b, i, x);			\
+			want += t;						\
+			mag += fabs(t);						\
+		}								\
+		double got = *dm##TYPE##_at(&c, y, x);				\
+		errors += fabs(got - want) > EPS * a->cols * mag;		\
+	}									\
+	}									\
+	dm##TYPE##_free(&c);							\
+	return errors;								\
+}										\
+										\
+static dm##TYPE rand_##TYPE(uint64_t *seed, size_t rows, size_t cols) {		\
+	dm##TYPE m = dm##TYPE##_new(rows, cols);				\
+	for (size_t y = 0;y < rows;++y) {					\
+	for (size_t x = 0;x < cols;++x) {					\
+		*dm##TYPE##_at(&m, y, x) = (TYPE) (rh_bench_rand(seed) % 2001)	\
+			/ (TYPE) 100 - 10;					\
+	}									\
+	}									\
+	return m;								\
+}										\
+										\
+int mul_##TYPE(void) {								\
+	static const size_t shapes[][3] = {					\
+		{1, 1, 1}, {3, 5, 7}, {4, 32, 16}, {9, 33, 17},			\
+		{61, 70, 101}, {128, 96, 64}, {5, 200, 1}, {1, 200, 5},		\
+	};									\
+	uint64_t seed = 7;							\
+	int errors = 0;								\
+	for (size_t s = 0;s < sizeof(shapes) / sizeof(shapes[0]);++s) {		\
+		dm##TYPE a = rand_##TYPE(&seed, shapes[s][0], shapes[s][1]);	\
+		dm##TYPE b = rand_##TYPE(&seed, shapes[s][1], shapes[s][2]);	\
+		errors += check_mul_##TYPE(&a, &b);				\
+										\
+		/* Views, whose rows do not start aligned */			\
+		if (shapes[s][0] > 2 && shapes[s][1] > 2 && shapes[s][2] > 2) {	\
+			dm##TYPE av = dm##TYPE##_view(&a, 1, 1			\
+					, shapes[s][0] - 2, shapes[s][1] - 2);	\
+			dm##TYPE bv = dm##TYPE##_view(&b, 1, 2			\
+					, shapes[s][1] - 2, shapes[s][2] - 2);	\
+			errors += check_mul_##TYPE(&av, &bv);			\
+		}								\
+		dm##TYPE##_free(&a);						\
+		dm##TYPE##_free(&b);						\
+	}									\
+										\
+	dm##TYPE a = dm##TYPE##_new(3, 4), b = dm##TYPE##_new(3, 4);		\
+	errors += dm##TYPE##_mul(&a, &a, &b);					\
+	dm##TYPE##_free(&a);							\
+	dm##TYPE##_free(&b);							\
+										\
+	if (errors) {								\
+		ERROR_MSG(#TYPE " mul test FAILED! %d errors", errors);		\
+		return 1;							\
+	}									\
+	return 0;								\
+}
+
+CHECK_MUL(float, 1e-6)
+CHECK_MUL(double, 1e-15)
+CHECK_MUL(int, 0)
+
+int views(void) {
+	dmint m = dmint_new(37, 70);
+	int errors = m.stride % (RH_DMAT_ALIGN / sizeof(int)) != 0;
+	for (size_t y = 0;y < m.rows;++y) {
+		errors += (uintptr_t) dmint_at(&m, y, 0) % RH_DMAT_ALIGN != 0;
+		for (size_t x = 0;x < m.cols;++x) {
+			*dmint_at(&m, y, x) = y * 1000 + x;
+		}
+	}
+
+	dmint v = dmint_view(&m, 10, 20, 27, 50);
+	errors += v.rows != 27 || v.cols != 50 || *dmint_at(&v, 2, 3) != 12023;
+	errors += dmint_view(&m, 10, 20, 28, 50).data != NULL;
+	errors += dmint_view(&m, 10, 21, 27, 50).data != NULL;
+	errors += dmint_view(&m, 0, 0, 0, 1).data != NULL;
+
+	dmint t = dmint_new(50, 27);
+	errors += !dmint_transpose(&t, &v) || *dmint_at(&t, 3, 2) != 12023;
+	errors += dmint_transpose(&t, &m);
+	for (size_t y = 0;y < t.rows;++y) {
+		for (size_t x = 0;x < t.cols;++x) {
+			errors += *dmint_at(&t, y, x) != *dmint_at(&v, x, y);
+		}
+	}
+
+	// Copy between views of the same matrix
+	dmint from = dmint_view(&m, 0, 0, 2, 70);
+	dmint to = dmint_view(&m, 30, 0, 2, 70);
+	errors += !dmint_copy(&to, &from) || *dmint_at(&m, 31, 69) != 1069;
+	dmint_fill(&v, -1);
+	errors += *dmint_at(&m, 10, 19) != 10019 || *dmint_at(&m, 10, 20) != -1;
+
+	dmint_free(&t);
+	dmint_free(&m);
+	if (errors) {
+		ERROR_MSG("View test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += mul_float();
+	no_errors += mul_double();
+	no_errors += mul_int();
+	no_errors += views();
+
+	// The same again split across workers
+	rh_task_pool pool;
+	if (rh_task_pool_init(&pool, 4)) {
+		no_errors += mul_float();
+		no_errors += mul_double();
+		no_errors += mul_int();
+		rh_task_pool_free(&pool);
+	}
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -0,0 +1,77 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_FUTEX_H
+#define RH_FUTEX_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Strict C modes hide syscall, so only use futexes where it is declared
+#if defined(__linux__) && (!defined(__STRICT_ANSI__) \
+	|| defined(_DEFAULT_SOURCE) || defined(_GNU_SOURCE))
+#define RH_FUTEX_SYSCALL
+#endif
+
+#ifdef RH_FUTEX_SYSCALL
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <sched.h>
+#endif
+
+// Futex style waiting, falling back to yielding where futexes are unavailable
+static inline void rh_futex_wait(_Atomic uint32_t *word, uint32_t val) {
+#ifdef RH_FUTEX_SYSCALL
+	syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+	if (atomic_load(word) == val) {
+		sched_yield();
+	}
+#endif
+}
+
+static inline void rh_futex_wake(_Atomic uint32_t *word, int no) {
+#ifdef RH_FUTEX_SYSCALL
+	syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, no, NULL, NULL, 0);
+#else
+	(void) word;
+	(void) no;
+#endif
+}
+
+// Bumps word and wakes every waiter, but only if one has armed the flag since
+// the last signal, so a stream of pushes to a sleeping consumer costs one
+// syscall rather than one each
+// The fence orders the caller's slot update before the flag is read
+static inline void rh_futex_signal(_Atomic uint32_t *word
+		, _Atomic uint32_t *armed) {
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(armed, memory_order_relaxed)
+	&& atomic_exchange(armed, 0)) {
+		atomic_fetch_add(word, 1);
+		rh_futex_wake(word, INT32_MAX);
+	}
+}
+
+#endif
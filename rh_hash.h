@@ -27,6 +27,9 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "rh_realloc.h"
+#include "rh_stat.h"
+
 // Macros used in generic code
 #define RH_HASH_SIZE(SIZE) SIZE
 #define RH_HASH_SLOT(HASH, SIZE) (HASH & (SIZE - 1))
@@ -37,6 +40,12 @@
 	RH_HASH_DEF(NAME, KEY_T, VALUE_T);					\
 	RH_HASH_IMPL(NAME, KEY_T, VALUE_T, HASH_F, EQ_F, LOAD);			\
 
+#define RH_HASH_MAKE_ALLOC(NAME, KEY_T, VALUE_T, HASH_F, EQ_F, LOAD		\
+		, REALLOC, FREE)						\
+	RH_HASH_DEF(NAME, KEY_T, VALUE_T);					\
+	RH_HASH_IMPL_ALLOC(NAME, KEY_T, VALUE_T, HASH_F, EQ_F, LOAD		\
+			, REALLOC, FREE);
+
 // Useful functions for making hashmaps with strings
 static inline uint64_t rh_string_hash(const char *string) {
 	// This is a 64 bit FNV-1a hash
@@ -95,6 +104,13 @@ typedef struct {								\
 } NAME;										\
 
 #define RH_HASH_IMPL(NAME, KEY_T, VALUE_T, HASH_F, EQ_F, LOAD)			\
+	RH_HASH_IMPL_ALLOC(NAME, KEY_T, VALUE_T, HASH_F, EQ_F, LOAD		\
+			, RH_REALLOC, RH_FREE)
+
+#define RH_HASH_IMPL_ALLOC(NAME, KEY_T, VALUE_T, HASH_F, EQ_F, LOAD		\
+		, REALLOC, FREE)						\
+RH_STAT_DEF(NAME, 0)								\
+										\
 static inline struct NAME##_bucket 						\
 		NAME##_uset(NAME *map, uint64_t hash, NAME##_bucket item) {	\
 	uint64_t i = RH_HASH_SLOT(hash, map->size);				\
@@ -121,6 +137,7 @@ static inline struct NAME##_bucket 						\
 		hash = h_swap;							\
 	}									\
 	--map->no_items;							\
+	RH_STAT_USE(NAME, sizeof *map->hash + sizeof *map->items);		\
 										\
 	return (struct NAME##_bucket) {0};					\
 }										\
@@ -130,16 +147,19 @@ static inline int NAME##_resize(NAME *map, size_t to) {				\
 		return 0;							\
 	}									\
 										\
-	uint64_t *hash = calloc(sizeof *hash, RH_HASH_SIZE(to));		\
+	uint64_t *hash = REALLOC(NULL, 0, sizeof *hash * RH_HASH_SIZE(to));	\
 	if (!hash) {								\
 		return 0;							\
 	}									\
 										\
-	NAME##_bucket *items = calloc(sizeof *items, RH_HASH_SIZE(to));		\
+	NAME##_bucket *items = REALLOC(NULL, 0					\
+			, sizeof *items * RH_HASH_SIZE(to));			\
 	if (!items) {								\
-		free(hash);							\
+		FREE(hash, sizeof *hash * RH_HASH_SIZE(to));			\
 		return 0;							\
 	}									\
+	memset(hash, 0, sizeof *hash * RH_HASH_SIZE(to));			\
+	memset(items, 0, sizeof *items * RH_HASH_SIZE(to));			\
 										\
 	/* New map is used to avoid swapping later */				\
 	NAME temp = {								\
@@ -152,6 +172,10 @@ static inline int NAME##_resize(NAME *map, size_t to) {				\
 										\
 	/* Allow for empty starting map */					\
 	if (map->hash && map->items) {						\
+		/* Counted again as each is inserted into temp */		\
+		RH_STAT_UNUSE(NAME, ((size_t)((RH_HASH_SIZE(map->size)) * LOAD)	\
+				- map->no_items) * (sizeof *hash		\
+				+ sizeof *items));				\
 		for (size_t i = 0;i < RH_HASH_SIZE(map->size);++i) {		\
 			if (map->hash[i]) {					\
 				/* Return can be ignored as impossible for */	\
@@ -160,8 +184,13 @@ static inline int NAME##_resize(NAME *map, size_t to) {				\
 			}							\
 		}								\
 	}									\
-	free(map->hash);							\
-	free(map->items);							\
+	RH_STAT_RESIZE(NAME, map->hash ? (sizeof *hash + sizeof *items)		\
+			* RH_HASH_SIZE(map->size) : 0				\
+			, (sizeof *hash + sizeof *items) * RH_HASH_SIZE(to));	\
+	if (map->hash) {							\
+		FREE(map->items, sizeof *items * RH_HASH_SIZE(map->size));	\
+		FREE(map->hash, sizeof *hash * RH_HASH_SIZE(map->size));	\
+	}									\
 										\
 	*map = temp;								\
 	return 1;								\
@@ -186,12 +215,21 @@ static inline NAME NAME##_clone(NAME *map) {					\
 		, RH_HASH_SIZE(map->size)*sizeof(*map->items));			\
 	memcpy(ret.hash, map->hash						\
 		, RH_HASH_SIZE(map->size)*sizeof(*map->hash));			\
+	ret.no_items = map->no_items;						\
+	RH_STAT_USE(NAME, ((size_t)((RH_HASH_SIZE(map->size)) * LOAD)		\
+			- map->no_items) * (sizeof *map->hash			\
+			+ sizeof *map->items));					\
 	return ret;								\
 }										\
 										\
 static inline void NAME##_free(NAME *map) {					\
-	free(map->hash);							\
-	free(map->items);							\
+	RH_STAT_FREE(NAME, map->hash ? (sizeof *map->hash			\
+			+ sizeof *map->items) * RH_HASH_SIZE(map->size) : 0	\
+			, map->hash ? ((size_t)((RH_HASH_SIZE(map->size)) * LOAD)\
+				- map->no_items) * (sizeof *map->hash		\
+				+ sizeof *map->items) : 0);			\
+	FREE(map->items, sizeof *map->items * RH_HASH_SIZE(map->size));		\
+	FREE(map->hash, sizeof *map->hash * RH_HASH_SIZE(map->size));		\
 	*map = (NAME){0};							\
 }										\
 										\
@@ -241,6 +279,7 @@ static inline struct NAME##_bucket NAME##_remove(NAME *map, KEY_T key) {	\
 	map->hash[prev] = 0;							\
 	map->items[prev] = (struct NAME##_bucket) {0};				\
 	++map->no_items;							\
+	RH_STAT_UNUSE(NAME, sizeof *map->hash + sizeof *map->items);		\
 										\
 	return ret;								\
 }										\
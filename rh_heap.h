@@ -25,11 +25,24 @@
 #define RH_HEAP_H
 
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "rh_realloc.h"
+#include "rh_stat.h"
+
+#ifndef RH_CACHE_LINE
+#define RH_CACHE_LINE 64
+#endif
 
 #define RH_HEAP_MAKE(NAME, TYPE, CMP)				 		\
 	RH_HEAP_DEF(NAME, TYPE);						\
 	RH_HEAP_IMPL(NAME, TYPE, CMP);
 
+#define RH_HEAP_MAKE_ALLOC(NAME, TYPE, CMP, REALLOC, FREE)			\
+	RH_HEAP_DEF(NAME, TYPE);						\
+	RH_HEAP_IMPL_ALLOC(NAME, TYPE, CMP, REALLOC, FREE);
+
 #define RH_HEAP_DEF(NAME, TYPE) 						\
 typedef struct {								\
 	size_t size;								\
@@ -39,16 +52,23 @@ typedef struct {								\
 } NAME;										\
 
 #define RH_HEAP_IMPL(NAME, TYPE, CMP)						\
+	RH_HEAP_IMPL_ALLOC(NAME, TYPE, CMP, RH_REALLOC, RH_FREE)
+
+#define RH_HEAP_IMPL_ALLOC(NAME, TYPE, CMP, REALLOC, FREE)			\
+RH_STAT_DEF(NAME, 0)								\
+										\
 static inline size_t NAME##_resize(NAME *hp, size_t to) {			\
 	if (hp->top > to) {							\
 		return 0;							\
 	}									\
 										\
-	TYPE *new = realloc(hp->items, to * sizeof(TYPE));			\
+	TYPE *new = REALLOC(hp->items, hp->size * sizeof(TYPE)			\
+			, to * sizeof(TYPE));					\
 	if (!new) {								\
 		return 0;							\
 	}									\
 										\
+	RH_STAT_RESIZE(NAME, hp->size * sizeof(TYPE), to * sizeof(TYPE));	\
 	hp->items = new;							\
 	hp->size = to;								\
 										\
@@ -61,6 +81,11 @@ static inline NAME NAME##_new(size_t size) {					\
 	return ret;								\
 }										\
 										\
+static inline void NAME##_free(NAME *hp) {					\
+	RH_STAT_FREE(NAME, hp->size * sizeof(TYPE), hp->top * sizeof(TYPE));	\
+	FREE(hp->items, hp->size * sizeof(TYPE));				\
+}										\
+										\
 static inline TYPE NAME##_peek(NAME *hp) {					\
 	return hp->top ? hp->items[0] : (TYPE) {0};				\
 }										\
@@ -72,6 +97,7 @@ static inline int NAME##_ins(NAME *hp, TYPE ins) {				\
 	}									\
 										\
 	size_t i = hp->top++;							\
+	RH_STAT_USE(NAME, sizeof(TYPE));					\
 	while (i && CMP(ins, hp->items[(i-1) >> 1]) < 0) {			\
 		hp->items[i] = hp->items[(i - 1) >> 1];				\
 		i = (i - 1) >> 1;						\
@@ -81,34 +107,454 @@ static inline int NAME##_ins(NAME *hp, TYPE ins) {				\
 	return 1;								\
 }										\
 										\
+/* Moves item down from i to its place, treating i as a hole */			\
+static inline void NAME##_sift_down(NAME *hp, size_t i, TYPE item) {		\
+	while (1) {								\
+		size_t n = (i << 1) + 1;					\
+		if (n >= hp->top) {						\
+			break;							\
+		}								\
+		if (n + 1 < hp->top && CMP(hp->items[n + 1], hp->items[n]) < 0) {\
+			++n;							\
+		}								\
+		if (CMP(item, hp->items[n]) <= 0) {				\
+			break;							\
+		}								\
+		hp->items[i] = hp->items[n];					\
+		i = n;								\
+	}									\
+	hp->items[i] = item;							\
+}										\
+										\
+static inline TYPE NAME##_rem(NAME *hp) {					\
+	if (!hp->top) {								\
+		return (TYPE) {0};						\
+	}									\
+										\
+	TYPE ret = hp->items[0];						\
+	TYPE rep = hp->items[--hp->top];					\
+	RH_STAT_UNUSE(NAME, sizeof(TYPE));					\
+	NAME##_sift_down(hp, 0, rep);						\
+										\
+	return ret;								\
+}										\
+										\
+/* Removes the top and inserts item in a single sift */				\
+static inline TYPE NAME##_replace(NAME *hp, TYPE item) {			\
+	if (!hp->top) {								\
+		NAME##_ins(hp, item);						\
+		return (TYPE) {0};						\
+	}									\
+										\
+	TYPE ret = hp->items[0];						\
+	NAME##_sift_down(hp, 0, item);						\
+	return ret;								\
+}										\
+										\
+/* Floyd's bottom up construction, O(n) over all the items */			\
+static inline void NAME##_heapify(NAME *hp) {					\
+	for (size_t i = hp->top / 2;i-- > 0;) {					\
+		NAME##_sift_down(hp, i, hp->items[i]);				\
+	}									\
+}										\
+										\
+static inline NAME NAME##_from_array(const TYPE *items, size_t n) {		\
+	NAME ret = {0};								\
+	if (!n || !NAME##_resize(&ret, n)) {					\
+		return ret;							\
+	}									\
+										\
+	memcpy(ret.items, items, n * sizeof(TYPE));				\
+	ret.top = n;								\
+	RH_STAT_USE(NAME, n * sizeof(TYPE));					\
+	NAME##_heapify(&ret);							\
+	return ret;								\
+}										\
+										\
+/* Sifting each item up costs O(n log size), so a batch at least half the */	\
+/* size of the heap is appended and the whole heap rebuilt instead */		\
+static inline int NAME##_ins_n(NAME *hp, const TYPE *items, size_t n) {		\
+	if (hp->top + n > hp->size) {						\
+		size_t to = hp->size?:1;					\
+		while (to < hp->top + n) {					\
+			to *= 2;						\
+		}								\
+		if (!NAME##_resize(hp, to)) {					\
+			return 0;						\
+		}								\
+	}									\
+										\
+	if (n >= hp->top / 2) {							\
+		memcpy(&hp->items[hp->top], items, n * sizeof(TYPE));		\
+		hp->top += n;							\
+		RH_STAT_USE(NAME, n * sizeof(TYPE));				\
+		NAME##_heapify(hp);						\
+		return 1;							\
+	}									\
+										\
+	for (size_t j = 0;j < n;++j) {						\
+		NAME##_ins(hp, items[j]);					\
+	}									\
+	return 1;								\
+}										\
+										\
+/* Keeps the k greatest items seen in the heap, its top being the least of */	\
+/* them; items not above the top are rejected with a single comparison */	\
+/* Returns whether item was kept */						\
+static inline int NAME##_topk(NAME *hp, size_t k, TYPE item) {			\
+	if (hp->top < k) {							\
+		return NAME##_ins(hp, item);					\
+	}									\
+	if (!k || CMP(item, hp->items[0]) <= 0) {				\
+		return 0;							\
+	}									\
+										\
+	NAME##_sift_down(hp, 0, item);						\
+	return 1;								\
+}										\
+										\
+/* topk over a whole array, building the first k with heapify */		\
+static inline int NAME##_topk_n(NAME *hp, size_t k				\
+		, const TYPE *items, size_t n) {				\
+	size_t fill = hp->top < k ? k - hp->top : 0;				\
+	fill = fill < n ? fill : n;						\
+	if (fill && !NAME##_ins_n(hp, items, fill)) {				\
+		return 0;							\
+	}									\
+	if (!hp->top) {								\
+		return 1;							\
+	}									\
+										\
+	for (size_t j = fill;j < n;++j) {					\
+		if (CMP(items[j], hp->items[0]) > 0) {				\
+			NAME##_sift_down(hp, 0, items[j]);			\
+		}								\
+	}									\
+	return 1;								\
+}
+
+// D-ary heap, D being a compile time constant such as 4 or 8
+// Children of i are D * i + 1 to D * i + D; the items are offset by D - 1 from
+// a cache line aligned block, so every group of siblings starts on a multiple
+// of D items and, when D * sizeof(TYPE) is the line size, fills one line
+// Removal moves the hole to a leaf along the smallest children and then sifts
+// the last item up from there, as it almost always belongs near the bottom
+#define RH_DHEAP_MAKE(NAME, TYPE, CMP, D)					\
+	RH_DHEAP_DEF(NAME, TYPE);						\
+	RH_DHEAP_IMPL(NAME, TYPE, CMP, D);
+
+#define RH_DHEAP_DEF(NAME, TYPE)						\
+typedef struct {								\
+	size_t size;								\
+	size_t top;								\
+										\
+	TYPE *items;								\
+} NAME;										\
+
+#define RH_DHEAP_IMPL(NAME, TYPE, CMP, D)					\
+_Static_assert((D) >= 2, #NAME " must have at least two children");		\
+static inline size_t NAME##_resize(NAME *hp, size_t to) {			\
+	if (!to || hp->top > to) {						\
+		return 0;							\
+	}									\
+										\
+	size_t bytes = (to + (D) - 1) * sizeof(TYPE);				\
+	bytes = (bytes + RH_CACHE_LINE - 1) & ~(size_t) (RH_CACHE_LINE - 1);	\
+	TYPE *new = aligned_alloc(RH_CACHE_LINE, bytes);			\
+	if (!new) {								\
+		return 0;							\
+	}									\
+										\
+	if (hp->items) {							\
+		memcpy(new + (D) - 1, hp->items, hp->top * sizeof(TYPE));	\
+		free(hp->items - ((D) - 1));					\
+	}									\
+	hp->items = new + (D) - 1;						\
+	hp->size = to;								\
+										\
+	return hp->size;							\
+}										\
+										\
+static inline NAME NAME##_new(size_t size) {					\
+	NAME ret = {0};								\
+	NAME##_resize(&ret, size);						\
+	return ret;								\
+}										\
+										\
+static inline void NAME##_free(NAME *hp) {					\
+	if (hp->items) {							\
+		free(hp->items - ((D) - 1));					\
+	}									\
+}										\
+										\
+static inline TYPE NAME##_peek(NAME *hp) {					\
+	return hp->top ? hp->items[0] : (TYPE) {0};				\
+}										\
+										\
+static inline int NAME##_ins(NAME *hp, TYPE ins) {				\
+	if (hp->top == hp->size							\
+	&& !NAME##_resize(hp, (hp->size?:(D)) * 2)) {				\
+		return 0;							\
+	}									\
+										\
+	size_t i = hp->top++;							\
+	while (i && CMP(ins, hp->items[(i - 1) / (D)]) < 0) {			\
+		hp->items[i] = hp->items[(i - 1) / (D)];			\
+		i = (i - 1) / (D);						\
+	}									\
+	hp->items[i] = ins;							\
+										\
+	return 1;								\
+}										\
+										\
 static inline TYPE NAME##_rem(NAME *hp) {					\
 	if (!hp->top) {								\
 		return (TYPE) {0};						\
 	}									\
 										\
 	TYPE ret = hp->items[0];						\
-	TYPE rep = hp->items[hp->top--];					\
+	TYPE rep = hp->items[--hp->top];					\
 	size_t i = 0;								\
+	size_t c;								\
 										\
-	while (1) {								\
-		size_t n;							\
-		if ((n = (i << 1) + 1) <= hp->top 				\
-				&& CMP(rep, hp->items[n]) > 0) {		\
-			hp->items[i] = hp->items[n];				\
-			i = n;							\
-			continue;						\
+	/* Full groups have a constant trip count so the scan unrolls */	\
+	/* The minimum is picked without branches as they would mispredict, */	\
+	/* and the next level is prefetched to overlap its cache misses */	\
+	/* when all of it is held, so no address passes the end */		\
+	while ((c = (D) * i + 1) + (D) <= hp->top) {				\
+		if ((D) * c + 1 + (D) * (D) <= hp->top) {			\
+			for (size_t p = 0;p < (D) * (D) * sizeof(TYPE)		\
+					;p += RH_CACHE_LINE) {			\
+				__builtin_prefetch((char *) &hp->items[(D) * c	\
+						+ 1] + p);			\
+			}							\
+		}								\
+		size_t m = c;							\
+		TYPE min = hp->items[c];					\
+		for (size_t k = 1;k < (D);++k) {				\
+			int less = CMP(hp->items[c + k], min) < 0;		\
+			m = less ? c + k : m;					\
+			min = less ? hp->items[c + k] : min;			\
 		}								\
-		if ((n = (i << 1) + 2) <= hp->top 				\
-				&& CMP(rep, hp->items[n]) > 0) {		\
-			hp->items[i] = hp->items[n];				\
-			i = n;							\
-			continue;						\
+		hp->items[i] = min;						\
+		i = m;								\
+	}									\
+	if (c < hp->top) {							\
+		size_t m = c;							\
+		for (size_t k = c + 1;k < hp->top;++k) {			\
+			if (CMP(hp->items[k], hp->items[m]) < 0) {		\
+				m = k;						\
+			}							\
 		}								\
-		break;								\
+		hp->items[i] = hp->items[m];					\
+		i = m;								\
+	}									\
+										\
+	while (i && CMP(rep, hp->items[(i - 1) / (D)]) < 0) {			\
+		hp->items[i] = hp->items[(i - 1) / (D)];			\
+		i = (i - 1) / (D);						\
 	}									\
 	hp->items[i] = rep;							\
 										\
+	return ret;								\
+}
+
+// Indexed heap, where each item has a caller chosen handle (a small integer,
+// e.g. a vertex number) whose position is tracked through every sift
+// This allows O(log n) update and removal of any item by handle
+#define RH_IHEAP_MAKE(NAME, TYPE, CMP)						\
+	RH_IHEAP_DEF(NAME, TYPE);						\
+	RH_IHEAP_IMPL(NAME, TYPE, CMP);
+
+#define RH_IHEAP_NONE SIZE_MAX
+
+#define RH_IHEAP_DEF(NAME, TYPE)						\
+typedef struct NAME##_node {							\
+	TYPE value;								\
+	size_t handle;								\
+} NAME##_node;									\
+										\
+typedef struct {								\
+	size_t size;								\
+	size_t top;								\
+										\
+	NAME##_node *items;							\
+										\
+	/* Position of each handle in items, or RH_IHEAP_NONE */		\
+	size_t no_handles;							\
+	size_t *pos;								\
+} NAME;
+
+#define RH_IHEAP_IMPL(NAME, TYPE, CMP)						\
+static inline size_t NAME##_resize(NAME *hp, size_t to) {			\
+	if (hp->top > to) {							\
+		return 0;							\
+	}									\
+										\
+	NAME##_node *new = realloc(hp->items, to * sizeof(*new));		\
+	if (!new) {								\
+		return 0;							\
+	}									\
+										\
+	hp->items = new;							\
+	hp->size = to;								\
+										\
+	return hp->size;							\
+}										\
+										\
+static inline size_t NAME##_reserve_handles(NAME *hp, size_t to) {		\
+	if (to <= hp->no_handles) {						\
+		return hp->no_handles;						\
+	}									\
+										\
+	size_t *new = realloc(hp->pos, to * sizeof(*new));			\
+	if (!new) {								\
+		return 0;							\
+	}									\
+										\
+	for (size_t i = hp->no_handles;i < to;++i) {				\
+		new[i] = RH_IHEAP_NONE;						\
+	}									\
+	hp->pos = new;								\
+	hp->no_handles = to;							\
+										\
+	return hp->no_handles;							\
+}										\
+										\
+static inline NAME NAME##_new(size_t size) {					\
+	NAME ret = {0};								\
+	NAME##_resize(&ret, size);						\
+	NAME##_reserve_handles(&ret, size);					\
+	return ret;								\
+}										\
+										\
+static inline void NAME##_free(NAME *hp) {					\
+	free(hp->items);							\
+	free(hp->pos);								\
+}										\
+										\
+static inline int NAME##_contains(NAME *hp, size_t handle) {			\
+	return handle < hp->no_handles && hp->pos[handle] != RH_IHEAP_NONE;	\
+}										\
+										\
+static inline TYPE NAME##_peek(NAME *hp) {					\
+	return hp->top ? hp->items[0].value : (TYPE) {0};			\
+}										\
+										\
+static inline size_t NAME##_peek_handle(NAME *hp) {				\
+	return hp->top ? hp->items[0].handle : RH_IHEAP_NONE;			\
+}										\
+										\
+static inline TYPE NAME##_get(NAME *hp, size_t handle) {			\
+	if (!NAME##_contains(hp, handle)) {					\
+		return (TYPE) {0};						\
+	}									\
+	return hp->items[hp->pos[handle]].value;				\
+}										\
+										\
+/* Both sifts move a hole, recording the new position of every moved node */	\
+static inline void NAME##_sift_up(NAME *hp, size_t i, NAME##_node node) {	\
+	while (i && CMP(node.value, hp->items[(i - 1) >> 1].value) < 0) {	\
+		hp->items[i] = hp->items[(i - 1) >> 1];				\
+		hp->pos[hp->items[i].handle] = i;				\
+		i = (i - 1) >> 1;						\
+	}									\
+	hp->items[i] = node;							\
+	hp->pos[node.handle] = i;						\
+}										\
+										\
+static inline void NAME##_sift_down(NAME *hp, size_t i, NAME##_node node) {	\
+	while (1) {								\
+		size_t n = (i << 1) + 1;					\
+		if (n >= hp->top) {						\
+			break;							\
+		}								\
+		if (n + 1 < hp->top						\
+		&& CMP(hp->items[n + 1].value, hp->items[n].value) < 0) {	\
+			++n;							\
+		}								\
+		if (CMP(node.value, hp->items[n].value) <= 0) {			\
+			break;							\
+		}								\
+		hp->items[i] = hp->items[n];					\
+		hp->pos[hp->items[i].handle] = i;				\
+		i = n;								\
+	}									\
+	hp->items[i] = node;							\
+	hp->pos[node.handle] = i;						\
+}										\
+										\
+/* Changes the value of handle, moving it up or down as needed */		\
+static inline int NAME##_update(NAME *hp, size_t handle, TYPE value) {		\
+	if (!NAME##_contains(hp, handle)) {					\
+		return 0;							\
+	}									\
+										\
+	size_t i = hp->pos[handle];						\
+	NAME##_node node = {value, handle};					\
+	if (CMP(value, hp->items[i].value) < 0) {				\
+		NAME##_sift_up(hp, i, node);					\
+	} else {								\
+		NAME##_sift_down(hp, i, node);					\
+	}									\
+	return 1;								\
+}										\
+										\
+/* Inserts handle, or updates it if already present */				\
+static inline int NAME##_ins(NAME *hp, size_t handle, TYPE value) {		\
+	if (NAME##_contains(hp, handle)) {					\
+		return NAME##_update(hp, handle, value);			\
+	}									\
+										\
+	if (handle >= hp->no_handles						\
+	&& !NAME##_reserve_handles(hp, handle >= hp->no_handles * 2		\
+			? handle + 1 : hp->no_handles * 2)) {			\
+		return 0;							\
+	}									\
+	if (hp->top == hp->size							\
+	&& !NAME##_resize(hp, (hp->size?:1) * 2)) {				\
+		return 0;							\
+	}									\
+										\
+	NAME##_sift_up(hp, hp->top++, (NAME##_node) {value, handle});		\
 	return 1;								\
+}										\
+										\
+/* Removes handle from anywhere in the heap, returning its value */		\
+static inline TYPE NAME##_remove(NAME *hp, size_t handle) {			\
+	if (!NAME##_contains(hp, handle)) {					\
+		return (TYPE) {0};						\
+	}									\
+										\
+	size_t i = hp->pos[handle];						\
+	TYPE ret = hp->items[i].value;						\
+	hp->pos[handle] = RH_IHEAP_NONE;					\
+										\
+	NAME##_node rep = hp->items[--hp->top];					\
+	if (i != hp->top) {							\
+		if (CMP(rep.value, ret) < 0) {					\
+			NAME##_sift_up(hp, i, rep);				\
+		} else {							\
+			NAME##_sift_down(hp, i, rep);				\
+		}								\
+	}									\
+										\
+	return ret;								\
+}										\
+										\
+/* Removes the minimum, setting *handle to its handle if not NULL */		\
+static inline TYPE NAME##_rem(NAME *hp, size_t *handle) {			\
+	if (!hp->top) {								\
+		if (handle) {							\
+			*handle = RH_IHEAP_NONE;				\
+		}								\
+		return (TYPE) {0};						\
+	}									\
+										\
+	if (handle) {								\
+		*handle = hp->items[0].handle;					\
+	}									\
+	return NAME##_remove(hp, hp->items[0].handle);				\
 }
 
 #endif
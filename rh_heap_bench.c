@@ -0,0 +1,150 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_heap.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+#define CMP_U64(A, B) (((A) > (B)) - ((A) < (B)))
+
+RH_HEAP_MAKE(bin_heap, uint64_t, CMP_U64);
+RH_DHEAP_MAKE(quad_heap, uint64_t, CMP_U64, 4);
+RH_DHEAP_MAKE(oct_heap, uint64_t, CMP_U64, 8);
+
+#define OPS (1 << 22)
+
+// Fill to n, drain, then the hold model of a scheduler: keep n items, remove
+// the earliest deadline and insert one a random delay after it
+#define BENCH_HEAP(NAME)							\
+static void bench_##NAME(size_t n) {						\
+	NAME hp = NAME##_new(16);						\
+	uint64_t seed = 4;							\
+	uint64_t check = 0;							\
+	char label[64];								\
+										\
+	uint64_t start = rh_bench_now();					\
+	for (size_t i = 0;i < n;++i) {						\
+		NAME##_ins(&hp, rh_bench_rand(&seed) >> 32);			\
+	}									\
+	uint64_t filled = rh_bench_now();					\
+	uint64_t last = 0;							\
+	for (size_t i = 0;i < n;++i) {						\
+		uint64_t v = NAME##_rem(&hp);					\
+		check += v < last;						\
+		last = v;							\
+	}									\
+	uint64_t drained = rh_bench_now();					\
+										\
+	for (size_t i = 0;i < n;++i) {						\
+		NAME##_ins(&hp, rh_bench_rand(&seed) >> 32);			\
+	}									\
+	uint64_t mixed = rh_bench_now();					\
+	for (size_t i = 0;i < OPS;++i) {					\
+		uint64_t v = NAME##_rem(&hp);					\
+		NAME##_ins(&hp, v + (rh_bench_rand(&seed) >> 32));		\
+	}									\
+	uint64_t end = rh_bench_now();						\
+										\
+	snprintf(label, sizeof(label), #NAME " %zu insert", n);			\
+	rh_bench_report(label, n, filled - start);				\
+	snprintf(label, sizeof(label), #NAME " %zu remove", n);			\
+	rh_bench_report(label, n, drained - filled);				\
+	snprintf(label, sizeof(label), #NAME " %zu remove+insert", n);		\
+	rh_bench_report(label, OPS, end - mixed);				\
+	if (check) {								\
+		fprintf(stderr, #NAME " removed out of order\n");		\
+	}									\
+	NAME##_free(&hp);							\
+}
+
+BENCH_HEAP(bin_heap)
+BENCH_HEAP(quad_heap)
+BENCH_HEAP(oct_heap)
+
+#define BULK (1 << 22)
+#define STREAM (1 << 24)
+
+// Building from n items one insert at a time against Floyd's heapify, and
+// streaming top-k selection
+static void bench_bulk(void) {
+	uint64_t *items = malloc(STREAM * sizeof(*items));
+	uint64_t seed = 6;
+	for (size_t i = 0;i < STREAM;++i) {
+		items[i] = rh_bench_rand(&seed);
+	}
+
+	uint64_t start = rh_bench_now();
+	bin_heap hp = {0};
+	for (size_t i = 0;i < BULK;++i) {
+		bin_heap_ins(&hp, items[i]);
+	}
+	rh_bench_report("bin_heap build by ins", BULK, rh_bench_now() - start);
+	bin_heap_free(&hp);
+
+	start = rh_bench_now();
+	hp = bin_heap_from_array(items, BULK);
+	rh_bench_report("bin_heap build by from_array", BULK
+			, rh_bench_now() - start);
+	bin_heap_free(&hp);
+
+	start = rh_bench_now();
+	hp = (bin_heap) {0};
+	for (size_t i = 0;i < BULK;i += 4096) {
+		bin_heap_ins_n(&hp, &items[i], 4096);
+	}
+	rh_bench_report("bin_heap build by ins_n of 4096", BULK
+			, rh_bench_now() - start);
+	bin_heap_free(&hp);
+
+	for (size_t k = 16;k <= 1 << 16;k <<= 6) {
+		char label[64];
+		start = rh_bench_now();
+		hp = (bin_heap) {0};
+		for (size_t i = 0;i < STREAM;++i) {
+			bin_heap_topk(&hp, k, items[i]);
+		}
+		snprintf(label, sizeof(label), "bin_heap topk %zu", k);
+		rh_bench_report(label, STREAM, rh_bench_now() - start);
+		bin_heap_free(&hp);
+
+		start = rh_bench_now();
+		hp = (bin_heap) {0};
+		bin_heap_topk_n(&hp, k, items, STREAM);
+		snprintf(label, sizeof(label), "bin_heap topk_n %zu", k);
+		rh_bench_report(label, STREAM, rh_bench_now() - start);
+		bin_heap_free(&hp);
+	}
+
+	free(items);
+}
+
+int main() {
+	for (size_t n = 1 << 10;n <= 1 << 22;n <<= 6) {
+		bench_bin_heap(n);
+		bench_quad_heap(n);
+		bench_oct_heap(n);
+	}
+	bench_bulk();
+
+	return 0;
+}
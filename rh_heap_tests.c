@@ -0,0 +1,175 @@
+/*******************************************************************************
+* Copyright 2017 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_heap.h"
+#include <stdio.h>
+#include <stdint.h>
+
+#define CMP_INT(A, B) (((A) > (B)) - ((A) < (B)))
+
+RH_HEAP_MAKE(test_heap, int, CMP_INT);
+RH_DHEAP_MAKE(test_dheap, int, CMP_INT, 4);
+RH_IHEAP_MAKE(test_iheap, int, CMP_INT);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+static const int values[] = {5, 3, 9, 1, 7, 3, 8, 2, 6, 0, 4, 11, 10};
+#define NO_VALUES (sizeof(values) / sizeof(values[0]))
+
+#define ORDER_TEST(NAME)							\
+int NAME##_order(void) {							\
+	NAME hp = {0};								\
+	for (size_t i = 0;i < NO_VALUES;++i) {					\
+		NAME##_ins(&hp, values[i]);					\
+	}									\
+	int last = -1;								\
+	for (size_t i = 0;i < NO_VALUES;++i) {					\
+		int v = NAME##_rem(&hp);					\
+		if (v < last) {							\
+			ERROR_MSG(#NAME " order test FAILED! %d after %d", v, last);\
+			return 1;						\
+		}								\
+		last = v;							\
+	}									\
+	if (hp.top || last != 11) {						\
+		ERROR_MSG(#NAME " order test FAILED! Top %zu", hp.top);		\
+		return 1;							\
+	}									\
+										\
+	NAME##_free(&hp);							\
+	return 0;								\
+}
+
+ORDER_TEST(test_heap)
+ORDER_TEST(test_dheap)
+
+int dheap_aligned(void) {
+	test_dheap hp = test_dheap_new(100);
+	if ((uintptr_t) &hp.items[1] % RH_CACHE_LINE
+	&& (uintptr_t) &hp.items[1] % (4 * sizeof(int))) {
+		ERROR_MSG("D-heap alignment test FAILED!");
+		return 1;
+	}
+
+	test_dheap_free(&hp);
+	return 0;
+}
+
+int iheap_update(void) {
+	test_iheap hp = {0};
+	for (size_t i = 0;i < NO_VALUES;++i) {
+		test_iheap_ins(&hp, i, values[i]);
+	}
+	/* Handle 0 holds 5, handle 2 holds 9 */
+	test_iheap_update(&hp, 2, -1);
+	test_iheap_update(&hp, 9, 20);
+	size_t handle;
+	int v = test_iheap_rem(&hp, &handle);
+	if (v != -1 || handle != 2 || test_iheap_contains(&hp, 2)
+	|| test_iheap_get(&hp, 9) != 20) {
+		ERROR_MSG("Indexed heap update test FAILED! Got %d from %zu", v, handle);
+		return 1;
+	}
+
+	test_iheap_free(&hp);
+	return 0;
+}
+
+int iheap_remove(void) {
+	test_iheap hp = {0};
+	for (size_t i = 0;i < NO_VALUES;++i) {
+		test_iheap_ins(&hp, i, values[i]);
+	}
+	/* Handle 3 holds 1, handle 9 holds 0 */
+	if (test_iheap_remove(&hp, 3) != 1 || test_iheap_contains(&hp, 3)) {
+		ERROR_MSG("Indexed heap remove test FAILED!");
+		return 1;
+	}
+	int last = -1;
+	while (hp.top) {
+		size_t handle;
+		int v = test_iheap_rem(&hp, &handle);
+		if (v < last || v == 1 || hp.pos[handle] != RH_IHEAP_NONE) {
+			ERROR_MSG("Indexed heap remove test FAILED! %d after %d", v, last);
+			return 1;
+		}
+		last = v;
+	}
+
+	test_iheap_free(&hp);
+	return 0;
+}
+
+int from_array(void) {
+	test_heap hp = test_heap_from_array(values, NO_VALUES);
+	int last = -1;
+	while (hp.top) {
+		int v = test_heap_rem(&hp);
+		if (v < last) {
+			ERROR_MSG("From array test FAILED! %d after %d", v, last);
+			return 1;
+		}
+		last = v;
+	}
+
+	test_heap_free(&hp);
+	return 0;
+}
+
+int topk(void) {
+	test_heap hp = {0};
+	test_heap_topk_n(&hp, 3, values, NO_VALUES);
+	if (hp.top != 3 || test_heap_rem(&hp) != 9 || test_heap_rem(&hp) != 10
+	|| test_heap_rem(&hp) != 11) {
+		ERROR_MSG("Top k test FAILED!");
+		return 1;
+	}
+
+	for (size_t i = 0;i < NO_VALUES;++i) {
+		test_heap_topk(&hp, 2, values[i]);
+	}
+	if (hp.top != 2 || test_heap_peek(&hp) != 10) {
+		ERROR_MSG("Streaming top k test FAILED!");
+		return 1;
+	}
+
+	test_heap_free(&hp);
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += test_heap_order();
+	no_errors += test_dheap_order();
+	no_errors += dheap_aligned();
+	no_errors += from_array();
+	no_errors += topk();
+	no_errors += iheap_update();
+	no_errors += iheap_remove();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
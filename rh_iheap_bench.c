@@ -0,0 +1,159 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_heap.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+// Dijkstra on a random graph, with decrease-key on an indexed heap against
+// pushing duplicates to a plain heap and skipping the stale ones
+
+#define NODES (1 << 20)
+#define DEGREE 8
+#define MAX_WEIGHT 1000
+
+typedef struct {
+	uint64_t dist;
+	uint32_t node;
+} entry;
+
+#define CMP_U64(A, B) (((A) > (B)) - ((A) < (B)))
+#define CMP_ENTRY(A, B) CMP_U64((A).dist, (B).dist)
+
+RH_HEAP_MAKE(lazy_heap, entry, CMP_ENTRY);
+RH_IHEAP_MAKE(index_heap, uint64_t, CMP_U64);
+
+typedef struct {
+	uint32_t *first;
+	uint32_t *to;
+	uint32_t *weight;
+} graph;
+
+static graph make_graph(void) {
+	graph g = {
+		.first = malloc((NODES + 1) * sizeof(uint32_t)),
+		.to = malloc(NODES * DEGREE * sizeof(uint32_t)),
+		.weight = malloc(NODES * DEGREE * sizeof(uint32_t)),
+	};
+	uint64_t seed = 5;
+	for (size_t i = 0;i < NODES;++i) {
+		g.first[i] = i * DEGREE;
+		for (size_t j = 0;j < DEGREE;++j) {
+			uint64_t r = rh_bench_rand(&seed);
+			g.to[i * DEGREE + j] = r % NODES;
+			g.weight[i * DEGREE + j] = 1 + (r >> 32) % MAX_WEIGHT;
+		}
+	}
+	g.first[NODES] = NODES * DEGREE;
+	return g;
+}
+
+static uint64_t lazy_dijkstra(graph *g, uint64_t *dist, size_t *peak) {
+	lazy_heap hp = lazy_heap_new(1024);
+	for (size_t i = 0;i < NODES;++i) {
+		dist[i] = UINT64_MAX;
+	}
+	dist[0] = 0;
+	lazy_heap_ins(&hp, (entry) {0, 0});
+	*peak = 0;
+
+	while (hp.top) {
+		*peak = hp.top > *peak ? hp.top : *peak;
+		entry e = lazy_heap_rem(&hp);
+		if (e.dist != dist[e.node]) {
+			continue;
+		}
+		for (uint32_t j = g->first[e.node];j < g->first[e.node + 1];++j) {
+			uint64_t d = e.dist + g->weight[j];
+			if (d < dist[g->to[j]]) {
+				dist[g->to[j]] = d;
+				lazy_heap_ins(&hp, (entry) {d, g->to[j]});
+			}
+		}
+	}
+
+	lazy_heap_free(&hp);
+	uint64_t sum = 0;
+	for (size_t i = 0;i < NODES;++i) {
+		sum += dist[i] != UINT64_MAX ? dist[i] : 0;
+	}
+	return sum;
+}
+
+static uint64_t indexed_dijkstra(graph *g, uint64_t *dist, size_t *peak) {
+	index_heap hp = index_heap_new(NODES);
+	for (size_t i = 0;i < NODES;++i) {
+		dist[i] = UINT64_MAX;
+	}
+	dist[0] = 0;
+	index_heap_ins(&hp, 0, 0);
+	*peak = 0;
+
+	while (hp.top) {
+		*peak = hp.top > *peak ? hp.top : *peak;
+		size_t node;
+		uint64_t d_node = index_heap_rem(&hp, &node);
+		for (uint32_t j = g->first[node];j < g->first[node + 1];++j) {
+			uint64_t d = d_node + g->weight[j];
+			if (d < dist[g->to[j]]) {
+				dist[g->to[j]] = d;
+				index_heap_ins(&hp, g->to[j], d);
+			}
+		}
+	}
+
+	index_heap_free(&hp);
+	uint64_t sum = 0;
+	for (size_t i = 0;i < NODES;++i) {
+		sum += dist[i] != UINT64_MAX ? dist[i] : 0;
+	}
+	return sum;
+}
+
+int main() {
+	graph g = make_graph();
+	uint64_t *dist = malloc(NODES * sizeof(*dist));
+	size_t peak;
+
+	uint64_t start = rh_bench_now();
+	uint64_t lazy = lazy_dijkstra(&g, dist, &peak);
+	rh_bench_report("lazy deletion dijkstra", NODES * DEGREE
+			, rh_bench_now() - start);
+	printf("lazy deletion peak heap size %zu\n", peak);
+
+	start = rh_bench_now();
+	uint64_t indexed = indexed_dijkstra(&g, dist, &peak);
+	rh_bench_report("indexed decrease-key dijkstra", NODES * DEGREE
+			, rh_bench_now() - start);
+	printf("indexed peak heap size %zu\n", peak);
+
+	if (lazy != indexed) {
+		fprintf(stderr, "Shortest paths disagree\n");
+	}
+
+	free(dist);
+	free(g.first);
+	free(g.to);
+	free(g.weight);
+	return 0;
+}
@@ -0,0 +1,208 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_LF_POOL_H
+#define RH_LF_POOL_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "rh_pool.h"
+
+#ifndef RH_CACHE_LINE
+#define RH_CACHE_LINE 64
+#endif
+
+// Lock free pool of fixed size objects (a Treiber stack)
+// Every object lives in one slab fixed at init, so the head is packed into 64
+// bits as a 32 bit tag, bumped on every change to rule out ABA, over the index
+// of the top object plus one (0 when empty); free objects are threaded through
+// the usual rh_mem_link
+// Once the slab is exhausted alloc falls back to malloc and free hands objects
+// outside the slab back to free, so the pool never fails while malloc does not
+// A popping thread may read the link of an object another thread has just
+// taken; it stays inside the slab and the tag makes the CAS fail, but it is a
+// benign race that thread sanitizers will report
+#define RH_LF_POOL_TAG(HEAD) ((HEAD) >> 32)
+#define RH_LF_POOL_TOP(HEAD) ((HEAD) & 0xffffffff)
+
+typedef struct {
+	unsigned char *base;
+	size_t size;
+	size_t count;
+
+	_Alignas(RH_CACHE_LINE) _Atomic uint64_t head;
+} rh_lf_pool;
+
+// Whether mem lies in the slab, rather than having come from malloc
+// Also checks alignment, so that a stale link is always safe to read through
+static inline int rh_lf_pool_owns(rh_lf_pool *p, void *mem) {
+	return (uintptr_t) mem - (uintptr_t) p->base < p->size * p->count
+		&& !((uintptr_t) mem & (sizeof(void *) - 1));
+}
+
+// Index plus one of an object of the slab, 0 for NULL
+static inline size_t rh_lf_pool_index(rh_lf_pool *p, void *mem) {
+	return mem ? ((unsigned char *) mem - p->base) / p->size + 1 : 0;
+}
+
+static inline rh_mem_link *rh_lf_pool_at(rh_lf_pool *p, size_t index) {
+	return index ? (rh_mem_link *) (p->base + (index - 1) * p->size) : NULL;
+}
+
+static inline uint64_t rh_lf_pool_head(uint64_t old, size_t index) {
+	return ((RH_LF_POOL_TAG(old) + 1) << 32) | index;
+}
+
+// Size is rounded up to a multiple of align, which must be a power of two
+static inline int rh_lf_pool_init(rh_lf_pool *p, size_t size, size_t count
+		, size_t align) {
+	align = align < sizeof(void *) ? sizeof(void *) : align;
+	size = size < sizeof(rh_mem_link) ? sizeof(rh_mem_link) : size;
+	size = rh_slab_round(size, align);
+	if (!count || count >= 0xffffffff) {
+		return 0;
+	}
+
+	p->base = aligned_alloc(align, rh_slab_round(size * count, align));
+	if (!p->base) {
+		return 0;
+	}
+	p->size = size;
+	p->count = count;
+
+	for (size_t i = 1;i <= count;++i) {
+		rh_lf_pool_at(p, i)->link = rh_lf_pool_at(p, i < count ? i + 1 : 0);
+	}
+	atomic_init(&p->head, 1);
+	return 1;
+}
+
+// Releases the slab; objects that came from malloc must be freed first
+static inline void rh_lf_pool_freeall(rh_lf_pool *p) {
+	free(p->base);
+	*p = (rh_lf_pool) {0};
+}
+
+static inline void *rh_lf_pool_alloc(rh_lf_pool *p) {
+	uint64_t old = atomic_load_explicit(&p->head, memory_order_acquire);
+	while (RH_LF_POOL_TOP(old)) {
+		rh_mem_link *top = rh_lf_pool_at(p, RH_LF_POOL_TOP(old));
+		rh_mem_link *next = __atomic_load_n(&top->link, __ATOMIC_RELAXED);
+		if (next && !rh_lf_pool_owns(p, next)) {
+			/* Taken and reused since head was read */
+			old = atomic_load_explicit(&p->head, memory_order_acquire);
+			continue;
+		}
+		if (atomic_compare_exchange_weak_explicit(&p->head, &old
+				, rh_lf_pool_head(old, rh_lf_pool_index(p, next))
+				, memory_order_acquire, memory_order_acquire)) {
+			return top;
+		}
+	}
+
+	return malloc(p->size);
+}
+
+// Pushes the chain first ... last, already linked, with one CAS
+static inline void rh_lf_pool_push(rh_lf_pool *p, rh_mem_link *first
+		, rh_mem_link *last) {
+	size_t index = rh_lf_pool_index(p, first);
+	uint64_t old = atomic_load_explicit(&p->head, memory_order_relaxed);
+	do {
+		__atomic_store_n(&last->link, rh_lf_pool_at(p, RH_LF_POOL_TOP(old))
+				, __ATOMIC_RELAXED);
+	} while (!atomic_compare_exchange_weak_explicit(&p->head, &old
+			, rh_lf_pool_head(old, index)
+			, memory_order_release, memory_order_relaxed));
+}
+
+static inline void rh_lf_pool_free(rh_lf_pool *p, void *mem) {
+	if (!mem) {
+		return;
+	}
+	if (!rh_lf_pool_owns(p, mem)) {
+		free(mem);
+		return;
+	}
+
+	rh_lf_pool_push(p, mem, mem);
+}
+
+// Pops up to n objects with one CAS, mallocing the rest
+// Returns the number allocated, which is only less than n if malloc fails
+static inline size_t rh_lf_pool_alloc_n(rh_lf_pool *p, void **mem, size_t n) {
+	size_t got = 0;
+	uint64_t old = atomic_load_explicit(&p->head, memory_order_acquire);
+	while (n && RH_LF_POOL_TOP(old)) {
+		/* Walk the chain, giving up if a link leaves the slab */
+		rh_mem_link *next = rh_lf_pool_at(p, RH_LF_POOL_TOP(old));
+		for (got = 0;got < n && next && rh_lf_pool_owns(p, next);++got) {
+			mem[got] = next;
+			next = __atomic_load_n(&next->link, __ATOMIC_RELAXED);
+		}
+		if (next && !rh_lf_pool_owns(p, next)) {
+			got = 0;
+			old = atomic_load_explicit(&p->head, memory_order_acquire);
+			continue;
+		}
+		if (atomic_compare_exchange_weak_explicit(&p->head, &old
+				, rh_lf_pool_head(old, rh_lf_pool_index(p, next))
+				, memory_order_acquire, memory_order_acquire)) {
+			break;
+		}
+		got = 0;
+	}
+
+	for (;got < n;++got) {
+		if (!(mem[got] = malloc(p->size))) {
+			break;
+		}
+	}
+	return got;
+}
+
+// Links the slab objects among mem into a chain pushed with one CAS
+static inline void rh_lf_pool_free_n(rh_lf_pool *p, void **mem, size_t n) {
+	rh_mem_link *first = NULL, *last = NULL;
+	for (size_t i = 0;i < n;++i) {
+		if (!mem[i]) {
+			continue;
+		}
+		if (!rh_lf_pool_owns(p, mem[i])) {
+			free(mem[i]);
+			continue;
+		}
+
+		rh_mem_link *l = mem[i];
+		l->link = first;
+		first = l;
+		last = last ?: l;
+	}
+
+	if (first) {
+		rh_lf_pool_push(p, first, last);
+	}
+}
+
+#endif
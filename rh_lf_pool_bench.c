@@ -0,0 +1,165 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_lf_pool.h"
+#include "rh_bench.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+typedef struct {
+	uint64_t key;
+	void *left, *right;
+} node;
+
+#define PAIRS (1 << 22)
+#define LIVE 64
+#define BATCH 32
+#define MAX_THREADS 16
+
+enum { LOCK_FREE, MUTEX };
+
+typedef struct {
+	int kind;
+	int batch;
+	size_t pairs;
+} thread_arg;
+
+static rh_lf_pool lf;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static rh_mem_link *locked = NULL;
+static rh_slab *locked_slabs = NULL;
+
+static void *pool_alloc(int kind) {
+	if (kind == LOCK_FREE) {
+		return rh_lf_pool_alloc(&lf);
+	}
+
+	pthread_mutex_lock(&lock);
+	void *mem = rh_slab_alloc(&locked, &locked_slabs, RH_SLAB_CHUNK
+			, sizeof(node), sizeof(void *));
+	pthread_mutex_unlock(&lock);
+	return mem;
+}
+
+static void pool_free(int kind, void *mem) {
+	if (kind == LOCK_FREE) {
+		rh_lf_pool_free(&lf, mem);
+		return;
+	}
+
+	if (mem) {
+		pthread_mutex_lock(&lock);
+		rh_pool_free(&locked, mem);
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+static void pool_alloc_n(int kind, void **mem, size_t n) {
+	if (kind == LOCK_FREE) {
+		rh_lf_pool_alloc_n(&lf, mem, n);
+		return;
+	}
+
+	pthread_mutex_lock(&lock);
+	for (size_t i = 0;i < n;++i) {
+		mem[i] = rh_slab_alloc(&locked, &locked_slabs, RH_SLAB_CHUNK
+				, sizeof(node), sizeof(void *));
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+static void pool_free_n(int kind, void **mem, size_t n) {
+	if (kind == LOCK_FREE) {
+		rh_lf_pool_free_n(&lf, mem, n);
+		return;
+	}
+
+	pthread_mutex_lock(&lock);
+	for (size_t i = 0;i < n;++i) {
+		rh_pool_free(&locked, mem[i]);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+// Keeps LIVE objects, replacing the oldest one (or BATCH) at a time
+static void *worker(void *arg) {
+	thread_arg *a = arg;
+	node *live[LIVE] = {0};
+	if (!a->batch) {
+		for (size_t i = 0;i < a->pairs;++i) {
+			pool_free(a->kind, live[i % LIVE]);
+			live[i % LIVE] = pool_alloc(a->kind);
+			live[i % LIVE]->key = i;
+		}
+	} else {
+		pool_alloc_n(a->kind, (void **) live, LIVE);
+		for (size_t i = 0;i < a->pairs;i += BATCH) {
+			void **batch = (void **) &live[i % LIVE];
+			pool_free_n(a->kind, batch, BATCH);
+			pool_alloc_n(a->kind, batch, BATCH);
+			live[i % LIVE]->key = i;
+		}
+	}
+	for (size_t i = 0;i < LIVE;++i) {
+		pool_free(a->kind, live[i]);
+	}
+	return NULL;
+}
+
+static void run(int threads, int kind, int batch) {
+	static pthread_t tids[MAX_THREADS];
+	static thread_arg args[MAX_THREADS];
+
+	uint64_t start = rh_bench_now();
+	for (int i = 0;i < threads;++i) {
+		args[i] = (thread_arg) {kind, batch, PAIRS / threads};
+		pthread_create(&tids[i], NULL, worker, &args[i]);
+	}
+	for (int i = 0;i < threads;++i) {
+		pthread_join(tids[i], NULL);
+	}
+	uint64_t end = rh_bench_now();
+
+	char label[64];
+	snprintf(label, sizeof(label), "%s%s %d threads"
+			, kind == LOCK_FREE ? "lock free" : "mutex"
+			, batch ? " batch" : "", threads);
+	rh_bench_report(label, (PAIRS / threads) * threads, end - start);
+}
+
+int main() {
+	// Sized so that every thread's live objects fit in the slab
+	rh_lf_pool_init(&lf, sizeof(node), MAX_THREADS * LIVE, sizeof(void *));
+
+	for (int t = 1;t <= MAX_THREADS;t *= 2) {
+		run(t, LOCK_FREE, 0);
+		run(t, MUTEX, 0);
+		run(t, LOCK_FREE, 1);
+		run(t, MUTEX, 1);
+	}
+
+	rh_lf_pool_freeall(&lf);
+	rh_slab_freeall(&locked, &locked_slabs);
+	return 0;
+}
@@ -0,0 +1,210 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_lf_pool.h"
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+// Objects carry the id of the thread holding them after the free list link
+typedef struct {
+	rh_mem_link link;
+	_Atomic uint64_t owner;
+} object;
+
+int exhaust(void) {
+	rh_lf_pool p;
+	// Rounded up to a multiple of the alignment
+	if (!rh_lf_pool_init(&p, 20, 8, 64) || p.size != 64) {
+		ERROR_MSG("Init test FAILED!");
+		return 1;
+	}
+
+	void *mem[10];
+	int errors = 0;
+	for (int i = 0;i < 8;++i) {
+		mem[i] = rh_lf_pool_alloc(&p);
+		errors += !rh_lf_pool_owns(&p, mem[i]);
+		errors += (uintptr_t) mem[i] % 64 != 0;
+		for (int j = 0;j < i;++j) {
+			errors += mem[i] == mem[j];
+		}
+	}
+	// Exhausted, so from malloc
+	mem[8] = rh_lf_pool_alloc(&p);
+	errors += !mem[8] || rh_lf_pool_owns(&p, mem[8]);
+	rh_lf_pool_free_n(&p, mem, 9);
+
+	// Batches take what the slab has and malloc the rest
+	errors += rh_lf_pool_alloc_n(&p, mem, 10) != 10;
+	for (int i = 0;i < 10;++i) {
+		errors += rh_lf_pool_owns(&p, mem[i]) != (i < 8);
+	}
+	for (int i = 0;i < 10;++i) {
+		rh_lf_pool_free(&p, mem[i]);
+	}
+	rh_lf_pool_free(&p, NULL);
+	errors += rh_lf_pool_alloc_n(&p, mem, 8) != 8;
+	for (int i = 0;i < 8;++i) {
+		errors += !rh_lf_pool_owns(&p, mem[i]);
+	}
+	rh_lf_pool_freeall(&p);
+	if (errors) {
+		ERROR_MSG("Exhaust test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+// Threads keep up to LIVE objects each, more in total than the slab holds,
+// allocating and freeing singly and in batches; no slab object may be held
+// by two threads at once
+#define THREADS 4
+#define COUNT 100
+#define LIVE 32
+#define ROUNDS (1 << 15)
+
+static rh_lf_pool pool;
+static _Atomic int errors;
+
+static void take(uint64_t id, object *o) {
+	if (rh_lf_pool_owns(&pool, o)) {
+		uint64_t none = 0;
+		if (!atomic_compare_exchange_strong(&o->owner, &none, id)) {
+			atomic_fetch_add(&errors, 1);
+		}
+	}
+}
+
+static void give(uint64_t id, object *o) {
+	if (rh_lf_pool_owns(&pool, o)) {
+		uint64_t held = id;
+		if (!atomic_compare_exchange_strong(&o->owner, &held, 0)) {
+			atomic_fetch_add(&errors, 1);
+		}
+	}
+}
+
+static void *worker(void *arg) {
+	uint64_t id = (uintptr_t) arg;
+	uint64_t seed = id * 0x9E3779B97F4A7C15LU;
+	void *live[LIVE];
+	size_t no_live = 0;
+
+	for (size_t r = 0;r < ROUNDS;++r) {
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		size_t n = 1 + seed % 8;
+		int batch = seed >> 8 & 1;
+
+		if (seed >> 9 & 1 && no_live + n <= LIVE) {
+			void **mem = live + no_live;
+			if (batch) {
+				n = rh_lf_pool_alloc_n(&pool, mem, n);
+			} else {
+				for (size_t i = 0;i < n;++i) {
+					mem[i] = rh_lf_pool_alloc(&pool);
+				}
+			}
+			for (size_t i = 0;i < n;++i) {
+				take(id, mem[i]);
+			}
+			no_live += n;
+		} else {
+			n = n < no_live ? n : no_live;
+			no_live -= n;
+			void **mem = live + no_live;
+			for (size_t i = 0;i < n;++i) {
+				give(id, mem[i]);
+			}
+			if (batch) {
+				rh_lf_pool_free_n(&pool, mem, n);
+			} else {
+				for (size_t i = 0;i < n;++i) {
+					rh_lf_pool_free(&pool, mem[i]);
+				}
+			}
+		}
+
+		// Interleave the threads even on a single CPU
+		if (!(r % 256)) {
+			sched_yield();
+		}
+	}
+
+	for (size_t i = 0;i < no_live;++i) {
+		give(id, live[i]);
+	}
+	rh_lf_pool_free_n(&pool, live, no_live);
+	return NULL;
+}
+
+int stress(void) {
+	if (!rh_lf_pool_init(&pool, sizeof(object), COUNT, _Alignof(object))) {
+		ERROR_MSG("Stress init test FAILED!");
+		return 1;
+	}
+	for (size_t i = 0;i < COUNT;++i) {
+		object *o = (object *) (pool.base + i * pool.size);
+		atomic_init(&o->owner, 0);
+	}
+
+	pthread_t threads[THREADS];
+	for (uintptr_t i = 0;i < THREADS;++i) {
+		pthread_create(&threads[i], NULL, worker, (void *) (i + 1));
+	}
+	for (int i = 0;i < THREADS;++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	// Everything is back, so the whole slab comes out in one batch
+	void *mem[COUNT];
+	size_t lost = 0;
+	rh_lf_pool_alloc_n(&pool, mem, COUNT);
+	for (size_t i = 0;i < COUNT;++i) {
+		lost += !rh_lf_pool_owns(&pool, mem[i]);
+	}
+	rh_lf_pool_free_n(&pool, mem, COUNT);
+	rh_lf_pool_freeall(&pool);
+	if (errors || lost) {
+		ERROR_MSG("Stress test FAILED! %d objects shared, %zu lost"
+				, errors, lost);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += exhaust();
+	no_errors += stress();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -22,6 +22,11 @@
 #ifndef RH_MAT_H
 #define RH_MAT_H
 
+#include <stddef.h>
+
+#include "rh_simd.h"
+
+// Matrices are row major, array[row][column], and vectors are columns
 #define RH_IMPL_SIZED_MAT(NAME, SIZE, TYPE)					\
 static inline NAME NAME##_add(const NAME a, const NAME b) {			\
 	NAME c;									\
@@ -54,13 +59,18 @@ static inline NAME NAME##_scale(const NAME a, const TYPE factor) {		\
 }										\
 static inline NAME NAME##_mul(const NAME a, const NAME b) {			\
 	NAME c;									\
-	for (int x = 0;x < SIZE;++x) {						\
+	if (RH_SIMD_4(SIZE, TYPE)) {						\
+		RH_SIMD_FN(TYPE, mul4)((void *) c.flat				\
+				, (const void *) a.flat, (const void *) b.flat);\
+		return c;							\
+	}									\
 	for (int y = 0;y < SIZE;++y) {						\
+	for (int x = 0;x < SIZE;++x) {						\
 		TYPE acc = 0;							\
 		for (int i = 0;i < SIZE;++i) {					\
 			acc += a.array[y][i] * b.array[i][x];			\
 		}								\
-		c.array[x][y] = acc;						\
+		c.array[y][x] = acc;						\
 	}									\
 	}									\
 	return c;								\
@@ -72,6 +82,193 @@ static inline TYPE NAME##_sum(const NAME a) {					\
 	}									\
 	return sum;								\
 }										\
+static inline NAME NAME##_identity(void) {					\
+	NAME c = {0};								\
+	for (int i = 0;i < SIZE;++i) {						\
+		c.array[i][i] = 1;						\
+	}									\
+	return c;								\
+}										\
+static inline NAME NAME##_transpose(const NAME a) {				\
+	NAME c;									\
+	for (int y = 0;y < SIZE;++y) {						\
+	for (int x = 0;x < SIZE;++x) {						\
+		c.array[y][x] = a.array[x][y];					\
+	}									\
+	}									\
+	return c;								\
+}										\
+/* c[i] = a[i] * b[i], where c may be a or b */					\
+static inline void NAME##_mul_n(NAME *c, const NAME *a, const NAME *b		\
+		, size_t n) {							\
+	if (RH_SIMD_4(SIZE, TYPE)) {						\
+		for (size_t i = 0;i < n;++i) {					\
+			RH_SIMD_FN(TYPE, mul4)((void *) c[i].flat		\
+					, (const void *) a[i].flat		\
+					, (const void *) b[i].flat);		\
+		}								\
+		return;								\
+	}									\
+	for (size_t i = 0;i < n;++i) {						\
+		c[i] = NAME##_mul(a[i], b[i]);					\
+	}									\
+}										\
+
+// Determinants and inverses written out for each size; inverses return 0,
+// leaving c alone, when a is singular
+// Affine inverses take the last row to be 0 ... 0 1, inverting only the
+// upper left block, so are cheaper and better conditioned
+// [R t; 0 1]^-1 = [R^-1 -R^-1 t; 0 1]
+#define RH_IMPL_2_MAT(NAME, TYPE)						\
+static inline TYPE NAME##_det(const NAME a) {					\
+	return a.array[0][0] * a.array[1][1] - a.array[0][1] * a.array[1][0];	\
+}										\
+static inline int NAME##_inv(NAME *c, const NAME a) {				\
+	TYPE det = NAME##_det(a);						\
+	if (det == 0) {								\
+		return 0;							\
+	}									\
+	TYPE r = 1 / det;							\
+	*c = (NAME) {{								\
+		{a.array[1][1] * r, -a.array[0][1] * r},			\
+		{-a.array[1][0] * r, a.array[0][0] * r},			\
+	}};									\
+	return 1;								\
+}										\
+
+#define RH_IMPL_3_MAT(NAME, TYPE)						\
+static inline TYPE NAME##_det(const NAME a) {					\
+	const TYPE (*m)[3] = a.array;						\
+	return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])		\
+		- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])		\
+		+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);		\
+}										\
+static inline int NAME##_inv(NAME *c, const NAME a) {				\
+	const TYPE (*m)[3] = a.array;						\
+	TYPE c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];			\
+	TYPE c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];			\
+	TYPE c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];			\
+	TYPE det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;		\
+	if (det == 0) {								\
+		return 0;							\
+	}									\
+	TYPE r = 1 / det;							\
+	*c = (NAME) {{								\
+		{c00 * r, (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * r		\
+			, (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * r},		\
+		{c01 * r, (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * r		\
+			, (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * r},		\
+		{c02 * r, (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * r		\
+			, (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * r},		\
+	}};									\
+	return 1;								\
+}										\
+static inline int NAME##_inv_affine(NAME *c, const NAME a) {			\
+	const TYPE (*m)[3] = a.array;						\
+	TYPE det = m[0][0] * m[1][1] - m[0][1] * m[1][0];			\
+	if (det == 0) {								\
+		return 0;							\
+	}									\
+	TYPE r = 1 / det;							\
+	TYPE i00 = m[1][1] * r, i01 = -m[0][1] * r;				\
+	TYPE i10 = -m[1][0] * r, i11 = m[0][0] * r;				\
+	*c = (NAME) {{								\
+		{i00, i01, -(i00 * m[0][2] + i01 * m[1][2])},			\
+		{i10, i11, -(i10 * m[0][2] + i11 * m[1][2])},			\
+		{0, 0, 1},							\
+	}};									\
+	return 1;								\
+}
+
+#define RH_IMPL_4_MAT(NAME, TYPE)						\
+static inline TYPE NAME##_det(const NAME a) {					\
+	const TYPE (*m)[4] = a.array;						\
+	TYPE s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];			\
+	TYPE s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];			\
+	TYPE s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];			\
+	TYPE s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];			\
+	TYPE s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];			\
+	TYPE s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];			\
+	TYPE c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];			\
+	TYPE c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];			\
+	TYPE c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];			\
+	TYPE c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];			\
+	TYPE c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];			\
+	TYPE c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];			\
+	return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;	\
+}										\
+/* From the 2x2 minors of the top and bottom row pairs */			\
+static inline int NAME##_inv(NAME *c, const NAME a) {				\
+	if (RH_SIMD_4F(4, TYPE)) {						\
+		return rh_simd_inv4f((void *) c->flat, (const void *) a.flat);	\
+	}									\
+	const TYPE (*m)[4] = a.array;						\
+	TYPE s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];			\
+	TYPE s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];			\
+	TYPE s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];			\
+	TYPE s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];			\
+	TYPE s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];			\
+	TYPE s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];			\
+	TYPE c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];			\
+	TYPE c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];			\
+	TYPE c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];			\
+	TYPE c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];			\
+	TYPE c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];			\
+	TYPE c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];			\
+	TYPE det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;	\
+	if (det == 0) {								\
+		return 0;							\
+	}									\
+	TYPE r = 1 / det;							\
+	*c = (NAME) {{								\
+		{(m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * r		\
+		, (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * r		\
+		, (m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * r		\
+		, (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * r},		\
+		{(-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * r		\
+		, (m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * r		\
+		, (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * r		\
+		, (m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * r},		\
+		{(m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * r		\
+		, (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * r		\
+		, (m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * r		\
+		, (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * r},		\
+		{(-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * r		\
+		, (m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * r		\
+		, (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * r		\
+		, (m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * r},		\
+	}};									\
+	return 1;								\
+}										\
+static inline int NAME##_inv_affine(NAME *c, const NAME a) {			\
+	const TYPE (*m)[4] = a.array;						\
+	TYPE c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];			\
+	TYPE c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];			\
+	TYPE c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];			\
+	TYPE det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;		\
+	if (det == 0) {								\
+		return 0;							\
+	}									\
+	TYPE r = 1 / det;							\
+	TYPE i00 = c00 * r;							\
+	TYPE i01 = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * r;			\
+	TYPE i02 = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * r;			\
+	TYPE i10 = c01 * r;							\
+	TYPE i11 = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * r;			\
+	TYPE i12 = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * r;			\
+	TYPE i20 = c02 * r;							\
+	TYPE i21 = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * r;			\
+	TYPE i22 = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * r;			\
+	TYPE x = m[0][3], y = m[1][3], z = m[2][3];				\
+	*c = (NAME) {{								\
+		{i00, i01, i02, -(i00 * x + i01 * y + i02 * z)},		\
+		{i10, i11, i12, -(i10 * x + i11 * y + i12 * z)},		\
+		{i20, i21, i22, -(i20 * x + i21 * y + i22 * z)},		\
+		{0, 0, 0, 1},							\
+	}};									\
+	return 1;								\
+}
+
 
 #define RH_MAT_DEF(TYPE)				\
 	typedef union {					\
@@ -92,7 +289,131 @@ static inline TYPE NAME##_sum(const NAME a) {					\
 #define RH_MAT_IMPL(TYPE)				\
 	RH_IMPL_SIZED_MAT(m2##TYPE, 2, TYPE);		\
 	RH_IMPL_SIZED_MAT(m3##TYPE, 3, TYPE);		\
-	RH_IMPL_SIZED_MAT(m4##TYPE, 4, TYPE);
+	RH_IMPL_SIZED_MAT(m4##TYPE, 4, TYPE);		\
+	RH_IMPL_2_MAT(m2##TYPE, TYPE);			\
+	RH_IMPL_3_MAT(m3##TYPE, TYPE);			\
+	RH_IMPL_4_MAT(m4##TYPE, TYPE);
+
+// Matrix vector products, m * v, needing both RH_VEC_DEF and RH_MAT_DEF
+#define RH_IMPL_SIZED_MAT_VEC(NAME, VEC, SIZE, TYPE)				\
+static inline VEC NAME##_mul_vec(const NAME m, const VEC v) {			\
+	VEC c;									\
+	if (RH_SIMD_4(SIZE, TYPE)) {						\
+		RH_SIMD_FN(TYPE, mul_vec4)((void *) c.array			\
+				, (const void *) m.flat, (const void *) v.array);\
+		return c;							\
+	}									\
+	for (int y = 0;y < SIZE;++y) {						\
+		TYPE acc = 0;							\
+		for (int i = 0;i < SIZE;++i) {					\
+			acc += m.array[y][i] * v.array[i];			\
+		}								\
+		c.array[y] = acc;						\
+	}									\
+	return c;								\
+}										\
+
+// Affine transforms of points (w = 1) and directions (w = 0) by a SIZE
+// matrix, with VEC one smaller; no perspective divide is done
+#define RH_IMPL_AFFINE_MAT_VEC(NAME, VEC, SIZE, TYPE)				\
+static inline VEC NAME##_mul_point(const NAME m, const VEC v) {			\
+	VEC c;									\
+	for (int y = 0;y < SIZE - 1;++y) {					\
+		TYPE acc = 0;							\
+		for (int i = 0;i < SIZE - 1;++i) {				\
+			acc += m.array[y][i] * v.array[i];			\
+		}								\
+		c.array[y] = acc + m.array[y][SIZE - 1];			\
+	}									\
+	return c;								\
+}										\
+static inline VEC NAME##_mul_dir(const NAME m, const VEC v) {			\
+	VEC c;									\
+	for (int y = 0;y < SIZE - 1;++y) {					\
+		TYPE acc = 0;							\
+		for (int i = 0;i < SIZE - 1;++i) {				\
+			acc += m.array[y][i] * v.array[i];			\
+		}								\
+		c.array[y] = acc;						\
+	}									\
+	return c;								\
+}										\
+
+// Transforms a whole batch, c = m * a, with w taken as 1 for v3 batches so
+// that an affine m moves points; returns 0 only if c could not be grown
+#define RH_IMPL_MAT_VEC_BATCH(NAME, BATCH, SIZE, TYPE)				\
+static inline int NAME##_mul_##BATCH(BATCH *c, const NAME m, const BATCH *a) {	\
+	size_t n = a->count;							\
+	if (!BATCH##_fit(c, n)) {						\
+		return 0;							\
+	}									\
+	RH_SIMD_SPAN_FN(TYPE, transform_n)(c->array, m.flat			\
+			, (const void *) a->array, SIZE, 0, n);			\
+	return 1;								\
+}										\
+
+// Rotation matrices of unit quaternions, with m * v = rotate(q, v), and back
+// from the rotation part of a matrix, by the largest of w, x, y and z to
+// keep the division well conditioned
+#define RH_IMPL_QUAT_MAT(NAME, M3, M4, TYPE)					\
+static inline M3 NAME##_to_m3(const NAME q) {					\
+	TYPE xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;			\
+	TYPE xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;			\
+	TYPE wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;			\
+	return (M3) {{								\
+		{1 - 2 * (yy + zz), 2 * (xy - wz), 2 * (xz + wy)},		\
+		{2 * (xy + wz), 1 - 2 * (xx + zz), 2 * (yz - wx)},		\
+		{2 * (xz - wy), 2 * (yz + wx), 1 - 2 * (xx + yy)},		\
+	}};									\
+}										\
+static inline M4 NAME##_to_m4(const NAME q) {					\
+	M3 r = NAME##_to_m3(q);							\
+	M4 c = {0};								\
+	for (int y = 0;y < 3;++y) {						\
+		for (int x = 0;x < 3;++x) {					\
+			c.array[y][x] = r.array[y][x];				\
+		}								\
+	}									\
+	c.array[3][3] = 1;							\
+	return c;								\
+}										\
+static inline NAME NAME##_from_rows(const TYPE *r0, const TYPE *r1		\
+		, const TYPE *r2) {						\
+	TYPE tr = r0[0] + r1[1] + r2[2];					\
+	TYPE s;									\
+	if (tr > 0) {								\
+		s = 2 * sqrt(tr + 1);						\
+		return (NAME) {{(r2[1] - r1[2]) / s, (r0[2] - r2[0]) / s	\
+			, (r1[0] - r0[1]) / s, s / 4}};				\
+	} else if (r0[0] > r1[1] && r0[0] > r2[2]) {				\
+		s = 2 * sqrt(1 + r0[0] - r1[1] - r2[2]);			\
+		return (NAME) {{s / 4, (r0[1] + r1[0]) / s			\
+			, (r0[2] + r2[0]) / s, (r2[1] - r1[2]) / s}};		\
+	} else if (r1[1] > r2[2]) {						\
+		s = 2 * sqrt(1 + r1[1] - r0[0] - r2[2]);			\
+		return (NAME) {{(r0[1] + r1[0]) / s, s / 4			\
+			, (r1[2] + r2[1]) / s, (r0[2] - r2[0]) / s}};		\
+	}									\
+	s = 2 * sqrt(1 + r2[2] - r0[0] - r1[1]);				\
+	return (NAME) {{(r0[2] + r2[0]) / s, (r1[2] + r2[1]) / s		\
+		, s / 4, (r1[0] - r0[1]) / s}};					\
+}										\
+static inline NAME NAME##_from_m3(const M3 m) {					\
+	return NAME##_from_rows(m.array[0], m.array[1], m.array[2]);		\
+}										\
+static inline NAME NAME##_from_m4(const M4 m) {					\
+	return NAME##_from_rows(m.array[0], m.array[1], m.array[2]);		\
+}										\
+
+#define RH_MAT_VEC_IMPL(TYPE)							\
+	RH_IMPL_SIZED_MAT_VEC(m2##TYPE, v2##TYPE, 2, TYPE);			\
+	RH_IMPL_SIZED_MAT_VEC(m3##TYPE, v3##TYPE, 3, TYPE);			\
+	RH_IMPL_SIZED_MAT_VEC(m4##TYPE, v4##TYPE, 4, TYPE);			\
+	RH_IMPL_AFFINE_MAT_VEC(m3##TYPE, v2##TYPE, 3, TYPE);			\
+	RH_IMPL_AFFINE_MAT_VEC(m4##TYPE, v3##TYPE, 4, TYPE);			\
+	RH_IMPL_QUAT_MAT(q##TYPE, m3##TYPE, m4##TYPE, TYPE);			\
+	RH_IMPL_MAT_VEC_BATCH(m4##TYPE, v3##TYPE##_batch, 3, TYPE);		\
+	RH_IMPL_MAT_VEC_BATCH(m4##TYPE, v4##TYPE##_batch, 4, TYPE);
 
 #define RH_MAT_MAKE(TYPE)					\
 	RH_MAT_DEF(TYPE);					\
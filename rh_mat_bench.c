@@ -0,0 +1,186 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_vec.h"
+#include "rh_mat.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+#include <math.h>
+
+RH_VEC_MAKE(float);
+RH_VEC_MAKE(double);
+RH_MAT_MAKE(float);
+RH_MAT_MAKE(double);
+RH_MAT_VEC_IMPL(float);
+RH_MAT_VEC_IMPL(double);
+
+#define COUNT 1024
+#define ROUNDS 1024
+
+// Gauss-Jordan with partial pivoting, the usual general purpose inverse
+#define GAUSS(NAME, SIZE, TYPE)							\
+static inline int gauss_##NAME(NAME *c, const NAME a) {				\
+	NAME m = a, inv = NAME##_identity();					\
+	for (int col = 0;col < SIZE;++col) {					\
+		int pivot = col;						\
+		for (int y = col + 1;y < SIZE;++y) {				\
+			if (fabs(m.array[y][col]) > fabs(m.array[pivot][col])) {\
+				pivot = y;					\
+			}							\
+		}								\
+		if (m.array[pivot][col] == 0) {					\
+			return 0;						\
+		}								\
+		for (int x = 0;x < SIZE;++x) {					\
+			TYPE t = m.array[col][x];				\
+			m.array[col][x] = m.array[pivot][x];			\
+			m.array[pivot][x] = t;					\
+			t = inv.array[col][x];					\
+			inv.array[col][x] = inv.array[pivot][x];		\
+			inv.array[pivot][x] = t;				\
+		}								\
+		TYPE scale = 1 / m.array[col][col];				\
+		for (int x = 0;x < SIZE;++x) {					\
+			m.array[col][x] *= scale;				\
+			inv.array[col][x] *= scale;				\
+		}								\
+		for (int y = 0;y < SIZE;++y) {					\
+			if (y == col) {						\
+				continue;					\
+			}							\
+			TYPE f = m.array[y][col];				\
+			for (int x = 0;x < SIZE;++x) {				\
+				m.array[y][x] -= f * m.array[col][x];		\
+				inv.array[y][x] -= f * inv.array[col][x];	\
+			}							\
+		}								\
+	}									\
+	*c = inv;								\
+	return 1;								\
+}
+
+GAUSS(m3float, 3, float)
+GAUSS(m4float, 4, float)
+GAUSS(m3double, 3, double)
+GAUSS(m4double, 4, double)
+
+#define BENCH(NAME, SIZE)							\
+static void bench_##NAME(void) {						\
+	static NAME mats[COUNT], out[COUNT];					\
+	uint64_t seed = SIZE;							\
+	for (size_t i = 0;i < COUNT;++i) {					\
+		mats[i] = NAME##_identity();					\
+		for (int y = 0;y < SIZE - 1;++y) {				\
+		for (int x = 0;x < SIZE;++x) {					\
+			mats[i].array[y][x] += (rh_bench_rand(&seed) >> 40)	\
+				* 0x1p-24;					\
+		}								\
+		}								\
+	}									\
+										\
+	double check = 0;							\
+	uint64_t ops = (uint64_t) COUNT * ROUNDS;				\
+	uint64_t start, end;							\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			out[i] = NAME##_transpose(mats[i]);			\
+		}								\
+		check += out[r & (COUNT - 1)].flat[1];				\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report(#NAME " transpose", ops, end - start);			\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			check += NAME##_det(mats[i]);				\
+		}								\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report(#NAME " det", ops, end - start);			\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			NAME##_inv(&out[i], mats[i]);				\
+		}								\
+		check += out[r & (COUNT - 1)].flat[1];				\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report(#NAME " inv", ops, end - start);			\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			NAME##_inv_affine(&out[i], mats[i]);			\
+		}								\
+		check += out[r & (COUNT - 1)].flat[1];				\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report(#NAME " inv_affine", ops, end - start);			\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			gauss_##NAME(&out[i], mats[i]);				\
+		}								\
+		check += out[r & (COUNT - 1)].flat[1];				\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report(#NAME " inv gauss-jordan", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		NAME##_mul_n(out, mats, out, COUNT);				\
+		check += out[r & (COUNT - 1)].flat[1];				\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report(#NAME " mul_n", ops, end - start);			\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			out[i] = NAME##_mul(mats[i], out[i]);			\
+		}								\
+		check += out[r & (COUNT - 1)].flat[1];				\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report(#NAME " mul loop", ops, end - start);			\
+										\
+	rh_bench_use(check);							\
+}
+
+BENCH(m3float, 3)
+BENCH(m4float, 4)
+BENCH(m3double, 3)
+BENCH(m4double, 4)
+
+int main() {
+	bench_m3float();
+	bench_m4float();
+	bench_m3double();
+	bench_m4double();
+	return 0;
+}
@@ -0,0 +1,201 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_vec.h"
+#include "rh_mat.h"
+#include "rh_bench.h"
+
+#include <stdio.h>
+#include <math.h>
+
+RH_VEC_MAKE(float);
+RH_VEC_MAKE(double);
+RH_MAT_MAKE(float);
+RH_MAT_MAKE(double);
+RH_MAT_VEC_IMPL(float);
+RH_MAT_VEC_IMPL(double);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+#define ROUNDS 1000
+
+// Diagonally dominant, so always well conditioned
+static double rand_val(uint64_t *seed) {
+	return (rh_bench_rand(seed) >> 11) * (2.0 / (1LU << 53)) - 1;
+}
+
+#define RAND_MAT(NAME, SIZE)							\
+static NAME rand_##NAME(uint64_t *seed) {					\
+	NAME m;									\
+	for (int y = 0;y < SIZE;++y) {						\
+	for (int x = 0;x < SIZE;++x) {						\
+		m.array[y][x] = rand_val(seed) + (x == y ? SIZE * 2 : 0);	\
+	}									\
+	}									\
+	return m;								\
+}										\
+										\
+static double max_diff_##NAME(const NAME a, const NAME b) {			\
+	double max = 0;								\
+	for (int i = 0;i < SIZE * SIZE;++i) {					\
+		double d = fabs((double) a.flat[i] - b.flat[i]);		\
+		max = d > max ? d : max;					\
+	}									\
+	return max;								\
+}
+
+RAND_MAT(m2float, 2)
+RAND_MAT(m3float, 3)
+RAND_MAT(m4float, 4)
+RAND_MAT(m2double, 2)
+RAND_MAT(m3double, 3)
+RAND_MAT(m4double, 4)
+
+#define CHECK_INV(NAME, SIZE, EPS)						\
+int inv_##NAME(void) {								\
+	uint64_t seed = SIZE;							\
+	double worst = 0;							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		NAME m = rand_##NAME(&seed), inv;				\
+		if (!NAME##_inv(&inv, m)) {					\
+			worst = INFINITY;					\
+			break;							\
+		}								\
+		double d = max_diff_##NAME(NAME##_mul(m, inv), NAME##_identity());\
+		worst = d > worst ? d : worst;					\
+		d = fabs(NAME##_det(m) * NAME##_det(inv) - 1);			\
+		worst = d > worst ? d : worst;					\
+		d = max_diff_##NAME(NAME##_transpose(NAME##_transpose(m)), m);	\
+		worst = d > worst ? d : worst;					\
+	}									\
+										\
+	NAME zero = {0}, untouched = NAME##_identity();				\
+	if (worst > EPS || NAME##_inv(&untouched, zero)				\
+	|| !NAME##_eq(untouched, NAME##_identity())) {				\
+		ERROR_MSG(#NAME " inverse test FAILED! worst %g", worst);	\
+		return 1;							\
+	}									\
+	return 0;								\
+}
+
+CHECK_INV(m2float, 2, 1e-5)
+CHECK_INV(m3float, 3, 1e-5)
+CHECK_INV(m4float, 4, 1e-5)
+CHECK_INV(m2double, 2, 1e-12)
+CHECK_INV(m3double, 3, 1e-12)
+CHECK_INV(m4double, 4, 1e-12)
+
+int transpose_det(void) {
+	m3double m = {{{1, 2, 3}, {4, 5, 6}, {7, 8, 10}}};
+	m3double t = m3double_transpose(m);
+	m4float n = {{{2, 0, 0, 1}, {0, 3, 0, 2}, {0, 0, 4, 3}, {0, 0, 0, 1}}};
+	if (t.array[0][1] != 4 || t.array[2][0] != 3 || m3double_det(m) != -3
+	|| m3double_det(t) != -3 || m4float_det(n) != 24
+	|| m2float_det((m2float) {{{1, 2}, {3, 4}}}) != -2) {
+		ERROR_MSG("Transpose and det test FAILED!");
+		return 1;
+	}
+	return 0;
+}
+
+// A rotation about z, a scale and a translation
+#define CHECK_AFFINE(TYPE, EPS)							\
+int affine_##TYPE(void) {							\
+	TYPE c = cos(0.3), s = sin(0.3);					\
+	m4##TYPE m = {{{c * 2, -s * 2, 0, 5}, {s * 2, c * 2, 0, -1}		\
+			, {0, 0, 0.5, 2}, {0, 0, 0, 1}}};			\
+	m4##TYPE ai, gi;							\
+	m3##TYPE m2 = {{{c, -s, 3}, {s, c, 4}, {0, 0, 1}}}, a2i, g2i;		\
+	v3##TYPE p = {{1, 2, 3}};						\
+	v3##TYPE q = m4##TYPE##_mul_point(m, p);				\
+	v3##TYPE back = m4##TYPE##_mul_point(					\
+			(m4##TYPE##_inv_affine(&ai, m), ai), q);		\
+	v3##TYPE d = m4##TYPE##_mul_dir(m, p);					\
+	v4##TYPE h = m4##TYPE##_mul_vec(m, (v4##TYPE) {{1, 2, 3, 1}});		\
+	m4##TYPE##_inv(&gi, m);							\
+	m3##TYPE##_inv_affine(&a2i, m2);					\
+	m3##TYPE##_inv(&g2i, m2);						\
+										\
+	if (max_diff_m4##TYPE(ai, gi) > EPS || max_diff_m3##TYPE(a2i, g2i) > EPS\
+	|| fabs(back.x - 1) > EPS || fabs(back.y - 2) > EPS			\
+	|| fabs(back.z - 3) > EPS || !v3##TYPE##_eq(q, h.vec3)			\
+	|| fabs(d.x - (q.x - 5)) > EPS || fabs(d.z - (q.z - 2)) > EPS) {	\
+		ERROR_MSG(#TYPE " affine test FAILED!");			\
+		return 1;							\
+	}									\
+	return 0;								\
+}
+
+CHECK_AFFINE(float, 1e-5)
+CHECK_AFFINE(double, 1e-12)
+
+int mul_n(void) {
+	uint64_t seed = 99;
+	m4float a[7], b[7], c[7], want[7];
+	m3double d[5], e[5];
+	for (int i = 0;i < 7;++i) {
+		a[i] = rand_m4float(&seed);
+		b[i] = rand_m4float(&seed);
+		want[i] = m4float_mul(a[i], b[i]);
+	}
+	m4float_mul_n(c, a, b, 7);
+	// In place on both sides
+	m4float_mul_n(a, a, b, 7);
+	int errors = 0;
+	for (int i = 0;i < 7;++i) {
+		errors += !m4float_eq(c[i], want[i]) + !m4float_eq(a[i], want[i]);
+	}
+	for (int i = 0;i < 5;++i) {
+		d[i] = rand_m3double(&seed);
+		e[i] = rand_m3double(&seed);
+	}
+	m3double want3 = m3double_mul(d[4], e[4]);
+	m3double_mul_n(e, d, e, 5);
+	errors += !m3double_eq(e[4], want3);
+
+	if (errors) {
+		ERROR_MSG("Mul n test FAILED! %d mismatches", errors);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += inv_m2float();
+	no_errors += inv_m3float();
+	no_errors += inv_m4float();
+	no_errors += inv_m2double();
+	no_errors += inv_m3double();
+	no_errors += inv_m4double();
+	no_errors += transpose_det();
+	no_errors += affine_float();
+	no_errors += affine_double();
+	no_errors += mul_n();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
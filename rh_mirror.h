@@ -0,0 +1,171 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_MIRROR_H
+#define RH_MIRROR_H
+
+#ifndef __linux__
+#error "rh_mirror.h needs memfd_create and so is Linux only"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/memfd.h>
+
+// Ring buffer whose storage is mapped twice back to back, so that any run of
+// up to size items starting anywhere in the first mapping is contiguous
+// Readers and writers (and read/write syscalls) can then work on the items in
+// place without handling the wrap
+
+// Maps bytes of a memfd twice at base, returning NULL on failure
+// bytes must be a multiple of the page size
+static inline void *rh_mirror_map(size_t bytes) {
+	int fd = syscall(SYS_memfd_create, "rh_mirror", MFD_CLOEXEC);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (ftruncate(fd, bytes)) {
+		close(fd);
+		return NULL;
+	}
+
+	// Reserve both halves first so nothing else can land in the second
+	unsigned char *base = mmap(NULL, 2 * bytes, PROT_NONE
+			, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		close(fd);
+		return NULL;
+	}
+
+	if (mmap(base, bytes, PROT_READ | PROT_WRITE
+			, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+	|| mmap(base + bytes, bytes, PROT_READ | PROT_WRITE
+			, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		munmap(base, 2 * bytes);
+		close(fd);
+		return NULL;
+	}
+
+	// The mappings keep the memory alive
+	close(fd);
+	return base;
+}
+
+#define RH_MIRROR_RING_MAKE(NAME, TYPE)						\
+	RH_MIRROR_RING_DEF(NAME, TYPE);						\
+	RH_MIRROR_RING_IMPL(NAME, TYPE);
+
+// head is always less than size, and head + count never exceeds 2 * size
+#define RH_MIRROR_RING_DEF(NAME, TYPE)						\
+typedef struct {								\
+	size_t size;								\
+	size_t head;								\
+	size_t count;								\
+										\
+	TYPE *items;								\
+} NAME;										\
+
+#define RH_MIRROR_RING_IMPL(NAME, TYPE)						\
+/* Rounds size up so the mapping is a whole number of pages and items */	\
+static inline int NAME##_init(NAME *r, size_t size) {				\
+	size_t page = sysconf(_SC_PAGESIZE);					\
+	size_t unit = page;							\
+	while (unit % sizeof(TYPE)) {						\
+		unit += page;							\
+	}									\
+	size_t bytes = (size * sizeof(TYPE) + unit - 1) / unit * unit;		\
+										\
+	*r = (NAME) {0};							\
+	r->items = rh_mirror_map(bytes ?: unit);				\
+	if (!r->items) {							\
+		return 0;							\
+	}									\
+	r->size = (bytes ?: unit) / sizeof(TYPE);				\
+	return 1;								\
+}										\
+										\
+static inline void NAME##_free(NAME *r) {					\
+	if (r->items) {								\
+		munmap(r->items, 2 * r->size * sizeof(TYPE));			\
+	}									\
+	*r = (NAME) {0};							\
+}										\
+										\
+static inline size_t NAME##_count(NAME *r) {					\
+	return r->count;							\
+}										\
+										\
+static inline size_t NAME##_space(NAME *r) {					\
+	return r->size - r->count;						\
+}										\
+										\
+static inline int NAME##_empty(NAME *r) {					\
+	return !r->count;							\
+}										\
+										\
+/* All queued items, contiguously, oldest first */				\
+static inline TYPE *NAME##_read_ptr(NAME *r, size_t *avail) {			\
+	*avail = r->count;							\
+	return &r->items[r->head];						\
+}										\
+										\
+static inline void NAME##_consume(NAME *r, size_t n) {				\
+	n = n < r->count ? n : r->count;					\
+	r->head += n;								\
+	r->head -= r->head >= r->size ? r->size : 0;				\
+	r->count -= n;								\
+}										\
+										\
+/* All free space, contiguously, following the newest item */			\
+static inline TYPE *NAME##_write_ptr(NAME *r, size_t *space) {			\
+	*space = r->size - r->count;						\
+	return &r->items[r->head + r->count];					\
+}										\
+										\
+static inline void NAME##_commit(NAME *r, size_t n) {				\
+	r->count += n < r->size - r->count ? n : r->size - r->count;		\
+}										\
+										\
+/* Returns the number of items copied in */					\
+static inline size_t NAME##_push_n(NAME *r, const TYPE *push, size_t n) {	\
+	size_t space;								\
+	TYPE *to = NAME##_write_ptr(r, &space);					\
+	n = n < space ? n : space;						\
+	memcpy(to, push, n * sizeof(TYPE));					\
+	NAME##_commit(r, n);							\
+	return n;								\
+}										\
+										\
+/* Returns the number of items copied out */					\
+static inline size_t NAME##_pop_n(NAME *r, TYPE *pop, size_t n) {		\
+	size_t avail;								\
+	TYPE *from = NAME##_read_ptr(r, &avail);				\
+	n = n < avail ? n : avail;						\
+	memcpy(pop, from, n * sizeof(TYPE));					\
+	NAME##_consume(r, n);							\
+	return n;								\
+}										\
+
+#endif
@@ -0,0 +1,151 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_mirror.h"
+#include "rh_deq.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+// Newline delimited records arriving in read() sized chunks, parsed in place
+// from the mirrored ring, against rh_deq where each record is first copied
+// out to a staging buffer
+
+RH_MIRROR_RING_MAKE(byte_ring, char);
+RH_DEQ_MAKE(byte_deq, char);
+
+#define STREAM_BYTES (256 << 20)
+#define CHUNK 4096
+#define RING_BYTES (64 << 10)
+#define MAX_RECORD 512
+
+// Stands in for real parsing: hash the record and count its fields
+static inline uint64_t parse(const char *record, size_t len) {
+	uint64_t hash = 14695981039346656037LU;
+	uint64_t fields = 1;
+	for (size_t i = 0;i < len;++i) {
+		hash ^= (unsigned char) record[i];
+		hash *= 1099511628211;
+		fields += record[i] == ',';
+	}
+	return hash + fields;
+}
+
+static char *make_stream(size_t *records) {
+	char *stream = malloc(STREAM_BYTES);
+	uint64_t seed = 3;
+	size_t i = 0;
+	*records = 0;
+	while (i < STREAM_BYTES) {
+		size_t len = 10 + rh_bench_rand(&seed) % 200;
+		for (size_t j = 0;j < len && i < STREAM_BYTES - 1;++j) {
+			stream[i++] = j % 7 == 6 ? ',' : 'a' + j % 26;
+		}
+		stream[i++] = '\n';
+		++*records;
+	}
+	return stream;
+}
+
+static uint64_t bench_mirror(const char *stream) {
+	byte_ring r;
+	if (!byte_ring_init(&r, RING_BYTES)) {
+		fprintf(stderr, "Mirror ring mapping failed\n");
+		return 0;
+	}
+	uint64_t sum = 0;
+
+	for (size_t in = 0;in < STREAM_BYTES;) {
+		size_t space;
+		char *to = byte_ring_write_ptr(&r, &space);
+		size_t n = STREAM_BYTES - in < CHUNK ? STREAM_BYTES - in : CHUNK;
+		n = n < space ? n : space;
+		memcpy(to, stream + in, n);
+		byte_ring_commit(&r, n);
+		in += n;
+
+		size_t avail;
+		char *at = byte_ring_read_ptr(&r, &avail);
+		char *nl;
+		while ((nl = memchr(at, '\n', avail))) {
+			size_t len = nl - at + 1;
+			sum += parse(at, len - 1);
+			byte_ring_consume(&r, len);
+			at += len;
+			avail -= len;
+		}
+	}
+
+	byte_ring_free(&r);
+	return sum;
+}
+
+static uint64_t bench_deq(const char *stream) {
+	byte_deq d = byte_deq_new(RING_BYTES);
+	char staging[MAX_RECORD];
+	uint64_t sum = 0;
+
+	for (size_t in = 0;in < STREAM_BYTES;) {
+		size_t n = STREAM_BYTES - in < CHUNK ? STREAM_BYTES - in : CHUNK;
+		byte_deq_push_n(&d, stream + in, n);
+		in += n;
+
+		while (1) {
+			byte_deq_span a, b;
+			byte_deq_spans(&d, &a, &b);
+			char *nl = memchr(a.items, '\n', a.len);
+			size_t len;
+			if (nl) {
+				len = nl - a.items + 1;
+			} else if (b.len && (nl = memchr(b.items, '\n', b.len))) {
+				len = a.len + (nl - b.items) + 1;
+			} else {
+				break;
+			}
+			byte_deq_rpop_n(&d, staging, len);
+			sum += parse(staging, len - 1);
+		}
+	}
+
+	byte_deq_free(&d);
+	return sum;
+}
+
+int main() {
+	size_t records;
+	char *stream = make_stream(&records);
+
+	uint64_t start = rh_bench_now();
+	uint64_t mirror = bench_mirror(stream);
+	rh_bench_report("mirror ring parse", records, rh_bench_now() - start);
+
+	start = rh_bench_now();
+	uint64_t deq = bench_deq(stream);
+	rh_bench_report("deq + staging copy parse", records, rh_bench_now() - start);
+
+	if (mirror != deq) {
+		fprintf(stderr, "Parsers disagree\n");
+	}
+
+	free(stream);
+	return 0;
+}
@@ -0,0 +1,164 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_mirror.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/resource.h>
+
+typedef struct {
+	uint64_t a, b, c;
+} triple;
+
+RH_MIRROR_RING_MAKE(test_ring, int);
+RH_MIRROR_RING_MAKE(triple_ring, triple);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+int sizes(void) {
+	size_t page = sysconf(_SC_PAGESIZE);
+	test_ring r;
+	triple_ring t;
+	if (!test_ring_init(&r, 1) || !triple_ring_init(&t, 1)) {
+		ERROR_MSG("Init test FAILED!");
+		return 1;
+	}
+
+	// Whole pages of whole items
+	int errors = r.size != page / sizeof(int);
+	errors += t.size * sizeof(triple) % page != 0;
+	errors += t.size < page / sizeof(triple);
+	errors += !test_ring_empty(&r) || test_ring_space(&r) != r.size;
+	test_ring_free(&r);
+	triple_ring_free(&t);
+	if (errors) {
+		ERROR_MSG("Sizes test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+int wrap(void) {
+	test_ring r;
+	if (!test_ring_init(&r, 1000)) {
+		ERROR_MSG("Wrap init test FAILED!");
+		return 1;
+	}
+
+	// Move the head to 10 items before the end of the first mapping
+	int errors = 0;
+	size_t space, avail;
+	int *to = test_ring_write_ptr(&r, &space);
+	errors += space != r.size;
+	test_ring_commit(&r, r.size - 10);
+	test_ring_consume(&r, r.size - 10);
+	errors += r.head != r.size - 10 || !test_ring_empty(&r);
+
+	// Written in place across the end as one span...
+	to = test_ring_write_ptr(&r, &space);
+	errors += space != r.size || to != r.items + r.size - 10;
+	for (int i = 0;i < 100;++i) {
+		to[i] = i;
+	}
+	test_ring_commit(&r, 100);
+	// ...landing at the start of the buffer
+	errors += r.items[0] != 10 || r.items[89] != 99;
+
+	// And read back as one span
+	int *from = test_ring_read_ptr(&r, &avail);
+	errors += avail != 100 || from != to;
+	for (int i = 0;i < 100;++i) {
+		errors += from[i] != i;
+	}
+	test_ring_consume(&r, 50);
+	errors += r.head != 40 || test_ring_count(&r) != 50;
+
+	// Copies wrap too, and are cut to the space or items there are
+	int buf[2000];
+	for (int i = 0;i < 2000;++i) {
+		buf[i] = 1000 + i;
+	}
+	errors += test_ring_push_n(&r, buf, 2000) != r.size - 50;
+	errors += test_ring_space(&r) || test_ring_push_n(&r, buf, 1);
+	test_ring_commit(&r, 1);
+	errors += test_ring_count(&r) != r.size;
+	errors += test_ring_pop_n(&r, buf, 50) != 50;
+	for (int i = 0;i < 50;++i) {
+		errors += buf[i] != 50 + i;
+	}
+	errors += test_ring_pop_n(&r, buf, 2000) != r.size - 50;
+	for (size_t i = 0;i < r.size - 50;++i) {
+		errors += buf[i] != 1000 + (int) i;
+	}
+	test_ring_consume(&r, 1);
+	errors += !test_ring_empty(&r) || test_ring_pop_n(&r, buf, 1);
+
+	test_ring_free(&r);
+	if (errors) {
+		ERROR_MSG("Wrap test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+int failure(void) {
+	test_ring r;
+	int errors = 0;
+
+	// No file descriptors left for memfd_create
+	struct rlimit old, none = {0, 0};
+	getrlimit(RLIMIT_NOFILE, &old);
+	none.rlim_max = old.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &none);
+	errors += test_ring_init(&r, 1000);
+	setrlimit(RLIMIT_NOFILE, &old);
+	errors += r.items || r.size;
+	test_ring_free(&r);
+
+	// Too large to map twice
+	errors += test_ring_init(&r, SIZE_MAX / 8);
+	errors += r.items || r.size;
+	test_ring_free(&r);
+
+	// And fine again afterwards
+	errors += !test_ring_init(&r, 1000);
+	test_ring_free(&r);
+	if (errors) {
+		ERROR_MSG("Failure test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += sizes();
+	no_errors += wrap();
+	no_errors += failure();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -0,0 +1,258 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_MPMC_H
+#define RH_MPMC_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "rh_futex.h"
+
+#ifndef RH_CACHE_LINE
+#define RH_CACHE_LINE 64
+#endif
+
+// Number of retries before a blocking call sleeps on the futex
+#ifndef RH_MPMC_SPIN
+#define RH_MPMC_SPIN 64
+#endif
+
+// Bounded multi producer multi consumer queue (Vyukov's design)
+// Each cell carries a sequence number saying whether it is ready to be
+// written (seq == pos) or read (seq == pos + 1) for a given lap, so producers
+// and consumers only contend on their own position counter
+// The blocking variants wait on a futex once the queue is full or empty
+#define RH_MPMC_MAKE(NAME, TYPE)						\
+	RH_MPMC_DEF(NAME, TYPE);						\
+	RH_MPMC_IMPL(NAME, TYPE);
+
+#define RH_MPMC_DEF(NAME, TYPE)							\
+typedef struct NAME##_cell {							\
+	_Atomic size_t seq;							\
+	TYPE item;								\
+} NAME##_cell;									\
+										\
+typedef struct {								\
+	size_t mask;								\
+	NAME##_cell *cells;							\
+										\
+	_Alignas(RH_CACHE_LINE) _Atomic size_t enqueue_pos;			\
+	_Alignas(RH_CACHE_LINE) _Atomic size_t dequeue_pos;			\
+										\
+	_Alignas(RH_CACHE_LINE) _Atomic uint32_t not_full;			\
+	_Atomic uint32_t push_armed;						\
+	_Alignas(RH_CACHE_LINE) _Atomic uint32_t not_empty;			\
+	_Atomic uint32_t pop_armed;						\
+} NAME;										\
+
+#define RH_MPMC_IMPL(NAME, TYPE)						\
+/* Size is rounded up to a power of two */					\
+static inline int NAME##_init(NAME *q, size_t size) {				\
+	size_t to = 2;								\
+	while (to < size) {							\
+		to <<= 1;							\
+	}									\
+										\
+	q->cells = aligned_alloc(RH_CACHE_LINE,					\
+			(to * sizeof(NAME##_cell) + RH_CACHE_LINE - 1)		\
+				& ~(size_t) (RH_CACHE_LINE - 1));		\
+	if (!q->cells) {							\
+		return 0;							\
+	}									\
+	q->mask = to - 1;							\
+										\
+	for (size_t i = 0;i < to;++i) {						\
+		atomic_init(&q->cells[i].seq, i);				\
+	}									\
+	atomic_init(&q->enqueue_pos, 0);					\
+	atomic_init(&q->dequeue_pos, 0);					\
+	atomic_init(&q->not_full, 0);						\
+	atomic_init(&q->push_armed, 0);						\
+	atomic_init(&q->not_empty, 0);						\
+	atomic_init(&q->pop_armed, 0);						\
+										\
+	return 1;								\
+}										\
+										\
+static inline void NAME##_free(NAME *q) {					\
+	free(q->cells);								\
+	q->cells = NULL;							\
+}										\
+										\
+static inline int NAME##_try_push(NAME *q, TYPE push) {				\
+	size_t pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);\
+	NAME##_cell *cell;							\
+	while (1) {								\
+		cell = &q->cells[pos & q->mask];				\
+		size_t seq = atomic_load_explicit(&cell->seq,			\
+				memory_order_acquire);				\
+		intptr_t dif = (intptr_t) seq - (intptr_t) pos;			\
+		if (!dif) {							\
+			if (atomic_compare_exchange_weak_explicit(		\
+					&q->enqueue_pos, &pos, pos + 1,		\
+					memory_order_relaxed,			\
+					memory_order_relaxed)) {		\
+				break;						\
+			}							\
+		} else if (dif < 0) {						\
+			return 0;						\
+		} else {							\
+			pos = atomic_load_explicit(&q->enqueue_pos,		\
+					memory_order_relaxed);			\
+		}								\
+	}									\
+										\
+	cell->item = push;							\
+	atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);	\
+	rh_futex_signal(&q->not_empty, &q->pop_armed);				\
+	return 1;								\
+}										\
+										\
+static inline int NAME##_try_pop(NAME *q, TYPE *pop) {				\
+	size_t pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);\
+	NAME##_cell *cell;							\
+	while (1) {								\
+		cell = &q->cells[pos & q->mask];				\
+		size_t seq = atomic_load_explicit(&cell->seq,			\
+				memory_order_acquire);				\
+		intptr_t dif = (intptr_t) seq - (intptr_t) (pos + 1);		\
+		if (!dif) {							\
+			if (atomic_compare_exchange_weak_explicit(		\
+					&q->dequeue_pos, &pos, pos + 1,		\
+					memory_order_relaxed,			\
+					memory_order_relaxed)) {		\
+				break;						\
+			}							\
+		} else if (dif < 0) {						\
+			return 0;						\
+		} else {							\
+			pos = atomic_load_explicit(&q->dequeue_pos,		\
+					memory_order_relaxed);			\
+		}								\
+	}									\
+										\
+	*pop = cell->item;							\
+	atomic_store_explicit(&cell->seq, pos + q->mask + 1,			\
+			memory_order_release);					\
+	rh_futex_signal(&q->not_full, &q->push_armed);				\
+	return 1;								\
+}										\
+										\
+/* Claims up to n consecutive ready cells with a single CAS */			\
+static inline size_t NAME##_try_pop_n(NAME *q, TYPE *pop, size_t n) {		\
+	size_t pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);\
+	size_t got;								\
+	while (1) {								\
+		for (got = 0;got < n && got <= q->mask;++got) {			\
+			size_t seq = atomic_load_explicit(			\
+					&q->cells[(pos + got) & q->mask].seq,	\
+					memory_order_acquire);			\
+			if (seq != pos + got + 1) {				\
+				break;						\
+			}							\
+		}								\
+		if (!got) {							\
+			size_t seq = atomic_load_explicit(			\
+					&q->cells[pos & q->mask].seq,		\
+					memory_order_relaxed);			\
+			/* Behind the other consumers rather than empty */	\
+			if ((intptr_t) seq - (intptr_t) (pos + 1) > 0) {	\
+				pos = atomic_load_explicit(&q->dequeue_pos,	\
+						memory_order_relaxed);		\
+				continue;					\
+			}							\
+			return 0;						\
+		}								\
+		if (atomic_compare_exchange_weak_explicit(&q->dequeue_pos,	\
+				&pos, pos + got, memory_order_relaxed,		\
+				memory_order_relaxed)) {			\
+			break;							\
+		}								\
+	}									\
+										\
+	for (size_t i = 0;i < got;++i) {					\
+		NAME##_cell *cell = &q->cells[(pos + i) & q->mask];		\
+		pop[i] = cell->item;						\
+		atomic_store_explicit(&cell->seq, pos + i + q->mask + 1,	\
+				memory_order_release);				\
+	}									\
+	rh_futex_signal(&q->not_full, &q->push_armed);				\
+	return got;								\
+}										\
+										\
+static inline void NAME##_push(NAME *q, TYPE push) {				\
+	for (int i = 0;i < RH_MPMC_SPIN;++i) {					\
+		if (NAME##_try_push(q, push)) {					\
+			return;							\
+		}								\
+	}									\
+	while (1) {								\
+		uint32_t seen = atomic_load(&q->not_full);			\
+		atomic_store(&q->push_armed, 1);				\
+		atomic_thread_fence(memory_order_seq_cst);			\
+		if (NAME##_try_push(q, push)) {					\
+			return;							\
+		}								\
+		rh_futex_wait(&q->not_full, seen);				\
+	}									\
+}										\
+										\
+static inline TYPE NAME##_pop(NAME *q) {					\
+	TYPE pop;								\
+	for (int i = 0;i < RH_MPMC_SPIN;++i) {					\
+		if (NAME##_try_pop(q, &pop)) {					\
+			return pop;						\
+		}								\
+	}									\
+	while (1) {								\
+		uint32_t seen = atomic_load(&q->not_empty);			\
+		atomic_store(&q->pop_armed, 1);					\
+		atomic_thread_fence(memory_order_seq_cst);			\
+		if (NAME##_try_pop(q, &pop)) {					\
+			return pop;						\
+		}								\
+		rh_futex_wait(&q->not_empty, seen);				\
+	}									\
+}										\
+										\
+/* Waits for at least one item, then takes up to n */				\
+static inline size_t NAME##_pop_n(NAME *q, TYPE *pop, size_t n) {		\
+	size_t got;								\
+	for (int i = 0;i < RH_MPMC_SPIN;++i) {					\
+		if ((got = NAME##_try_pop_n(q, pop, n))) {			\
+			return got;						\
+		}								\
+	}									\
+	while (1) {								\
+		uint32_t seen = atomic_load(&q->not_empty);			\
+		atomic_store(&q->pop_armed, 1);					\
+		atomic_thread_fence(memory_order_seq_cst);			\
+		if ((got = NAME##_try_pop_n(q, pop, n))) {			\
+			return got;						\
+		}								\
+		rh_futex_wait(&q->not_empty, seen);				\
+	}									\
+}										\
+
+#endif
@@ -0,0 +1,165 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_mpmc.h"
+#include "rh_deq.h"
+#include "rh_bench.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+RH_MPMC_MAKE(queue, uint64_t);
+RH_DEQ_MAKE(locked_deq, uint64_t);
+
+#define ITEMS (1 << 20)
+#define QUEUE_SIZE 1024
+#define MAX_THREADS 8
+#define BATCH 32
+
+typedef struct {
+	queue q;
+	locked_deq d;
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+	size_t count;
+	size_t per_producer;
+	size_t per_consumer;
+	_Atomic uint64_t sum;
+} shared;
+
+typedef struct {
+	shared *s;
+	uint64_t id;
+} thread_arg;
+
+static void *mpmc_producer(void *arg) {
+	thread_arg *a = arg;
+	for (size_t i = 0;i < a->s->per_producer;++i) {
+		queue_push(&a->s->q, i);
+	}
+	return NULL;
+}
+
+static void *mpmc_consumer(void *arg) {
+	thread_arg *a = arg;
+	uint64_t sum = 0;
+	uint64_t items[BATCH];
+	for (size_t i = 0;i < a->s->per_consumer;) {
+		size_t want = a->s->per_consumer - i;
+		size_t got = queue_pop_n(&a->s->q, items, want < BATCH ? want : BATCH);
+		for (size_t j = 0;j < got;++j) {
+			sum += items[j];
+		}
+		i += got;
+	}
+	atomic_fetch_add(&a->s->sum, sum);
+	return NULL;
+}
+
+static void *locked_producer(void *arg) {
+	thread_arg *a = arg;
+	for (size_t i = 0;i < a->s->per_producer;++i) {
+		pthread_mutex_lock(&a->s->lock);
+		/* Bounded like the lock free queue */
+		while (a->s->count == QUEUE_SIZE) {
+			pthread_cond_wait(&a->s->not_full, &a->s->lock);
+		}
+		++a->s->count;
+		locked_deq_push(&a->s->d, i);
+		pthread_cond_signal(&a->s->not_empty);
+		pthread_mutex_unlock(&a->s->lock);
+	}
+	return NULL;
+}
+
+static void *locked_consumer(void *arg) {
+	thread_arg *a = arg;
+	uint64_t sum = 0;
+	for (size_t i = 0;i < a->s->per_consumer;++i) {
+		pthread_mutex_lock(&a->s->lock);
+		while (locked_deq_empty(&a->s->d)) {
+			pthread_cond_wait(&a->s->not_empty, &a->s->lock);
+		}
+		sum += locked_deq_rpop(&a->s->d);
+		--a->s->count;
+		pthread_cond_signal(&a->s->not_full);
+		pthread_mutex_unlock(&a->s->lock);
+	}
+	atomic_fetch_add(&a->s->sum, sum);
+	return NULL;
+}
+
+static void run(const char *name, int producers, int consumers
+		, void *produce(void *), void *consume(void *)) {
+	shared s = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.not_empty = PTHREAD_COND_INITIALIZER,
+		.not_full = PTHREAD_COND_INITIALIZER,
+		.per_producer = ITEMS / producers,
+		.per_consumer = ITEMS / consumers,
+	};
+	queue_init(&s.q, QUEUE_SIZE);
+	s.d = locked_deq_new(QUEUE_SIZE * 2);
+
+	pthread_t threads[MAX_THREADS * 2];
+	thread_arg args[MAX_THREADS * 2];
+
+	uint64_t start = rh_bench_now();
+	for (int i = 0;i < consumers;++i) {
+		args[i] = (thread_arg) {&s, i};
+		pthread_create(&threads[i], NULL, consume, &args[i]);
+	}
+	for (int i = 0;i < producers;++i) {
+		args[consumers + i] = (thread_arg) {&s, i};
+		pthread_create(&threads[consumers + i], NULL, produce
+				, &args[consumers + i]);
+	}
+	for (int i = 0;i < producers + consumers;++i) {
+		pthread_join(threads[i], NULL);
+	}
+	uint64_t end = rh_bench_now();
+
+	char label[64];
+	snprintf(label, sizeof(label), "%s %dp x %dc", name, producers, consumers);
+	rh_bench_report(label, ITEMS, end - start);
+
+	uint64_t expected = (uint64_t) producers
+		* (s.per_producer * (s.per_producer - 1) / 2);
+	if (atomic_load(&s.sum) != expected) {
+		fprintf(stderr, "%s lost items\n", label);
+	}
+
+	queue_free(&s.q);
+	locked_deq_free(&s.d);
+}
+
+int main() {
+	for (int p = 1;p <= MAX_THREADS;p *= 2) {
+		for (int c = 1;c <= MAX_THREADS;c *= 2) {
+			run("mpmc", p, c, mpmc_producer, mpmc_consumer);
+			run("mutex deq", p, c, locked_producer, locked_consumer);
+		}
+	}
+
+	return 0;
+}
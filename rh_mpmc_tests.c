@@ -0,0 +1,188 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_mpmc.h"
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+
+RH_MPMC_MAKE(test_queue, uint64_t);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+int bounds(void) {
+	test_queue q;
+	if (!test_queue_init(&q, 5)) {
+		ERROR_MSG("Init test FAILED!");
+		return 1;
+	}
+
+	// Rounded up to 8
+	uint64_t pushed = 0, item = 0;
+	while (test_queue_try_push(&q, pushed)) {
+		++pushed;
+	}
+	int errors = pushed != 8;
+	for (uint64_t i = 0;i < pushed;++i) {
+		errors += !test_queue_try_pop(&q, &item) || item != i;
+	}
+	errors += test_queue_try_pop(&q, &item);
+
+	// Wrapping past the end of the cells keeps order
+	for (uint64_t i = 0;i < 20;++i) {
+		test_queue_push(&q, i);
+		errors += test_queue_pop(&q) != i;
+	}
+	test_queue_free(&q);
+	if (errors) {
+		ERROR_MSG("Bounds test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+// Producers push their id in the top bits over an index, consumers check each
+// producer's items arrive in order and count every item seen
+// Once the producers finish one STOP per consumer is pushed after their items
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define PER_PRODUCER (1 << 16)
+#define BATCH 7
+#define STOP UINT64_MAX
+
+typedef struct {
+	test_queue q;
+	_Atomic unsigned char seen[PRODUCERS][PER_PRODUCER];
+	_Atomic int errors;
+} shared;
+
+typedef struct {
+	shared *s;
+	uint64_t id;
+} thread_arg;
+
+static void *producer(void *arg) {
+	thread_arg *a = arg;
+	for (uint64_t i = 0;i < PER_PRODUCER;++i) {
+		uint64_t item = a->id << 32 | i;
+		// Mix the blocking and non blocking pushes
+		if (i & 1) {
+			test_queue_push(&a->s->q, item);
+		} else {
+			while (!test_queue_try_push(&a->s->q, item)) {
+				sched_yield();
+			}
+		}
+	}
+	return NULL;
+}
+
+static void *consumer(void *arg) {
+	thread_arg *a = arg;
+	shared *s = a->s;
+	int64_t last[PRODUCERS] = {-1, -1, -1, -1};
+	uint64_t items[BATCH];
+	size_t stops = 0;
+
+	while (!stops) {
+		// Mix single and batched pops of different sizes
+		size_t got = 1;
+		if (a->id) {
+			got = test_queue_pop_n(&s->q, items, a->id * 2);
+		} else {
+			items[0] = test_queue_pop(&s->q);
+		}
+		for (size_t j = 0;j < got;++j) {
+			if (items[j] == STOP) {
+				++stops;
+				continue;
+			}
+			uint64_t p = items[j] >> 32, i = (uint32_t) items[j];
+			if (p >= PRODUCERS || i >= PER_PRODUCER
+			|| (int64_t) i <= last[p]) {
+				atomic_fetch_add(&s->errors, 1);
+				continue;
+			}
+			last[p] = i;
+			atomic_fetch_add(&s->seen[p][i], 1);
+		}
+	}
+	// Leave the other consumers their STOP
+	while (--stops) {
+		test_queue_push(&s->q, STOP);
+	}
+	return NULL;
+}
+
+int stress(void) {
+	static shared s;
+	if (!test_queue_init(&s.q, 64)) {
+		ERROR_MSG("Stress init test FAILED!");
+		return 1;
+	}
+
+	pthread_t threads[PRODUCERS + CONSUMERS];
+	thread_arg args[PRODUCERS + CONSUMERS];
+	for (int i = 0;i < PRODUCERS + CONSUMERS;++i) {
+		args[i] = (thread_arg) {&s, i < PRODUCERS ? i : i - PRODUCERS};
+		pthread_create(&threads[i], NULL
+				, i < PRODUCERS ? producer : consumer, &args[i]);
+	}
+	for (int i = 0;i < PRODUCERS;++i) {
+		pthread_join(threads[i], NULL);
+	}
+	for (int i = 0;i < CONSUMERS;++i) {
+		test_queue_push(&s.q, STOP);
+	}
+	for (int i = PRODUCERS;i < PRODUCERS + CONSUMERS;++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	size_t missing = 0;
+	for (int p = 0;p < PRODUCERS;++p) {
+		for (int i = 0;i < PER_PRODUCER;++i) {
+			missing += s.seen[p][i] != 1;
+		}
+	}
+	uint64_t item;
+	int left = test_queue_try_pop(&s.q, &item);
+	test_queue_free(&s.q);
+	if (missing || s.errors || left) {
+		ERROR_MSG("Stress test FAILED! %zu not popped once, %d wrong"
+				, missing, s.errors);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += bounds();
+	no_errors += stress();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -0,0 +1,265 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_MT_POOL_H
+#define RH_MT_POOL_H
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "rh_realloc.h"
+#include "rh_pool.h"
+
+// Objects per magazine
+#ifndef RH_MT_POOL_MAG
+#define RH_MT_POOL_MAG 64
+#endif
+
+// Thread safe sized pool (Bonwick's magazines)
+// Each thread caches free objects in two magazines, free lists of up to
+// RH_MT_POOL_MAG objects, and only takes the depot lock to swap a whole
+// magazine when both are empty (alloc) or full (free); the depot refills from
+// slab chunks
+// Objects may be freed on any thread, moving between threads through the
+// depot, and a thread's magazines are returned to the depot when it exits
+// freeall releases every chunk, so may only be called while no other thread
+// is in a pool call; it starts a new generation of the pool, and magazines
+// cached by other threads in an older one are dropped rather than used or
+// returned, whether the thread next calls the pool or exits
+// The depot's array of magazines grows with RH_REALLOC and RH_FREE
+#define RH_MT_POOL_MAKE(NAME, SIZE, CHUNK, ALIGN)				\
+	RH_MT_POOL_DEF(NAME);							\
+	RH_MT_POOL_IMPL(NAME, SIZE, CHUNK, ALIGN);
+
+#define RH_MT_POOL_DEF(NAME)							\
+typedef struct {								\
+	rh_mem_link *items;							\
+	size_t count;								\
+} NAME##_mag;									\
+										\
+typedef struct {								\
+	NAME##_mag loaded;							\
+	NAME##_mag prev;							\
+	int registered;								\
+	/* The pool's generation when the magazines were cached */		\
+	size_t gen;								\
+} NAME##_cache;									\
+										\
+typedef struct {								\
+	pthread_mutex_t lock;							\
+	size_t size;								\
+	size_t top;								\
+	NAME##_mag *mags;							\
+	/* Magazines given while mags could not grow, chained together */	\
+	NAME##_mag spill;							\
+	rh_slab *slabs;								\
+	/* Bumped by freeall to invalidate every thread's cache */		\
+	_Atomic size_t gen;							\
+} NAME##_depot;									\
+										\
+extern NAME##_depot NAME;
+
+#define RH_MT_POOL_IMPL(NAME, SIZE, CHUNK, ALIGN)				\
+NAME##_depot NAME = {PTHREAD_MUTEX_INITIALIZER, 0, 0, NULL, {0}, NULL, 0};	\
+										\
+static _Thread_local NAME##_cache NAME##_local;					\
+static pthread_key_t NAME##_key;						\
+static pthread_once_t NAME##_once = PTHREAD_ONCE_INIT;				\
+										\
+/* Must be called with the depot locked */					\
+static inline int NAME##_depot_push(NAME##_mag mag) {				\
+	if (NAME.top == NAME.size) {						\
+		size_t to = (NAME.size ?: 8) * 2;				\
+		NAME##_mag *new = RH_REALLOC(NAME.mags				\
+				, NAME.size * sizeof(*new), to * sizeof(*new));	\
+		if (!new) {							\
+			return 0;						\
+		}								\
+		NAME.mags = new;						\
+		NAME.size = to;							\
+	}									\
+										\
+	NAME.mags[NAME.top++] = mag;						\
+	return 1;								\
+}										\
+										\
+/* Must be called with the depot locked */					\
+static inline void NAME##_depot_chain(NAME##_mag *to, NAME##_mag mag) {		\
+	rh_mem_link *last = mag.items;						\
+	while (last->link) {							\
+		last = last->link;						\
+	}									\
+	last->link = to->items;							\
+	to->items = mag.items;							\
+	to->count += mag.count;							\
+}										\
+										\
+/* Returns a magazine from the depot, refilling it from a new chunk */		\
+static inline NAME##_mag NAME##_depot_pop(void) {				\
+	pthread_mutex_lock(&NAME.lock);						\
+	if (!NAME.top && NAME.spill.count) {					\
+		NAME##_mag ret = NAME.spill;					\
+		NAME.spill = (NAME##_mag) {0};					\
+		pthread_mutex_unlock(&NAME.lock);				\
+		return ret;							\
+	}									\
+	if (!NAME.top) {							\
+		rh_mem_link *items = NULL;					\
+		if (!rh_slab_refill(&items, &NAME.slabs, CHUNK, SIZE, ALIGN)) {	\
+			pthread_mutex_unlock(&NAME.lock);			\
+			return (NAME##_mag) {0};				\
+		}								\
+		/* Split into magazines, the last possibly partial */		\
+		while (items) {							\
+			NAME##_mag mag = {items, 0};				\
+			rh_mem_link *last = items;				\
+			while (++mag.count < RH_MT_POOL_MAG && last->link) {	\
+				last = last->link;				\
+			}							\
+			items = last->link;					\
+			last->link = NULL;					\
+			if (!NAME##_depot_push(mag)) {				\
+				/* Out of memory, so hand the rest out whole */	\
+				last->link = items;				\
+				for (;items;items = items->link) {		\
+					++mag.count;				\
+				}						\
+				pthread_mutex_unlock(&NAME.lock);		\
+				return mag;					\
+			}							\
+		}								\
+	}									\
+										\
+	NAME##_mag ret = NAME.mags[--NAME.top];					\
+	pthread_mutex_unlock(&NAME.lock);					\
+	return ret;								\
+}										\
+										\
+/* Must be called with the depot locked */					\
+static inline void NAME##_depot_put(NAME##_mag mag) {				\
+	if (mag.count && !NAME##_depot_push(mag)) {				\
+		/* Out of memory, so chain them onto the spill magazine */	\
+		NAME##_depot_chain(&NAME.spill, mag);				\
+	}									\
+}										\
+										\
+static inline void NAME##_depot_give(NAME##_mag mag) {				\
+	if (!mag.count) {							\
+		return;								\
+	}									\
+	pthread_mutex_lock(&NAME.lock);						\
+	NAME##_depot_put(mag);							\
+	pthread_mutex_unlock(&NAME.lock);					\
+}										\
+										\
+/* Run at thread exit, under the lock so freeall cannot come between the */	\
+/* generation check and the magazines reaching the depot */			\
+static void NAME##_flush(void *cache) {						\
+	NAME##_cache *c = cache;						\
+	pthread_mutex_lock(&NAME.lock);						\
+	if (c->gen == atomic_load_explicit(&NAME.gen, memory_order_relaxed)) {	\
+		NAME##_depot_put(c->loaded);					\
+		NAME##_depot_put(c->prev);					\
+	}									\
+	pthread_mutex_unlock(&NAME.lock);					\
+	*c = (NAME##_cache) {0};						\
+}										\
+										\
+static void NAME##_make_key(void) {						\
+	pthread_key_create(&NAME##_key, NAME##_flush);				\
+}										\
+										\
+static inline void NAME##_register(NAME##_cache *c) {				\
+	pthread_once(&NAME##_once, NAME##_make_key);				\
+	pthread_setspecific(NAME##_key, c);					\
+	c->registered = 1;							\
+}										\
+										\
+/* The calling thread's cache, emptied if the pool was freed since */		\
+static inline NAME##_cache *NAME##_cache_get(void) {				\
+	NAME##_cache *c = &NAME##_local;					\
+	size_t gen = atomic_load_explicit(&NAME.gen, memory_order_relaxed);	\
+	if (__builtin_expect(c->gen != gen, 0)) {				\
+		c->loaded = c->prev = (NAME##_mag) {0};				\
+		c->gen = gen;							\
+	}									\
+	return c;								\
+}										\
+										\
+static inline void *NAME##_alloc(void) {					\
+	NAME##_cache *c = NAME##_cache_get();					\
+	if (!c->loaded.count) {							\
+		if (c->prev.count) {						\
+			NAME##_mag t = c->loaded;				\
+			c->loaded = c->prev;					\
+			c->prev = t;						\
+		} else {							\
+			if (!c->registered) {					\
+				NAME##_register(c);				\
+			}							\
+			c->loaded = NAME##_depot_pop();				\
+			if (!c->loaded.count) {					\
+				return NULL;					\
+			}							\
+		}								\
+	}									\
+										\
+	rh_mem_link *mem = c->loaded.items;					\
+	c->loaded.items = mem->link;						\
+	--c->loaded.count;							\
+	return (void *) mem;							\
+}										\
+										\
+static inline void NAME##_free(void *to_free) {					\
+	if (!to_free) { return; }						\
+	NAME##_cache *c = NAME##_cache_get();					\
+	if (!c->registered) {							\
+		NAME##_register(c);						\
+	}									\
+	if (c->loaded.count >= RH_MT_POOL_MAG) {				\
+		if (c->prev.count) {						\
+			NAME##_depot_give(c->prev);				\
+		}								\
+		c->prev = c->loaded;						\
+		c->loaded = (NAME##_mag) {0};					\
+	}									\
+										\
+	rh_mem_link *l = to_free;						\
+	l->link = c->loaded.items;						\
+	c->loaded.items = l;							\
+	++c->loaded.count;							\
+}										\
+										\
+static inline void NAME##_freeall(void) {					\
+	pthread_mutex_lock(&NAME.lock);						\
+	atomic_fetch_add_explicit(&NAME.gen, 1, memory_order_relaxed);		\
+	rh_mem_link *none = NULL;						\
+	rh_slab_freeall(&none, &NAME.slabs);					\
+	RH_FREE(NAME.mags, NAME.size * sizeof(*NAME.mags));			\
+	NAME.mags = NULL;							\
+	NAME.size = NAME.top = 0;						\
+	NAME.spill = (NAME##_mag) {0};						\
+	pthread_mutex_unlock(&NAME.lock);					\
+}										\
+
+#endif
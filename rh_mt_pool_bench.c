@@ -0,0 +1,156 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_mt_pool.h"
+#include "rh_spsc.h"
+#include "rh_bench.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+typedef struct {
+	uint64_t key;
+	void *left, *right;
+} node;
+
+RH_MT_POOL_MAKE(node_pool, sizeof(node), RH_SLAB_CHUNK, sizeof(void *));
+RH_SPSC_MAKE(handoff, node *, 1024);
+
+#define PAIRS (1 << 22)
+#define LIVE 32
+#define MAX_THREADS 64
+
+typedef struct {
+	int use_pool;
+	size_t pairs;
+	handoff *q;
+} thread_arg;
+
+static inline node *node_alloc(int use_pool) {
+	return use_pool ? node_pool_alloc() : malloc(sizeof(node));
+}
+
+static inline void node_release(int use_pool, node *n) {
+	if (use_pool) {
+		node_pool_free(n);
+	} else {
+		free(n);
+	}
+}
+
+static void relax(unsigned *spins) {
+	if (++*spins & 0xff) {
+		__asm__ volatile("" ::: "memory");
+	} else {
+		sched_yield();
+	}
+}
+
+// Keeps LIVE objects, replacing the oldest each time
+static void *local_worker(void *arg) {
+	thread_arg *a = arg;
+	node *live[LIVE] = {0};
+	for (size_t i = 0;i < a->pairs;++i) {
+		node_release(a->use_pool, live[i % LIVE]);
+		live[i % LIVE] = node_alloc(a->use_pool);
+		live[i % LIVE]->key = i;
+	}
+	for (size_t i = 0;i < LIVE;++i) {
+		node_release(a->use_pool, live[i]);
+	}
+	return NULL;
+}
+
+// Allocates objects for the paired thread to free
+static void *producer(void *arg) {
+	thread_arg *a = arg;
+	unsigned spins = 0;
+	for (size_t i = 0;i < a->pairs;++i) {
+		node *n = node_alloc(a->use_pool);
+		n->key = i;
+		while (!handoff_push(a->q, n)) {
+			relax(&spins);
+		}
+	}
+	return NULL;
+}
+
+static void *consumer(void *arg) {
+	thread_arg *a = arg;
+	unsigned spins = 0;
+	for (size_t i = 0;i < a->pairs;++i) {
+		node *n;
+		while (!handoff_pop(a->q, &n)) {
+			relax(&spins);
+		}
+		rh_bench_use(n->key);
+		node_release(a->use_pool, n);
+	}
+	return NULL;
+}
+
+static void run(int threads, int use_pool, int remote) {
+	static pthread_t tids[MAX_THREADS];
+	static thread_arg args[MAX_THREADS];
+	handoff *queues[MAX_THREADS / 2];
+
+	for (int i = 0;i < threads / 2;++i) {
+		queues[i] = handoff_new();
+	}
+
+	uint64_t start = rh_bench_now();
+	for (int i = 0;i < threads;++i) {
+		args[i] = (thread_arg) {use_pool, PAIRS / threads
+			, remote ? queues[i / 2] : NULL};
+		pthread_create(&tids[i], NULL, !remote ? local_worker
+				: i % 2 ? consumer : producer, &args[i]);
+	}
+	for (int i = 0;i < threads;++i) {
+		pthread_join(tids[i], NULL);
+	}
+	uint64_t end = rh_bench_now();
+
+	char label[64];
+	snprintf(label, sizeof(label), "%s %s %d threads"
+			, use_pool ? "mt pool" : "malloc", remote ? "remote" : "local"
+			, threads);
+	rh_bench_report(label, (PAIRS / threads) * threads, end - start);
+
+	for (int i = 0;i < threads / 2;++i) {
+		handoff_free(queues[i]);
+	}
+}
+
+int main() {
+	for (int t = 1;t <= MAX_THREADS;t *= 2) {
+		run(t, 1, 0);
+		run(t, 0, 0);
+	}
+	for (int t = 2;t <= MAX_THREADS;t *= 2) {
+		run(t, 1, 1);
+		run(t, 0, 1);
+	}
+
+	node_pool_freeall();
+	return 0;
+}
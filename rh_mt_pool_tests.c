@@ -0,0 +1,308 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include <stdlib.h>
+
+// Lets the depot's array of magazines fail to grow, to make it spill
+static int fail_realloc = 0;
+
+static void *test_realloc(void *ptr, size_t size) {
+	return fail_realloc ? NULL : realloc(ptr, size);
+}
+
+#define RH_REALLOC(PTR, OLD, NEW) test_realloc(PTR, NEW)
+
+#include "rh_mt_pool.h"
+#include <stdio.h>
+
+// Objects carry whether they are held after the free list link
+typedef struct {
+	rh_mem_link link;
+	_Atomic uint64_t state;
+} object;
+
+#define HELD 0x48454c44
+#define CHUNK 4096
+#define PER_CHUNK ((CHUNK - rh_slab_round(sizeof(rh_slab), 16))		\
+		/ sizeof(object))
+
+RH_MT_POOL_MAKE(flush_pool, sizeof(object), CHUNK, 16);
+RH_MT_POOL_MAKE(stress_pool, sizeof(object), CHUNK, 16);
+RH_MT_POOL_MAKE(spill_pool, sizeof(object), CHUNK, 16);
+RH_MT_POOL_MAKE(gen_pool, sizeof(object), CHUNK, 16);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+// Objects held by the depot, only read while no other thread uses the pool
+#define DEPOT_COUNT(POOL) ({							\
+	size_t n = POOL.spill.count;						\
+	for (size_t i = 0;i < POOL.top;++i) {					\
+		n += POOL.mags[i].count;					\
+	}									\
+	n;									\
+})
+
+#define SLAB_COUNT(POOL) ({							\
+	size_t n = 0;								\
+	for (rh_slab *s = POOL.slabs;s;s = s->link) {				\
+		++n;								\
+	}									\
+	n;									\
+})
+
+// Objects allocated on one thread are freed by another, whose cache goes to
+// the depot when it exits
+#define CROSS 1000
+
+static void *cross[CROSS];
+static pthread_barrier_t barrier;
+
+static void *free_cross(void *arg) {
+	(void) arg;
+	for (size_t i = 0;i < CROSS;++i) {
+		flush_pool_free(cross[i]);
+	}
+	pthread_barrier_wait(&barrier);
+	pthread_barrier_wait(&barrier);
+	return NULL;
+}
+
+int cross_thread(void) {
+	for (size_t i = 0;i < CROSS;++i) {
+		cross[i] = flush_pool_alloc();
+	}
+	size_t slabs = SLAB_COUNT(flush_pool);
+	size_t depot = DEPOT_COUNT(flush_pool);
+
+	pthread_t thread;
+	pthread_barrier_init(&barrier, NULL, 2);
+	pthread_create(&thread, NULL, free_cross, NULL);
+	pthread_barrier_wait(&barrier);
+	// Some are still cached by the freeing thread
+	size_t before_exit = DEPOT_COUNT(flush_pool);
+	pthread_barrier_wait(&barrier);
+	pthread_join(thread, NULL);
+	pthread_barrier_destroy(&barrier);
+	size_t after_exit = DEPOT_COUNT(flush_pool);
+
+	// And are reused without another chunk
+	for (size_t i = 0;i < CROSS;++i) {
+		cross[i] = flush_pool_alloc();
+	}
+	if (before_exit >= depot + CROSS || after_exit != depot + CROSS
+	|| SLAB_COUNT(flush_pool) != slabs) {
+		ERROR_MSG("Cross thread test FAILED! %zu then %zu of %zu"
+				, before_exit, after_exit, depot + CROSS);
+		return 1;
+	}
+
+	flush_pool_freeall();
+	return 0;
+}
+
+// Threads allocate, hand half of their objects to others through a mailbox
+// and free the rest along with what they find there; no object may be held
+// twice, and once every thread exits the depot has every object
+#define THREADS 4
+#define ROUNDS (1 << 15)
+#define MAILBOX 64
+
+static _Atomic(object *) mailbox[MAILBOX];
+static _Atomic int held_twice;
+
+static void take(object *o) {
+	if (!o || atomic_exchange(&o->state, HELD) == HELD) {
+		atomic_fetch_add(&held_twice, 1);
+	}
+}
+
+static void give(object *o) {
+	if (o) {
+		if (atomic_exchange(&o->state, 0) != HELD) {
+			atomic_fetch_add(&held_twice, 1);
+		}
+		stress_pool_free(o);
+	}
+}
+
+static void *stress_worker(void *arg) {
+	uint64_t seed = (uintptr_t) arg * 0x9E3779B97F4A7C15LU;
+	object *held[16];
+	for (size_t r = 0;r < ROUNDS;++r) {
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		size_t n = 1 + seed % 16;
+		for (size_t i = 0;i < n;++i) {
+			take(held[i] = stress_pool_alloc());
+		}
+		for (size_t i = 0;i < n;++i) {
+			if (i & 1) {
+				size_t slot = ((seed >> 8) + i) % MAILBOX;
+				give(atomic_exchange(&mailbox[slot], held[i]));
+			} else {
+				give(held[i]);
+			}
+		}
+	}
+	return NULL;
+}
+
+static void *drain_mailbox(void *arg) {
+	(void) arg;
+	for (int i = 0;i < MAILBOX;++i) {
+		give(atomic_exchange(&mailbox[i], NULL));
+	}
+	return NULL;
+}
+
+int stress(void) {
+	pthread_t threads[THREADS];
+	for (uintptr_t i = 0;i < THREADS;++i) {
+		pthread_create(&threads[i], NULL, stress_worker
+				, (void *) (i + 1));
+	}
+	for (int i = 0;i < THREADS;++i) {
+		pthread_join(threads[i], NULL);
+	}
+	pthread_create(&threads[0], NULL, drain_mailbox, NULL);
+	pthread_join(threads[0], NULL);
+
+	size_t objects = SLAB_COUNT(stress_pool) * PER_CHUNK;
+	size_t depot = DEPOT_COUNT(stress_pool);
+	stress_pool_freeall();
+	if (held_twice || depot != objects) {
+		ERROR_MSG("Stress test FAILED! %d held twice, %zu of %zu back"
+				, held_twice, depot, objects);
+		return 1;
+	}
+	return 0;
+}
+
+// With the depot unable to grow, a new chunk is handed out as one magazine
+// and magazines given back are chained onto the spill magazine, which the
+// next empty cache takes whole
+static void *spill_fill(void *arg) {
+	object **mem = arg;
+	for (size_t i = 0;i < PER_CHUNK;++i) {
+		mem[i] = spill_pool_alloc();
+	}
+	return NULL;
+}
+
+static void *spill_free(void *arg) {
+	object **mem = arg;
+	for (size_t i = 0;i < PER_CHUNK;++i) {
+		spill_pool_free(mem[i]);
+	}
+	return NULL;
+}
+
+int spill(void) {
+	object *mem[PER_CHUNK];
+	pthread_t thread;
+	fail_realloc = 1;
+	pthread_create(&thread, NULL, spill_fill, mem);
+	pthread_join(thread, NULL);
+	size_t slabs = SLAB_COUNT(spill_pool);
+	pthread_create(&thread, NULL, spill_free, mem);
+	pthread_join(thread, NULL);
+	size_t spilt = spill_pool.spill.count, top = spill_pool.top;
+
+	// Refilled from the spill magazine rather than a new chunk
+	int errors = 0;
+	uintptr_t slab = (uintptr_t) spill_pool.slabs;
+	for (size_t i = 0;i < PER_CHUNK;++i) {
+		uintptr_t o = (uintptr_t) spill_pool_alloc();
+		errors += o < slab || o >= slab + CHUNK;
+	}
+	errors += SLAB_COUNT(spill_pool) != 1 || spill_pool.spill.count;
+	fail_realloc = 0;
+	// Then from a new chunk, split into magazines in the depot
+	errors += !spill_pool_alloc();
+	errors += SLAB_COUNT(spill_pool) != 2 || !spill_pool.top;
+	spill_pool_freeall();
+	if (slabs != 1 || spilt != PER_CHUNK || top || errors) {
+		ERROR_MSG("Spill test FAILED! %zu spilt, %d wrong", spilt
+				, errors);
+		return 1;
+	}
+	return 0;
+}
+
+// Magazines another thread cached before freeall are neither used nor given
+// back to the depot when it exits
+static void *gen_worker(void *arg) {
+	void **got = arg;
+	void *mem[10];
+	for (int i = 0;i < 10;++i) {
+		mem[i] = gen_pool_alloc();
+	}
+	for (int i = 0;i < 10;++i) {
+		gen_pool_free(mem[i]);
+	}
+	pthread_barrier_wait(&barrier);
+	pthread_barrier_wait(&barrier);
+	if (got) {
+		*got = gen_pool_alloc();
+	}
+	return NULL;
+}
+
+int generation(void) {
+	pthread_t thread;
+	void *got = NULL;
+	int errors = 0;
+	pthread_barrier_init(&barrier, NULL, 2);
+	for (int use = 0;use < 2;++use) {
+		pthread_create(&thread, NULL, gen_worker, use ? &got : NULL);
+		pthread_barrier_wait(&barrier);
+		gen_pool_freeall();
+		pthread_barrier_wait(&barrier);
+		pthread_join(thread, NULL);
+		// Using the pool again takes a new chunk
+		errors += use ? !got || SLAB_COUNT(gen_pool) != 1
+			: gen_pool.slabs || DEPOT_COUNT(gen_pool);
+	}
+	pthread_barrier_destroy(&barrier);
+	gen_pool_freeall();
+	if (errors) {
+		ERROR_MSG("Generation test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += cross_thread();
+	no_errors += stress();
+	no_errors += spill();
+	no_errors += generation();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
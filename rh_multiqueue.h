@@ -0,0 +1,199 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_MULTIQUEUE_H
+#define RH_MULTIQUEUE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sched.h>
+
+#include "rh_heap.h"
+
+#ifndef RH_CACHE_LINE
+#define RH_CACHE_LINE 64
+#endif
+
+// Random pairs tried by rem before it scans every queue
+#ifndef RH_MULTIQUEUE_TRIES
+#define RH_MULTIQUEUE_TRIES 8
+#endif
+
+// Relaxed concurrent priority queue (Rihani, Sanders and Dementiev's
+// MultiQueue)
+// Items are spread over independent heaps, each behind its own try-lock;
+// ins adds to a random heap and rem takes the lesser top of two random heaps,
+// so threads rarely contend but rem only returns an item near the minimum
+// With T threads, c * T queues for c of 2 to 4 is a good starting point
+// rem only fails once it has seen every queue empty
+#define RH_MULTIQUEUE_MAKE(NAME, TYPE, CMP)					\
+	RH_MULTIQUEUE_DEF(NAME, TYPE);						\
+	RH_MULTIQUEUE_IMPL(NAME, TYPE, CMP);
+
+#define RH_MULTIQUEUE_DEF(NAME, TYPE)						\
+RH_HEAP_DEF(NAME##_heap, TYPE);							\
+										\
+typedef struct {								\
+	_Alignas(RH_CACHE_LINE) _Atomic int lock;				\
+	/* Copy of hp.top, read without the lock to skip empty queues */	\
+	_Atomic size_t count;							\
+	NAME##_heap hp;								\
+} NAME##_queue;									\
+										\
+typedef struct {								\
+	size_t no_queues;							\
+	NAME##_queue *queues;							\
+} NAME;										\
+
+#define RH_MULTIQUEUE_IMPL(NAME, TYPE, CMP)					\
+RH_HEAP_IMPL(NAME##_heap, TYPE, CMP)						\
+										\
+static _Thread_local uint64_t NAME##_seed;					\
+										\
+/* xorshift64*, seeded from the address of each thread's own state */		\
+static inline size_t NAME##_pick(NAME *q) {					\
+	uint64_t x = NAME##_seed ?: (uintptr_t) &NAME##_seed;			\
+	x ^= x >> 12;								\
+	x ^= x << 25;								\
+	x ^= x >> 27;								\
+	NAME##_seed = x;							\
+	return ((x * 2685821657736338717LU) >> 32) % q->no_queues;		\
+}										\
+										\
+static inline int NAME##_trylock(NAME##_queue *qu) {				\
+	return !atomic_load_explicit(&qu->lock, memory_order_relaxed)		\
+		&& !atomic_exchange_explicit(&qu->lock, 1,			\
+				memory_order_acquire);				\
+}										\
+										\
+static inline void NAME##_unlock(NAME##_queue *qu) {				\
+	atomic_store_explicit(&qu->count, qu->hp.top, memory_order_relaxed);	\
+	atomic_store_explicit(&qu->lock, 0, memory_order_release);		\
+}										\
+										\
+static inline size_t NAME##_count(NAME##_queue *qu) {				\
+	return atomic_load_explicit(&qu->count, memory_order_relaxed);		\
+}										\
+										\
+static inline int NAME##_init(NAME *q, size_t no_queues) {			\
+	q->no_queues = no_queues ?: 1;						\
+	q->queues = aligned_alloc(RH_CACHE_LINE,				\
+			q->no_queues * sizeof(NAME##_queue));			\
+	if (!q->queues) {							\
+		return 0;							\
+	}									\
+										\
+	for (size_t i = 0;i < q->no_queues;++i) {				\
+		atomic_init(&q->queues[i].lock, 0);				\
+		atomic_init(&q->queues[i].count, 0);				\
+		q->queues[i].hp = (NAME##_heap) {0};				\
+	}									\
+	return 1;								\
+}										\
+										\
+static inline void NAME##_free(NAME *q) {					\
+	for (size_t i = 0;i < q->no_queues;++i) {				\
+		NAME##_heap_free(&q->queues[i].hp);				\
+	}									\
+	free(q->queues);							\
+	*q = (NAME) {0};							\
+}										\
+										\
+/* Approximate while other threads are modifying q */				\
+static inline size_t NAME##_size(NAME *q) {					\
+	size_t size = 0;							\
+	for (size_t i = 0;i < q->no_queues;++i) {				\
+		size += NAME##_count(&q->queues[i]);				\
+	}									\
+	return size;								\
+}										\
+										\
+static inline int NAME##_ins(NAME *q, TYPE item) {				\
+	NAME##_queue *qu = &q->queues[NAME##_pick(q)];				\
+	while (!NAME##_trylock(qu)) {						\
+		qu = &q->queues[NAME##_pick(q)];				\
+	}									\
+										\
+	int ret = NAME##_heap_ins(&qu->hp, item);				\
+	NAME##_unlock(qu);							\
+	return ret;								\
+}										\
+										\
+/* Pops the lesser top of a and b, which must both be locked */			\
+static inline int NAME##_rem_locked(NAME##_queue *a, NAME##_queue *b		\
+		, TYPE *item) {							\
+	if (b->hp.top && (!a->hp.top						\
+	|| CMP(b->hp.items[0], a->hp.items[0]) < 0)) {				\
+		a = b;								\
+	}									\
+	if (!a->hp.top) {							\
+		return 0;							\
+	}									\
+										\
+	*item = NAME##_heap_rem(&a->hp);					\
+	return 1;								\
+}										\
+										\
+static inline int NAME##_rem(NAME *q, TYPE *item) {				\
+	for (size_t tries = 0;tries < RH_MULTIQUEUE_TRIES;++tries) {		\
+		NAME##_queue *a = &q->queues[NAME##_pick(q)];			\
+		NAME##_queue *b = &q->queues[NAME##_pick(q)];			\
+		if ((!NAME##_count(a) && !NAME##_count(b))			\
+		|| !NAME##_trylock(a)) {					\
+			continue;						\
+		}								\
+		/* Settle for a alone if b is busy */				\
+		if (b != a && !NAME##_trylock(b)) {				\
+			b = a;							\
+		}								\
+										\
+		int ret = NAME##_rem_locked(a, b, item);			\
+		NAME##_unlock(a);						\
+		if (b != a) {							\
+			NAME##_unlock(b);					\
+		}								\
+		if (ret) {							\
+			return 1;						\
+		}								\
+	}									\
+										\
+	/* Mostly empty, so check every queue */				\
+	for (size_t i = 0;i < q->no_queues;++i) {				\
+		NAME##_queue *qu = &q->queues[i];				\
+		if (!NAME##_count(qu)) {					\
+			continue;						\
+		}								\
+		while (!NAME##_trylock(qu)) {					\
+			sched_yield();						\
+		}								\
+										\
+		int ret = NAME##_rem_locked(qu, qu, item);			\
+		NAME##_unlock(qu);						\
+		if (ret) {							\
+			return 1;						\
+		}								\
+	}									\
+	return 0;								\
+}										\
+
+#endif
@@ -0,0 +1,184 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_multiqueue.h"
+#include "rh_heap.h"
+#include "rh_bench.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+#define CMP_U64(A, B) (((A) > (B)) - ((A) < (B)))
+
+RH_MULTIQUEUE_MAKE(multiqueue, uint64_t, CMP_U64);
+RH_HEAP_MAKE(locked_heap, uint64_t, CMP_U64);
+
+#define OPS (1 << 21)
+#define PREFILL (1 << 16)
+#define MAX_THREADS 8
+#define QUEUES_PER_THREAD 2
+// Keys are drawn from [0, UNIVERSE) so ranks can be counted exactly
+#define UNIVERSE (1 << 22)
+
+typedef struct {
+	multiqueue mq;
+	locked_heap hp;
+	pthread_mutex_t lock;
+	size_t per_thread;
+	_Atomic uint64_t sum;
+} shared;
+
+typedef struct {
+	shared *s;
+	uint64_t seed;
+} thread_arg;
+
+// Each thread removes an item then inserts a new random one
+static void *multiqueue_worker(void *arg) {
+	thread_arg *a = arg;
+	uint64_t sum = 0;
+	for (size_t i = 0;i < a->s->per_thread;++i) {
+		uint64_t v;
+		if (multiqueue_rem(&a->s->mq, &v)) {
+			sum += v;
+		}
+		multiqueue_ins(&a->s->mq, rh_bench_rand(&a->seed) % UNIVERSE);
+	}
+	atomic_fetch_add(&a->s->sum, sum);
+	return NULL;
+}
+
+static void *locked_worker(void *arg) {
+	thread_arg *a = arg;
+	uint64_t sum = 0;
+	for (size_t i = 0;i < a->s->per_thread;++i) {
+		uint64_t v = rh_bench_rand(&a->seed) % UNIVERSE;
+		pthread_mutex_lock(&a->s->lock);
+		sum += locked_heap_rem(&a->s->hp);
+		locked_heap_ins(&a->s->hp, v);
+		pthread_mutex_unlock(&a->s->lock);
+	}
+	atomic_fetch_add(&a->s->sum, sum);
+	return NULL;
+}
+
+static void run(const char *name, int threads, void *work(void *)) {
+	shared s = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.per_thread = OPS / threads,
+	};
+	uint64_t seed = 3;
+	multiqueue_init(&s.mq, threads * QUEUES_PER_THREAD);
+	s.hp = locked_heap_new(PREFILL);
+	for (size_t i = 0;i < PREFILL;++i) {
+		uint64_t v = rh_bench_rand(&seed) % UNIVERSE;
+		multiqueue_ins(&s.mq, v);
+		locked_heap_ins(&s.hp, v);
+	}
+
+	pthread_t tids[MAX_THREADS];
+	thread_arg args[MAX_THREADS];
+
+	uint64_t start = rh_bench_now();
+	for (int i = 0;i < threads;++i) {
+		args[i] = (thread_arg) {&s, i + 11};
+		pthread_create(&tids[i], NULL, work, &args[i]);
+	}
+	for (int i = 0;i < threads;++i) {
+		pthread_join(tids[i], NULL);
+	}
+	uint64_t end = rh_bench_now();
+
+	char label[64];
+	snprintf(label, sizeof(label), "%s %d threads", name, threads);
+	rh_bench_report(label, OPS, end - start);
+	rh_bench_use(atomic_load(&s.sum));
+
+	multiqueue_free(&s.mq);
+	locked_heap_free(&s.hp);
+}
+
+// Fenwick tree counting the keys currently queued
+static uint32_t fenwick[UNIVERSE + 1];
+
+static void fenwick_add(uint64_t key, int32_t by) {
+	for (size_t i = key + 1;i <= UNIVERSE;i += i & -i) {
+		fenwick[i] += by;
+	}
+}
+
+// Number of queued keys less than key
+static uint64_t fenwick_below(uint64_t key) {
+	uint64_t sum = 0;
+	for (size_t i = key;i;i -= i & -i) {
+		sum += fenwick[i];
+	}
+	return sum;
+}
+
+// The rank error of each removal, i.e. how many queued items were less than
+// the one removed, run on one thread so the queue contents are known
+static void rank_error(size_t no_queues) {
+	multiqueue mq;
+	uint64_t seed = 5;
+	uint64_t total = 0;
+	uint64_t worst = 0;
+
+	multiqueue_init(&mq, no_queues);
+	for (size_t i = 0;i <= UNIVERSE;++i) {
+		fenwick[i] = 0;
+	}
+	for (size_t i = 0;i < PREFILL;++i) {
+		uint64_t v = rh_bench_rand(&seed) % UNIVERSE;
+		multiqueue_ins(&mq, v);
+		fenwick_add(v, 1);
+	}
+
+	for (size_t i = 0;i < OPS;++i) {
+		uint64_t v;
+		multiqueue_rem(&mq, &v);
+		fenwick_add(v, -1);
+		uint64_t rank = fenwick_below(v);
+		total += rank;
+		worst = rank > worst ? rank : worst;
+
+		v = rh_bench_rand(&seed) % UNIVERSE;
+		multiqueue_ins(&mq, v);
+		fenwick_add(v, 1);
+	}
+
+	printf("multiqueue %3zu queues rank error %10.2f mean %8lu max\n"
+			, no_queues, (double) total / OPS, worst);
+	multiqueue_free(&mq);
+}
+
+int main() {
+	for (int t = 1;t <= MAX_THREADS;t *= 2) {
+		run("multiqueue", t, multiqueue_worker);
+		run("locked heap", t, locked_worker);
+	}
+	for (size_t n = 2;n <= MAX_THREADS * QUEUES_PER_THREAD;n *= 2) {
+		rank_error(n);
+	}
+
+	return 0;
+}
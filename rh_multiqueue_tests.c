@@ -0,0 +1,140 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_multiqueue.h"
+#include <stdio.h>
+#include <pthread.h>
+
+#define CMP_U64(A, B) (((A) > (B)) - ((A) < (B)))
+
+RH_MULTIQUEUE_MAKE(test_mq, uint64_t, CMP_U64);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+int empty(void) {
+	test_mq q;
+	if (!test_mq_init(&q, 64)) {
+		ERROR_MSG("Init test FAILED!");
+		return 1;
+	}
+
+	// However few items there are, rem only fails once every queue is empty
+	int errors = 0;
+	uint64_t item;
+	errors += test_mq_rem(&q, &item);
+	for (uint64_t n = 1;n <= 100;++n) {
+		uint64_t sum = 0;
+		for (uint64_t i = 0;i < n;++i) {
+			errors += !test_mq_ins(&q, i);
+		}
+		errors += test_mq_size(&q) != n;
+		for (uint64_t i = 0;i < n;++i) {
+			errors += !test_mq_rem(&q, &item);
+			sum += item;
+		}
+		errors += sum != n * (n - 1) / 2;
+		errors += test_mq_rem(&q, &item) || test_mq_size(&q);
+	}
+	test_mq_free(&q);
+
+	// With one queue it is an exact priority queue
+	if (!test_mq_init(&q, 0)) {
+		ERROR_MSG("Init test FAILED!");
+		return 1;
+	}
+	for (uint64_t i = 0;i < 1000;++i) {
+		errors += !test_mq_ins(&q, i * 7919 % 1000);
+	}
+	for (uint64_t i = 0;i < 1000;++i) {
+		errors += !test_mq_rem(&q, &item) || item != i;
+	}
+	errors += test_mq_rem(&q, &item);
+	test_mq_free(&q);
+	if (errors) {
+		ERROR_MSG("Empty test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+// Threads insert their own items while removing any, then the rest are
+// drained; every item must come out exactly once
+#define THREADS 4
+#define PER_THREAD (1 << 16)
+
+static test_mq shared;
+static _Atomic unsigned char seen[THREADS * PER_THREAD];
+
+static void *worker(void *arg) {
+	uint64_t id = (uintptr_t) arg;
+	uint64_t item;
+	for (uint64_t i = 0;i < PER_THREAD;++i) {
+		test_mq_ins(&shared, id * PER_THREAD + i);
+		if (i & 1 && test_mq_rem(&shared, &item)) {
+			atomic_fetch_add(&seen[item], 1);
+		}
+	}
+	return NULL;
+}
+
+int threads(void) {
+	if (!test_mq_init(&shared, 2 * THREADS)) {
+		ERROR_MSG("Threads init test FAILED!");
+		return 1;
+	}
+
+	pthread_t threads[THREADS];
+	for (uintptr_t i = 0;i < THREADS;++i) {
+		pthread_create(&threads[i], NULL, worker, (void *) i);
+	}
+	for (int i = 0;i < THREADS;++i) {
+		pthread_join(threads[i], NULL);
+	}
+	uint64_t item;
+	while (test_mq_rem(&shared, &item)) {
+		atomic_fetch_add(&seen[item], 1);
+	}
+
+	size_t wrong = 0;
+	for (size_t i = 0;i < THREADS * PER_THREAD;++i) {
+		wrong += seen[i] != 1;
+	}
+	test_mq_free(&shared);
+	if (wrong) {
+		ERROR_MSG("Threads test FAILED! %zu not removed once", wrong);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += empty();
+	no_errors += threads();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -24,6 +24,29 @@
 #define RH_POOL_H
 
 #include <stdlib.h>
+#include <stdint.h>
+
+#include "rh_stat.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+// Strict C modes hide MAP_ANONYMOUS, in which case slabs are never mapped
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifdef MAP_ANONYMOUS
+#define RH_SLAB_MMAP
+#endif
+#endif
+
+#ifdef RH_POOL_DEBUG
+#include <stdio.h>
+#include <string.h>
+#endif
+
+#ifndef RH_CACHE_LINE
+#define RH_CACHE_LINE 64
+#endif
 
 typedef struct rh_mem_link {
 	struct rh_mem_link *link;
@@ -41,7 +64,45 @@ static inline void *rh_pool_alloc(rh_mem_link **pool, void *alloc(size_t), size_
 	return (void *) mem;
 }
 
+// Debug mode reports objects freed while already on the free list, which
+// costs a walk of the list per free, and poisons freed objects of known size
+#ifdef RH_POOL_DEBUG
+#define RH_POOL_POISON 0xdb
+
+static inline int rh_pool_double_free(rh_mem_link *pool, void *mem) {
+	for (;pool;pool = pool->link) {
+		if (pool == mem) {
+			fprintf(stderr, "rh_pool: double free of %p\n", mem);
+			return 1;
+		}
+	}
+	return 0;
+}
+#endif
+
 static inline void rh_pool_free(rh_mem_link **pool, void *mem) {
+#ifdef RH_POOL_DEBUG
+	if (rh_pool_double_free(*pool, mem)) {
+		return;
+	}
+#endif
+	rh_mem_link *l = mem;
+	l->link = *pool;
+	*pool = l;
+}
+
+static inline void rh_pool_free_sized(rh_mem_link **pool, void *mem, size_t size) {
+#ifdef RH_POOL_DEBUG
+	if (rh_pool_double_free(*pool, mem)) {
+		return;
+	}
+	if (size > sizeof(rh_mem_link)) {
+		memset(((rh_mem_link *) mem)->rest, RH_POOL_POISON
+				, size - sizeof(rh_mem_link));
+	}
+#else
+	(void) size;
+#endif
 	rh_mem_link *l = mem;
 	l->link = *pool;
 	*pool = l;
@@ -55,6 +116,125 @@ static inline void rh_pool_freeall(rh_mem_link **pool, void free(void *)) {
 	}
 }
 
+// Slabs: large chunks carved into objects when the free list runs dry, kept
+// in a list so they can all be released at once
+// Objects are size rounded up to a multiple of align, which must be a power of
+// two; chunk must be a multiple of align
+// On Linux, chunks of RH_SLAB_HUGE bytes or more are mapped aligned to it and
+// advised to be backed by transparent huge pages; if the mapping fails, or
+// mmap is not available, they are allocated like smaller chunks
+// RH_MMAP may be defined before including to replace mmap
+typedef struct rh_slab {
+	struct rh_slab *link;
+	size_t size;
+	// Whether the chunk was mapped rather than allocated
+	int mapped;
+} rh_slab;
+
+#define RH_SLAB_CHUNK (1 << 16)
+#define RH_SLAB_HUGE ((size_t) 1 << 21)
+
+#ifndef RH_MMAP
+#define RH_MMAP mmap
+#endif
+
+// Maps chunk bytes aligned to align or RH_SLAB_HUGE, by trimming a larger
+// mapping, or allocates them aligned to align
+static inline rh_slab *rh_slab_map(size_t chunk, size_t align) {
+#ifdef RH_SLAB_MMAP
+	if (chunk >= RH_SLAB_HUGE) {
+		size_t huge = align > RH_SLAB_HUGE ? align : RH_SLAB_HUGE;
+		size_t over = chunk + huge;
+		unsigned char *map = RH_MMAP(NULL, over, PROT_READ | PROT_WRITE
+				, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (map != MAP_FAILED) {
+			unsigned char *start = (unsigned char *) (((uintptr_t) map
+					+ huge - 1) & ~(uintptr_t) (huge - 1));
+			if (start != map) {
+				munmap(map, start - map);
+			}
+			munmap(start + chunk, map + over - (start + chunk));
+#ifdef MADV_HUGEPAGE
+			madvise(start, chunk, MADV_HUGEPAGE);
+#endif
+			rh_slab *slab = (rh_slab *) start;
+			slab->mapped = 1;
+			return slab;
+		}
+	}
+#endif
+	rh_slab *slab = aligned_alloc(align, chunk);
+	if (slab) {
+		slab->mapped = 0;
+	}
+	return slab;
+}
+
+static inline void rh_slab_unmap(rh_slab *slab) {
+#ifdef RH_SLAB_MMAP
+	if (slab->mapped) {
+		munmap(slab, slab->size);
+		return;
+	}
+#endif
+	free(slab);
+}
+
+static inline size_t rh_slab_round(size_t size, size_t align) {
+	return (size + align - 1) & ~(align - 1);
+}
+
+// Pushes every object of a new chunk onto the free list
+static inline int rh_slab_refill(rh_mem_link **pool, rh_slab **slabs
+		, size_t chunk, size_t size, size_t align) {
+	align = align < sizeof(void *) ? sizeof(void *) : align;
+	size = size < sizeof(rh_mem_link) ? sizeof(rh_mem_link) : size;
+	size = rh_slab_round(size, align);
+	size_t start = rh_slab_round(sizeof(rh_slab), align);
+	if (chunk < start + size) {
+		return 0;
+	}
+
+	rh_slab *slab = rh_slab_map(chunk, align);
+	if (!slab) {
+		return 0;
+	}
+	slab->size = chunk;
+	slab->link = *slabs;
+	*slabs = slab;
+
+	// Pushed from the end so objects are handed out in address order
+	unsigned char *base = (unsigned char *) slab + start;
+	for (size_t i = (chunk - start) / size;i--;) {
+		rh_mem_link *l = (rh_mem_link *) (base + i * size);
+		l->link = *pool;
+		*pool = l;
+	}
+	return 1;
+}
+
+static inline void *rh_slab_alloc(rh_mem_link **pool, rh_slab **slabs
+		, size_t chunk, size_t size, size_t align) {
+	if (!*pool && !rh_slab_refill(pool, slabs, chunk, size, align)) {
+		return NULL;
+	}
+
+	rh_mem_link *mem = *pool;
+	*pool = (*pool)->link;
+
+	return (void *) mem;
+}
+
+// Releases every object, whether free or not, in O(chunks)
+static inline void rh_slab_freeall(rh_mem_link **pool, rh_slab **slabs) {
+	*pool = NULL;
+	while (*slabs) {
+		rh_slab *slab = *slabs;
+		*slabs = slab->link;
+		rh_slab_unmap(slab);
+	}
+}
+
 #define RH_SIZEOF(X) sizeof(X)
 
 #define RH_SIZED_POOL_MAKE(NAME, SIZE, ALLOC, FREE)				\
@@ -67,18 +247,56 @@ extern NAME##_pool *NAME;
 
 #define RH_SIZED_POOL_IMPL(NAME, SIZE, ALLOC, FREE)				\
 NAME##_pool *NAME = NULL;							\
+RH_STAT_DEF(NAME, SIZE)								\
 										\
 static inline void *NAME##_alloc(void) {					\
+	RH_STAT_POOL_ALLOC(NAME, NAME ? 0 : SIZE);				\
 	return rh_pool_alloc(&NAME, ALLOC, SIZE);				\
 }										\
 										\
 static inline void NAME##_free(void *to_free) {					\
 	if (!to_free) { return; }						\
-	rh_pool_free(&NAME, to_free);						\
+	RH_STAT_POOL_FREE(NAME);						\
+	rh_pool_free_sized(&NAME, to_free, SIZE);				\
 }										\
 										\
 static inline void NAME##_freeall(void) {					\
 	rh_pool_freeall(&NAME, FREE);						\
+	RH_STAT_POOL_FREEALL(NAME, 0);						\
+}										\
+
+// Slab mode, refilling from CHUNK byte chunks of objects aligned to ALIGN,
+// e.g. RH_SLAB_CHUNK and RH_CACHE_LINE to keep objects on their own lines, or
+// RH_SLAB_HUGE for chunks backed by huge pages
+// freeall releases the chunks, so also frees objects still in use
+#define RH_SIZED_SLAB_POOL_MAKE(NAME, SIZE, CHUNK, ALIGN)			\
+	RH_SIZED_SLAB_POOL_DEF(NAME);						\
+	RH_SIZED_SLAB_POOL_IMPL(NAME, SIZE, CHUNK, ALIGN);
+
+#define RH_SIZED_SLAB_POOL_DEF(NAME)						\
+typedef rh_mem_link NAME##_pool;						\
+extern NAME##_pool *NAME;							\
+extern rh_slab *NAME##_slabs;
+
+#define RH_SIZED_SLAB_POOL_IMPL(NAME, SIZE, CHUNK, ALIGN)			\
+NAME##_pool *NAME = NULL;							\
+rh_slab *NAME##_slabs = NULL;							\
+RH_STAT_DEF(NAME, SIZE)								\
+										\
+static inline void *NAME##_alloc(void) {					\
+	RH_STAT_POOL_ALLOC(NAME, NAME ? 0 : CHUNK);				\
+	return rh_slab_alloc(&NAME, &NAME##_slabs, CHUNK, SIZE, ALIGN);		\
+}										\
+										\
+static inline void NAME##_free(void *to_free) {					\
+	if (!to_free) { return; }						\
+	RH_STAT_POOL_FREE(NAME);						\
+	rh_pool_free_sized(&NAME, to_free, SIZE);				\
+}										\
+										\
+static inline void NAME##_freeall(void) {					\
+	rh_slab_freeall(&NAME, &NAME##_slabs);					\
+	RH_STAT_POOL_FREEALL(NAME, 1);						\
 }										\
 
 #endif
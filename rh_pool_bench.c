@@ -0,0 +1,88 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_pool.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+typedef struct {
+	uint64_t key;
+	void *left, *right;
+} node;
+
+RH_SIZED_POOL_MAKE(node_pool, sizeof(node), malloc, free);
+RH_SIZED_SLAB_POOL_MAKE(node_slab, sizeof(node), RH_SLAB_CHUNK, sizeof(void *));
+RH_SIZED_SLAB_POOL_MAKE(node_line, sizeof(node), RH_SLAB_CHUNK, RH_CACHE_LINE);
+
+#define OBJECTS (1 << 22)
+
+// A cold pool is filled with OBJECTS objects, which are then touched in
+// allocation order, freed, reallocated from the warm free list and released
+// Plain pools only release free objects, so have to free each first
+#define BENCH_POOL(NAME, FREE_EACH)						\
+static void bench_##NAME(node **objs) {						\
+	uint64_t start = rh_bench_now();					\
+	for (size_t i = 0;i < OBJECTS;++i) {					\
+		objs[i] = NAME##_alloc();					\
+		objs[i]->key = i;						\
+	}									\
+	uint64_t cold = rh_bench_now();						\
+	uint64_t sum = 0;							\
+	for (size_t i = 0;i < OBJECTS;++i) {					\
+		sum += objs[i]->key;						\
+	}									\
+	uint64_t walked = rh_bench_now();					\
+	for (size_t i = 0;i < OBJECTS;++i) {					\
+		NAME##_free(objs[i]);						\
+	}									\
+	for (size_t i = 0;i < OBJECTS;++i) {					\
+		objs[i] = NAME##_alloc();					\
+	}									\
+	uint64_t warm = rh_bench_now();						\
+	for (size_t i = 0;FREE_EACH && i < OBJECTS;++i) {			\
+		NAME##_free(objs[i]);						\
+	}									\
+	NAME##_freeall();							\
+	uint64_t end = rh_bench_now();						\
+	rh_bench_use(sum);							\
+										\
+	rh_bench_report(#NAME " cold alloc", OBJECTS, cold - start);		\
+	rh_bench_report(#NAME " walk", OBJECTS, walked - cold);			\
+	rh_bench_report(#NAME " free+alloc", OBJECTS, warm - walked);		\
+	rh_bench_report(#NAME " release", OBJECTS, end - warm);			\
+}
+
+BENCH_POOL(node_pool, 1)
+BENCH_POOL(node_slab, 0)
+BENCH_POOL(node_line, 0)
+
+int main() {
+	node **objs = malloc(OBJECTS * sizeof(*objs));
+
+	bench_node_pool(objs);
+	bench_node_slab(objs);
+	bench_node_line(objs);
+
+	free(objs);
+	return 0;
+}
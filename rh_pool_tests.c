@@ -0,0 +1,125 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include <sys/mman.h>
+
+// Lets mapping a chunk fail, as when huge pages cannot be had
+static int fail_mmap = 0;
+
+static void *test_mmap(void *addr, size_t len, int prot, int flags, int fd
+		, off_t off) {
+	return fail_mmap ? MAP_FAILED : mmap(addr, len, prot, flags, fd, off);
+}
+
+#define RH_MMAP test_mmap
+
+#include "rh_pool.h"
+#include <stdio.h>
+#include <string.h>
+
+RH_SIZED_SLAB_POOL_MAKE(small_pool, 48, 4096, 16);
+RH_SIZED_SLAB_POOL_MAKE(huge_pool, 64, RH_SLAB_HUGE, 64);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+// Objects come out in address order, aligned, and freed ones are reused first
+int small_slab(void) {
+	unsigned char *a = small_pool_alloc();
+	unsigned char *b = small_pool_alloc();
+	unsigned char *c = small_pool_alloc();
+	int errors = b != a + 48 || c != b + 48 || (uintptr_t) a % 16;
+	errors += !small_pool_slabs || small_pool_slabs->mapped;
+	small_pool_free(b);
+	small_pool_free(a);
+	errors += small_pool_alloc() != a || small_pool_alloc() != b;
+
+	// Enough for a second chunk
+	for (int i = 0;i < 100;++i) {
+		errors += !small_pool_alloc();
+	}
+	errors += !small_pool_slabs->link || small_pool_slabs->link->link;
+	small_pool_freeall();
+	errors += small_pool != NULL || small_pool_slabs != NULL;
+	if (errors) {
+		ERROR_MSG("Small slab test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+// Fills a whole huge chunk, checking every object is usable and reused
+#define HUGE_COUNT ((RH_SLAB_HUGE - 64) / 64)
+
+static int fill_huge(int mapped) {
+	int errors = 0;
+	unsigned char *mem = NULL;
+	for (size_t i = 0;i < HUGE_COUNT;++i) {
+		mem = huge_pool_alloc();
+		errors += !mem || (uintptr_t) mem % 64;
+		if (mem) {
+			memset(mem, 0xab, 64);
+		}
+	}
+
+	rh_slab *slab = huge_pool_slabs;
+	errors += !slab || slab->link || slab->size != RH_SLAB_HUGE;
+	// The chunk is used up exactly
+	errors += huge_pool != NULL;
+#ifdef RH_SLAB_MMAP
+	errors += slab->mapped != mapped;
+	errors += mapped && (uintptr_t) slab % RH_SLAB_HUGE;
+#else
+	errors += slab->mapped;
+	(void) mapped;
+#endif
+
+	huge_pool_free(mem);
+	errors += huge_pool_alloc() != mem || huge_pool_slabs != slab;
+	huge_pool_freeall();
+	return errors;
+}
+
+int huge_slab(void) {
+	int errors = fill_huge(1);
+	// Without huge pages the chunk is allocated and used the same way
+	fail_mmap = 1;
+	errors += fill_huge(0);
+	fail_mmap = 0;
+	if (errors) {
+		ERROR_MSG("Huge slab test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += small_slab();
+	no_errors += huge_slab();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -0,0 +1,158 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_vec.h"
+#include "rh_mat.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+RH_VEC_MAKE(float);
+RH_VEC_MAKE(double);
+RH_MAT_MAKE(float);
+RH_MAT_MAKE(double);
+RH_MAT_VEC_IMPL(float);
+RH_MAT_VEC_IMPL(double);
+
+// An animation update's worth of joints, resident in L1/L2
+#define COUNT 4096
+#define ROUNDS 1024
+
+#define BENCH(TYPE)								\
+static void bench_##TYPE(void) {						\
+	static q##TYPE qa[COUNT], qb[COUNT], qc[COUNT];				\
+	static v3##TYPE v[COUNT], vc[COUNT];					\
+	static TYPE t[COUNT];							\
+	uint64_t seed = 5;							\
+	for (size_t i = 0;i < COUNT;++i) {					\
+		for (int k = 0;k < 4;++k) {					\
+			qa[i].array[k] = (rh_bench_rand(&seed) >> 40) * 0x1p-24;\
+			qb[i].array[k] = (rh_bench_rand(&seed) >> 40) * 0x1p-24;\
+		}								\
+		qa[i] = q##TYPE##_norm(qa[i]);					\
+		qb[i] = q##TYPE##_norm(qb[i]);					\
+		for (int k = 0;k < 3;++k) {					\
+			v[i].array[k] = (rh_bench_rand(&seed) >> 40) * 0x1p-24;	\
+		}								\
+		t[i] = (rh_bench_rand(&seed) >> 40) * 0x1p-24;			\
+	}									\
+	q##TYPE##_batch a = q##TYPE##_batch_from(qa, COUNT);			\
+	q##TYPE##_batch b = q##TYPE##_batch_from(qb, COUNT);			\
+	q##TYPE##_batch c = q##TYPE##_batch_new(COUNT);				\
+	v3##TYPE##_batch vb = v3##TYPE##_batch_from(v, COUNT);			\
+	v3##TYPE##_batch vcb = v3##TYPE##_batch_new(COUNT);			\
+										\
+	TYPE check = 0;								\
+	uint64_t ops = (uint64_t) COUNT * ROUNDS;				\
+	uint64_t start, end;							\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			vc[i] = q##TYPE##_rotate(qa[i], v[i]);			\
+		}								\
+		check += vc[r].x;						\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("q" #TYPE " rotate", ops, end - start);			\
+										\
+	/* Building the rotation matrix first, as callers did before */		\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			vc[i] = m3##TYPE##_mul_vec(q##TYPE##_to_m3(qa[i]), v[i]);\
+		}								\
+		check += vc[r].x;						\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("q" #TYPE " rotate via m3", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		q##TYPE##_batch_rotate(&vcb, &a, &vb);				\
+		check += vcb.x[r];						\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("q" #TYPE " batch rotate", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			qc[i] = q##TYPE##_mul(qa[i], qb[i]);			\
+		}								\
+		check += qc[r].x;						\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("q" #TYPE " mul", ops, end - start);			\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		q##TYPE##_batch_mul(&c, &a, &b);				\
+		check += c.x[r];						\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("q" #TYPE " batch mul", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			qc[i] = q##TYPE##_nlerp(qa[i], qb[i], t[i]);		\
+		}								\
+		check += qc[r].x;						\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("q" #TYPE " nlerp", ops, end - start);			\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			qc[i] = q##TYPE##_slerp(qa[i], qb[i], t[i]);		\
+		}								\
+		check += qc[r].x;						\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("q" #TYPE " slerp", ops, end - start);			\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		q##TYPE##_batch_slerp(&c, &a, &b, t);				\
+		check += c.x[r];						\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("q" #TYPE " batch slerp", ops, end - start);		\
+										\
+	rh_bench_use(check);							\
+	q##TYPE##_batch_free(&a);						\
+	q##TYPE##_batch_free(&b);						\
+	q##TYPE##_batch_free(&c);						\
+	v3##TYPE##_batch_free(&vb);						\
+	v3##TYPE##_batch_free(&vcb);						\
+}
+
+BENCH(float)
+BENCH(double)
+
+int main() {
+	bench_float();
+	bench_double();
+	return 0;
+}
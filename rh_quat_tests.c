@@ -0,0 +1,250 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_vec.h"
+#include "rh_mat.h"
+#include "rh_bench.h"
+
+#include <stdio.h>
+#include <math.h>
+
+RH_VEC_MAKE(float);
+RH_VEC_MAKE(double);
+RH_MAT_MAKE(float);
+RH_MAT_MAKE(double);
+RH_MAT_VEC_IMPL(float);
+RH_MAT_VEC_IMPL(double);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+#define ROUNDS 1000
+// Odd, so batches have tails for every vector width
+#define BATCH 1001
+
+static double rand_val(uint64_t *seed) {
+	return (rh_bench_rand(seed) >> 11) * (2.0 / (1LU << 53)) - 1;
+}
+
+#define HELPERS(TYPE)								\
+static q##TYPE rand_q##TYPE(uint64_t *seed) {					\
+	q##TYPE q = {{rand_val(seed), rand_val(seed), rand_val(seed)		\
+		, rand_val(seed)}};						\
+	return q##TYPE##_norm(q);						\
+}										\
+										\
+static v3##TYPE rand_v3##TYPE(uint64_t *seed) {					\
+	return (v3##TYPE) {{rand_val(seed), rand_val(seed), rand_val(seed)}};	\
+}										\
+										\
+static double diff_v3##TYPE(const v3##TYPE a, const v3##TYPE b) {		\
+	double max = 0;								\
+	for (int i = 0;i < 3;++i) {						\
+		double d = fabs((double) a.array[i] - b.array[i]);		\
+		max = d > max ? d : max;					\
+	}									\
+	return max;								\
+}										\
+										\
+/* q and -q are the same rotation */						\
+static double diff_q##TYPE(const q##TYPE a, const q##TYPE b) {			\
+	double max = 0, neg = 0;						\
+	for (int i = 0;i < 4;++i) {						\
+		double d = fabs((double) a.array[i] - b.array[i]);		\
+		double e = fabs((double) a.array[i] + b.array[i]);		\
+		max = d > max ? d : max;					\
+		neg = e > neg ? e : neg;					\
+	}									\
+	return max < neg ? max : neg;						\
+}
+
+HELPERS(float)
+HELPERS(double)
+
+#define WORST(WORST, X) do {							\
+	double _x = isnan(X) ? INFINITY : (X);					\
+	WORST = _x > WORST ? _x : WORST;					\
+} while (0)
+
+#define CHECK_ROTATE(TYPE, EPS)							\
+int rotate_##TYPE(void) {							\
+	uint64_t seed = 1;							\
+	double worst = 0;							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		q##TYPE a = rand_q##TYPE(&seed), b = rand_q##TYPE(&seed);	\
+		v3##TYPE v = rand_v3##TYPE(&seed);				\
+		v3##TYPE rv = q##TYPE##_rotate(a, v);				\
+										\
+		WORST(worst, diff_v3##TYPE(rv					\
+				, m3##TYPE##_mul_vec(q##TYPE##_to_m3(a), v)));	\
+		WORST(worst, diff_v3##TYPE(rv					\
+				, m4##TYPE##_mul_dir(q##TYPE##_to_m4(a), v)));	\
+		WORST(worst, diff_v3##TYPE(q##TYPE##_rotate(q##TYPE##_mul(a, b), v)\
+				, q##TYPE##_rotate(a, q##TYPE##_rotate(b, v))));\
+		WORST(worst, diff_v3##TYPE(v					\
+				, q##TYPE##_rotate(q##TYPE##_conj(a), rv)));	\
+		WORST(worst, diff_q##TYPE(q##TYPE##_identity()			\
+				, q##TYPE##_mul(a, q##TYPE##_inv(a))));		\
+		WORST(worst, fabs(v3##TYPE##_dot(rv, rv) - v3##TYPE##_dot(v, v)));\
+		WORST(worst, diff_q##TYPE(a					\
+				, q##TYPE##_from_m3(q##TYPE##_to_m3(a))));	\
+		WORST(worst, diff_q##TYPE(a					\
+				, q##TYPE##_from_m4(q##TYPE##_to_m4(a))));	\
+	}									\
+										\
+	/* A quarter turn about z takes x to y */				\
+	q##TYPE z = q##TYPE##_axis_angle((v3##TYPE) {{0, 0, 1}}, M_PI / 2);	\
+	WORST(worst, diff_v3##TYPE(q##TYPE##_rotate(z, (v3##TYPE) {{1, 0, 0}})	\
+			, (v3##TYPE) {{0, 1, 0}}));				\
+	/* Each branch of from_m3, with w, x, y then z largest */		\
+	q##TYPE big[] = {{{0.1, 0.2, 0.3, 0.9}}, {{0.9, 0.3, 0.2, 0.1}}		\
+		, {{0.1, 0.9, 0.3, 0.2}}, {{0.3, 0.1, 0.9, 0.2}}		\
+		, {{0, 0, 0, -1}}, {{0, 0, 1, 0}}};				\
+	for (size_t i = 0;i < sizeof(big) / sizeof(big[0]);++i) {		\
+		q##TYPE q = q##TYPE##_norm(big[i]);				\
+		WORST(worst, diff_q##TYPE(q, q##TYPE##_from_m3(q##TYPE##_to_m3(q))));\
+	}									\
+										\
+	if (worst > EPS) {							\
+		ERROR_MSG(#TYPE " rotate test FAILED! worst %g", worst);	\
+		return 1;							\
+	}									\
+	return 0;								\
+}
+
+CHECK_ROTATE(float, 1e-5)
+CHECK_ROTATE(double, 1e-13)
+
+// Interpolating from the identity about a fixed axis interpolates the angle
+#define CHECK_SLERP(TYPE, EPS)							\
+int slerp_##TYPE(void) {							\
+	uint64_t seed = 2;							\
+	double worst = 0;							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		v3##TYPE axis = v3##TYPE##_norm(rand_v3##TYPE(&seed));		\
+		TYPE angle = rand_val(&seed) * 3;				\
+		TYPE t = (rand_val(&seed) + 1) / 2;				\
+		q##TYPE id = q##TYPE##_identity();				\
+		q##TYPE to = q##TYPE##_axis_angle(axis, angle);			\
+		q##TYPE want = q##TYPE##_axis_angle(axis, angle * t);		\
+										\
+		WORST(worst, diff_q##TYPE(want, q##TYPE##_slerp(id, to, t)));	\
+		/* The longer way round is never taken */			\
+		to = (q##TYPE) {{-to.x, -to.y, -to.z, -to.w}};			\
+		WORST(worst, diff_q##TYPE(want, q##TYPE##_slerp(id, to, t)));	\
+		WORST(worst, diff_q##TYPE(to, q##TYPE##_slerp(id, to, 1)));	\
+		WORST(worst, diff_q##TYPE(id, q##TYPE##_slerp(id, to, 0)));	\
+										\
+		q##TYPE n = q##TYPE##_nlerp(id, to, t);				\
+		WORST(worst, fabs(q##TYPE##_dot(n, n) - 1));			\
+		WORST(worst, diff_q##TYPE(to, q##TYPE##_nlerp(id, to, 1)));	\
+		/* nlerp agrees with slerp at the midpoint */			\
+		WORST(worst, diff_q##TYPE(q##TYPE##_slerp(id, to, 0.5)		\
+				, q##TYPE##_nlerp(id, to, 0.5)));		\
+	}									\
+										\
+	/* Nearly and exactly equal inputs */					\
+	q##TYPE a = q##TYPE##_axis_angle((v3##TYPE) {{1, 0, 0}}, 0.01);		\
+	WORST(worst, diff_q##TYPE(q##TYPE##_axis_angle(				\
+			(v3##TYPE) {{1, 0, 0}}, 0.005)				\
+			, q##TYPE##_slerp(q##TYPE##_identity(), a, 0.5)));	\
+	WORST(worst, diff_q##TYPE(a, q##TYPE##_slerp(a, a, 0.3)));		\
+	WORST(worst, diff_q##TYPE(a, q##TYPE##_nlerp(a, a, 0.3)));		\
+										\
+	if (worst > EPS) {							\
+		ERROR_MSG(#TYPE " slerp test FAILED! worst %g", worst);		\
+		return 1;							\
+	}									\
+	return 0;								\
+}
+
+CHECK_SLERP(float, 1e-5)
+CHECK_SLERP(double, 1e-12)
+
+// The batch kernels against the per quaternion functions, in place for mul
+#define CHECK_BATCH(TYPE, EPS, SLERP_EPS)					\
+int batch_##TYPE(void) {							\
+	static q##TYPE qa[BATCH], qb[BATCH];					\
+	static v3##TYPE v[BATCH];						\
+	static TYPE t[BATCH];							\
+	uint64_t seed = 3;							\
+	for (int i = 0;i < BATCH;++i) {						\
+		qa[i] = rand_q##TYPE(&seed);					\
+		qb[i] = rand_q##TYPE(&seed);					\
+		v[i] = rand_v3##TYPE(&seed);					\
+		t[i] = (rand_val(&seed) + 1) / 2;				\
+	}									\
+	/* Identical and opposite pairs */					\
+	qb[0] = qa[0];								\
+	qb[1] = (q##TYPE) {{-qa[1].x, -qa[1].y, -qa[1].z, -qa[1].w}};		\
+										\
+	q##TYPE##_batch a = q##TYPE##_batch_from(qa, BATCH);			\
+	q##TYPE##_batch b = q##TYPE##_batch_from(qb, BATCH);			\
+	q##TYPE##_batch c = {0};						\
+	v3##TYPE##_batch vb = v3##TYPE##_batch_from(v, BATCH), vc = {0};	\
+	double worst = 0, worst_slerp = 0;					\
+	int errors = !q##TYPE##_batch_rotate(&vc, &a, &vb)			\
+		|| !q##TYPE##_batch_slerp(&c, &a, &b, t);			\
+										\
+	for (int i = 0;i < BATCH && !errors;++i) {				\
+		WORST(worst, diff_v3##TYPE(v3##TYPE##_batch_get(&vc, i)		\
+				, q##TYPE##_rotate(qa[i], v[i])));		\
+		WORST(worst_slerp, diff_q##TYPE(q##TYPE##_batch_get(&c, i)	\
+				, q##TYPE##_slerp(qa[i], qb[i], t[i])));	\
+	}									\
+	errors += !q##TYPE##_batch_mul(&a, &a, &b);				\
+	for (int i = 0;i < BATCH && !errors;++i) {				\
+		WORST(worst, diff_q##TYPE(q##TYPE##_batch_get(&a, i)		\
+				, q##TYPE##_mul(qa[i], qb[i])));		\
+	}									\
+										\
+	q##TYPE##_batch_free(&a);						\
+	q##TYPE##_batch_free(&b);						\
+	q##TYPE##_batch_free(&c);						\
+	v3##TYPE##_batch_free(&vb);						\
+	v3##TYPE##_batch_free(&vc);						\
+	if (errors || worst > EPS || worst_slerp > SLERP_EPS) {			\
+		ERROR_MSG(#TYPE " batch test FAILED! worst %g, slerp %g"	\
+				, worst, worst_slerp);				\
+		return 1;							\
+	}									\
+	return 0;								\
+}
+
+CHECK_BATCH(float, 1e-6, 1e-6)
+CHECK_BATCH(double, 1e-15, 1e-7)
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += rotate_float();
+	no_errors += rotate_double();
+	no_errors += slerp_float();
+	no_errors += slerp_double();
+	no_errors += batch_float();
+	no_errors += batch_double();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
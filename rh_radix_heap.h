@@ -0,0 +1,151 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_RADIX_HEAP_H
+#define RH_RADIX_HEAP_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "rh_al.h"
+
+// Monotone priority queue for unsigned integer keys, where no key inserted is
+// less than the last key removed (e.g. event simulation, Dijkstra)
+// Bucket b holds keys whose highest bit differing from the last removed key
+// is bit b - 1, bucket 0 holding keys equal to it; removal empties the first
+// non empty bucket into lower ones, so each item moves at most once per bit
+// Buckets are array lists, so both inserting and redistributing are
+// sequential appends
+#define RH_RADIX_HEAP_MAKE(NAME, KEY_T, VALUE_T)				\
+	RH_RADIX_HEAP_DEF(NAME, KEY_T, VALUE_T);				\
+	RH_RADIX_HEAP_IMPL(NAME, KEY_T, VALUE_T);
+
+#define RH_RADIX_HEAP_DEF(NAME, KEY_T, VALUE_T)					\
+typedef struct {								\
+	KEY_T key;								\
+	VALUE_T value;								\
+} NAME##_entry;									\
+										\
+RH_AL_DEF(NAME##_bucket, NAME##_entry)						\
+										\
+typedef struct {								\
+	size_t no_items;							\
+	KEY_T last;								\
+										\
+	NAME##_bucket buckets[sizeof(KEY_T) * 8 + 1];				\
+} NAME;										\
+
+#define RH_RADIX_HEAP_IMPL(NAME, KEY_T, VALUE_T)				\
+RH_AL_IMPL(NAME##_bucket, NAME##_entry)						\
+										\
+static inline size_t NAME##_bucket_of(NAME *hp, KEY_T key) {			\
+	unsigned long long diff = key ^ hp->last;				\
+	return diff ? 64 - __builtin_clzll(diff) : 0;				\
+}										\
+										\
+static inline void NAME##_free(NAME *hp) {					\
+	for (size_t i = 0;i < sizeof(KEY_T) * 8 + 1;++i) {			\
+		NAME##_bucket_free(&hp->buckets[i]);				\
+	}									\
+	*hp = (NAME) {0};							\
+}										\
+										\
+/* Fails if key is less than the last key removed */				\
+static inline int NAME##_ins(NAME *hp, KEY_T key, VALUE_T value) {		\
+	if (key < hp->last) {							\
+		return 0;							\
+	}									\
+										\
+	NAME##_entry e = {key, value};						\
+	if (!NAME##_bucket_push(&hp->buckets[NAME##_bucket_of(hp, key)], e)) {	\
+		return 0;							\
+	}									\
+	++hp->no_items;								\
+	return 1;								\
+}										\
+										\
+/* Empties a bucket at once, accounted like popping every item */		\
+static inline void NAME##_unuse(NAME##_bucket *bucket) {			\
+	RH_STAT_UNUSE(NAME##_bucket, bucket->top * sizeof(NAME##_entry));	\
+	bucket->top = 0;							\
+}										\
+										\
+/* Moves the least keys into bucket 0, returning 0 if empty or, leaving */	\
+/* the heap as it was, if the lower buckets cannot grow to take them */		\
+static inline int NAME##_fill(NAME *hp) {					\
+	if (hp->buckets[0].top) {						\
+		return 1;							\
+	}									\
+	if (!hp->no_items) {							\
+		return 0;							\
+	}									\
+										\
+	size_t b = 1;								\
+	while (!hp->buckets[b].top) {						\
+		++b;								\
+	}									\
+										\
+	NAME##_bucket *from = &hp->buckets[b];					\
+	KEY_T min = from->items[0].key;						\
+	for (size_t i = 1;i < from->top;++i) {					\
+		min = from->items[i].key < min ? from->items[i].key : min;	\
+	}									\
+										\
+	/* Every item now differs from min below bit b - 1, so goes to one */	\
+	/* of the buckets below b, all empty, and from keeps every item */	\
+	/* until done, so a failed push is undone by emptying them again */	\
+	KEY_T last = hp->last;							\
+	hp->last = min;								\
+	for (size_t i = 0;i < from->top;++i) {					\
+		NAME##_entry e = from->items[i];				\
+		if (!NAME##_bucket_push(&hp->buckets[NAME##_bucket_of(hp	\
+						, e.key)], e)) {		\
+			for (size_t k = 0;k < b;++k) {				\
+				NAME##_unuse(&hp->buckets[k]);			\
+			}							\
+			hp->last = last;					\
+			return 0;						\
+		}								\
+	}									\
+	NAME##_unuse(from);							\
+	return 1;								\
+}										\
+										\
+static inline KEY_T NAME##_peek_key(NAME *hp) {					\
+	return NAME##_fill(hp) ? hp->last : 0;					\
+}										\
+										\
+/* Removes an item with the least key, setting *key if not NULL */		\
+/* Out of memory leaves no_items as it was, unlike an empty heap */		\
+static inline VALUE_T NAME##_rem(NAME *hp, KEY_T *key) {			\
+	if (!NAME##_fill(hp)) {							\
+		return (VALUE_T) {0};						\
+	}									\
+										\
+	--hp->no_items;								\
+	if (key) {								\
+		*key = hp->last;						\
+	}									\
+	return NAME##_bucket_pop(&hp->buckets[0]).value;			\
+}										\
+
+#endif
@@ -0,0 +1,107 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_radix_heap.h"
+#include "rh_heap.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+typedef struct {
+	uint64_t key;
+	uint32_t value;
+} event;
+
+#define CMP_EVENT(A, B) (((A).key > (B).key) - ((A).key < (B).key))
+
+RH_HEAP_MAKE(event_heap, event, CMP_EVENT);
+RH_RADIX_HEAP_MAKE(event_radix, uint64_t, uint32_t);
+
+#define OPS (1 << 22)
+
+// The hold model of a discrete event simulation: keep n events pending,
+// remove the earliest and schedule one a random delay below range after it
+static void bench_heap(size_t n, uint64_t range) {
+	event_heap hp = event_heap_new(16);
+	uint64_t seed = 7;
+	uint64_t check = 0;
+	char label[64];
+
+	for (size_t i = 0;i < n;++i) {
+		event_heap_ins(&hp, (event) {rh_bench_rand(&seed) % range, i});
+	}
+	uint64_t start = rh_bench_now();
+	uint64_t last = 0;
+	for (size_t i = 0;i < OPS;++i) {
+		event e = event_heap_rem(&hp);
+		check += e.key < last;
+		last = e.key;
+		e.key += rh_bench_rand(&seed) % range;
+		event_heap_ins(&hp, e);
+	}
+	uint64_t end = rh_bench_now();
+
+	snprintf(label, sizeof(label), "event_heap %zu range %lu", n, range);
+	rh_bench_report(label, OPS, end - start);
+	if (check) {
+		fprintf(stderr, "event_heap removed out of order\n");
+	}
+	event_heap_free(&hp);
+}
+
+static void bench_radix(size_t n, uint64_t range) {
+	event_radix hp = {0};
+	uint64_t seed = 7;
+	uint64_t check = 0;
+	char label[64];
+
+	for (size_t i = 0;i < n;++i) {
+		event_radix_ins(&hp, rh_bench_rand(&seed) % range, i);
+	}
+	uint64_t start = rh_bench_now();
+	uint64_t last = 0;
+	for (size_t i = 0;i < OPS;++i) {
+		uint64_t key = 0;
+		uint32_t value = event_radix_rem(&hp, &key);
+		check += key < last;
+		last = key;
+		event_radix_ins(&hp, key + rh_bench_rand(&seed) % range, value);
+	}
+	uint64_t end = rh_bench_now();
+
+	snprintf(label, sizeof(label), "event_radix %zu range %lu", n, range);
+	rh_bench_report(label, OPS, end - start);
+	if (check) {
+		fprintf(stderr, "event_radix removed out of order\n");
+	}
+	event_radix_free(&hp);
+}
+
+int main(void) {
+	for (size_t n = 1 << 10;n <= 1 << 20;n <<= 5) {
+		for (uint64_t range = 1 << 8;range <= 1LU << 32;range <<= 12) {
+			bench_heap(n, range);
+			bench_radix(n, range);
+		}
+	}
+	return 0;
+}
@@ -26,34 +26,78 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Small vector with N items stored inline, spilling to the heap beyond that
+// The inline items share storage with the heap pointer, so the struct may be
+// copied and returned by value freely
+#define RH_SMALL_VEC_MAKE(NAME, TYPE, N)					\
+	RH_SMALL_VEC_DEF(NAME, TYPE, N);					\
+	RH_SMALL_VEC_IMPL(NAME, TYPE, N);
+
+// The short array list is a small vector holding as many items inline as fit
+// in the space of the heap pointer and size, with a minimum of one
+#define RH_SHORT_AL_NO(TYPE)							\
+	((sizeof(size_t) + sizeof(TYPE *)) / sizeof(TYPE) ?: 1)
+
 #define RH_SHORT_AL_MAKE(NAME, TYPE)					 	\
 	RH_SHORT_AL_DEF(NAME, TYPE);						\
 	RH_SHORT_AL_IMPL(NAME, TYPE);
 
+#define RH_SHORT_AL_DEF(NAME, TYPE)						\
+	RH_SMALL_VEC_DEF(NAME, TYPE, RH_SHORT_AL_NO(TYPE))
+
+#define RH_SHORT_AL_IMPL(NAME, TYPE)						\
+	RH_SMALL_VEC_IMPL(NAME, TYPE, RH_SHORT_AL_NO(TYPE))
+
+#define RH_SMALL_VEC_N(al) (sizeof((al).short_items)/sizeof((al).short_items[0]))
+
 // Useful iteration macro
-#define rh_al_for(iter, al)							\
-if (al.items)									\
-	for (size_t _i = 0;iter = al.items[_i], _i < al.top;++_i)	 	\
+#define rh_small_vec_for(iter, al)						\
+	for (size_t _i = 0, _j = 0; _i < (al).top; ++_i, _j=0)			\
+		for (iter = ((al).size > RH_SMALL_VEC_N(al)			\
+				? (al).items : (al).short_items)[_i]; !_j; _j = 1)
 
-#define RH_SHORT_AL_DEF(NAME, TYPE)						\
+// Useful iteration macro
+#define rh_small_vec_ref_for(iter, al)						\
+	for (size_t _i = 0, _j = 0; _i < (al).top; ++_i, _j=0)			\
+		for (iter = &((al).size > RH_SMALL_VEC_N(al)			\
+				? (al).items : (al).short_items)[_i]; !_j; _j = 1)
+
+#define rh_short_al_for rh_small_vec_for
+#define rh_short_al_ref_for rh_small_vec_ref_for
+
+// size is the heap capacity once spilled, and is at most N while inline
+#define RH_SMALL_VEC_DEF(NAME, TYPE, N)						\
 typedef struct {								\
+	size_t size;								\
 	size_t top;								\
 	union {									\
-		TYPE *short_items[(sizeof(size_t) + sizeof(TYPE *)) / sizeof(TYPE)];\
-		struct {							\
-			size_t size;						\
-			TYPE *items;						\
-		};								\
-	}									\
+		TYPE short_items[N];						\
+		TYPE *items;							\
+	};									\
 } NAME;										\
 
-#define RH_SHORT_AL_IMPL(NAME, TYPE)						\
-const size_t NAME##_short_no = (sizeof(size_t) + sizeof(TYPE *));		\
+#define RH_SMALL_VEC_IMPL(NAME, TYPE, N)					\
+static inline TYPE *NAME##_items(NAME *al) {					\
+	return al->size > (N) ? al->items : al->short_items;			\
+}										\
+										\
 static inline size_t NAME##_resize(NAME *al, size_t to) {			\
-	if (al->top <= NAME##_short_no) {					\
-		if (to <= NAME##_short_no) {					\
-			return 1;						\
+	if (al->top > to) {							\
+		return 0;							\
+	}									\
+										\
+	if (to <= (N)) {							\
+		if (al->size > (N)) {						\
+			TYPE *old = al->items;					\
+			memcpy(al->short_items, old, al->top * sizeof(TYPE));	\
+			free(old);						\
 		}								\
+		al->size = (N);							\
+										\
+		return al->size;						\
+	}									\
+										\
+	if (al->size <= (N)) {							\
 		TYPE *new = malloc(to * sizeof(TYPE));				\
 		if (!new) {							\
 			return 0;						\
@@ -66,15 +110,6 @@ static inline size_t NAME##_resize(NAME *al, size_t to) {			\
 		return al->size;						\
 	}									\
 										\
-	if (to <= NAME##_short_no) {						\
-		TYPE *old = al->items;						\
-		memcpy(al->short_items, old, to * sizeof(TYPE));		\
-		free(old);							\
-		al->top = (al->top > to) ? to : al->top;			\
-										\
-		return to;							\
-	}									\
-										\
 	TYPE *new = realloc(al->items, to * sizeof(TYPE));			\
 	if (!new) {								\
 		return 0;							\
@@ -87,29 +122,31 @@ static inline size_t NAME##_resize(NAME *al, size_t to) {			\
 }										\
 										\
 static inline void NAME##_free(NAME *al) {					\
-	free(al->items);							\
+	if (al->size > (N)) {							\
+		free(al->items);						\
+	}									\
+	*al = (NAME) {0};							\
 }										\
 										\
 static inline NAME NAME##_new(size_t size) {					\
 	NAME ret = {0};								\
 	NAME##_resize(&ret, size);						\
-	memset(ret.items, 0, size * sizeof(TYPE));				\
+	memset(NAME##_items(&ret), 0,						\
+		(size > (N) ? size : (N)) * sizeof(TYPE));			\
 	return ret;								\
 }										\
 										\
 static inline NAME NAME##_clone(NAME *al) {					\
-	if (!al->items || !al->top) {						\
-		return (NAME) {0};						\
+	if (al->size <= (N)) {							\
+		return *al;							\
 	}									\
 										\
 	NAME ret = {0};								\
-	NAME##_resize(&ret, al->size);						\
-	ret.top = al->top;							\
-	if (al->top >= NAME##_short_no) {					\
-		memcpy(ret.short_items, al->short_items, al->top * sizeof(TYPE));\
-	} else {								\
-		memcpy(ret.items, al->items, al->top * sizeof(TYPE));		\
+	if (!NAME##_resize(&ret, al->size)) {					\
+		return (NAME) {0};						\
 	}									\
+	ret.top = al->top;							\
+	memcpy(ret.items, al->items, al->top * sizeof(TYPE));			\
 	return ret;								\
 }										\
 										\
@@ -117,49 +154,27 @@ static inline TYPE *NAME##_peek(NAME *al) {					\
 	if (!al->top) {								\
 		return NULL;							\
 	}									\
-	if (al->top >= NAME##_short_no) {					\
-		return &al->short_items[al->top - 1];				\
-	} else {								\
-		return &al->items[al->top - 1];					\
-	}									\
+	return &NAME##_items(al)[al->top - 1];					\
 }										\
 										\
 static inline int NAME##_push(NAME *al, TYPE push) {				\
-	if (al->size < NAME##_short_no) {					\
-		al->short_items[al->top++] = push;				\
-		return 1;							\
-	}									\
-										\
-	if (al->top != NAME##_short_no && al->top != al->size) {		\
-		al->items[al->top++] = push;					\
-		return 1;							\
-	}									\
-										\
-	if (!NAME##_resize(al, al->top * 2)) {					\
+	size_t size = al->size > (N) ? al->size : (N);				\
+	if (al->top == size && !NAME##_resize(al, size * 2)) {			\
 		return 0;							\
 	}									\
 										\
-	al->items[al->top++] = push;						\
+	NAME##_items(al)[al->top++] = push;					\
 	return 1;								\
-										\
 }										\
 										\
+/* Popping never moves items back inline, as a list oscillating around */	\
+/* N items would otherwise copy on every push and pop; resize to shrink */	\
 static inline TYPE NAME##_pop(NAME *al) {					\
 	if (!al->top) {								\
 		return (TYPE) {0};						\
 	}									\
 										\
-	if (al->top <= NAME##_short_no) {					\
-		return al->short_items[--al->top];				\
-	}									\
-										\
-	if (al->top > NAME##_short_no + 1) {					\
-		return al->items[--al->top];					\
-	}									\
-										\
-	TYPE ret = al->items[--al->top];					\
-	NAME##_resize(al, al->top);						\
-	return ret;								\
+	return NAME##_items(al)[--al->top];					\
 }										\
 										\
 static inline TYPE NAME##_view(NAME *al, size_t pos) {				\
@@ -167,11 +182,7 @@ static inline TYPE NAME##_view(NAME *al, size_t pos) {				\
 		return (TYPE) {0};						\
 	}									\
 										\
-	if (al->top <= NAME##_short_no) {					\
-		return al->short_items[pos];					\
-	} else {								\
-		return al->items[pos];						\
-	}									\
+	return NAME##_items(al)[pos];						\
 }										\
 										\
 static inline TYPE NAME##_pick(NAME *al, size_t pos) {				\
@@ -179,11 +190,7 @@ static inline TYPE NAME##_pick(NAME *al, size_t pos) {				\
 		return (TYPE) {0};						\
 	}									\
 										\
-	if (al->top <= NAME##_short_no) {					\
-		return al->short_items[(al->top - 1) - pos];			\
-	} else {								\
-		return al->items[(al->top - 1) - pos];				\
-	}									\
+	return NAME##_items(al)[(al->top - 1) - pos];				\
 }										\
 
 #endif
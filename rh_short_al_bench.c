@@ -0,0 +1,114 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_al.h"
+#include "rh_short_al.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+// Many short lists: a sparse graph's adjacency lists and a token list per line
+
+RH_AL_MAKE(adj_al, uint32_t);
+RH_SMALL_VEC_MAKE(adj_sv, uint32_t, 6);
+
+RH_AL_MAKE(tok_al, uint16_t);
+RH_SMALL_VEC_MAKE(tok_sv, uint16_t, 12);
+
+#define NODES (1 << 20)
+#define DEGREE 4
+#define LINES (1 << 20)
+
+#define BENCH_ADJ(NAME)								\
+static void bench_##NAME(void) {						\
+	NAME *lists = calloc(NODES, sizeof(*lists));				\
+	uint64_t seed = 1;							\
+										\
+	uint64_t start = rh_bench_now();					\
+	for (size_t i = 0;i < NODES * DEGREE;++i) {				\
+		uint64_t r = rh_bench_rand(&seed);				\
+		NAME##_push(&lists[r % NODES], (uint32_t) (r >> 32) % NODES);	\
+	}									\
+	uint64_t built = rh_bench_now();					\
+										\
+	/* Two hop walk, as in a BFS frontier expansion */			\
+	uint64_t sum = 0;							\
+	for (size_t i = 0;i < NODES;++i) {					\
+		for (size_t j = 0;j < lists[i].top;++j) {			\
+			NAME *next = &lists[NAME##_view(&lists[i], j)];		\
+			for (size_t k = 0;k < next->top;++k) {			\
+				sum += NAME##_view(next, k);			\
+			}							\
+		}								\
+	}									\
+	uint64_t walked = rh_bench_now();					\
+	rh_bench_use(sum);							\
+										\
+	for (size_t i = 0;i < NODES;++i) {					\
+		NAME##_free(&lists[i]);						\
+	}									\
+	uint64_t freed = rh_bench_now();					\
+	free(lists);								\
+										\
+	rh_bench_report(#NAME " build", NODES * DEGREE, built - start);		\
+	rh_bench_report(#NAME " walk", NODES * DEGREE, walked - built);		\
+	rh_bench_report(#NAME " free", NODES, freed - walked);			\
+}
+
+#define BENCH_TOK(NAME)								\
+static void bench_##NAME(void) {						\
+	uint64_t seed = 2;							\
+	uint64_t sum = 0;							\
+	size_t tokens = 0;							\
+										\
+	uint64_t start = rh_bench_now();					\
+	for (size_t i = 0;i < LINES;++i) {					\
+		NAME line = {0};						\
+		size_t len = 1 + rh_bench_rand(&seed) % 16;			\
+		for (size_t j = 0;j < len;++j) {				\
+			NAME##_push(&line, (uint16_t) rh_bench_rand(&seed));	\
+		}								\
+		while (line.top) {						\
+			sum += NAME##_pop(&line);				\
+		}								\
+		tokens += len;							\
+		NAME##_free(&line);						\
+	}									\
+	uint64_t end = rh_bench_now();						\
+	rh_bench_use(sum);							\
+										\
+	rh_bench_report(#NAME " line", tokens, end - start);			\
+}
+
+BENCH_ADJ(adj_al)
+BENCH_ADJ(adj_sv)
+BENCH_TOK(tok_al)
+BENCH_TOK(tok_sv)
+
+int main() {
+	bench_adj_al();
+	bench_adj_sv();
+	bench_tok_al();
+	bench_tok_sv();
+
+	return 0;
+}
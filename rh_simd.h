@@ -0,0 +1,821 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_SIMD_H
+#define RH_SIMD_H
+
+// 4 wide kernels behind the float and double instantiations of RH_VEC and
+// RH_MAT, on plain arrays so they do not depend on the generated unions
+// SSE is used for float and SSE2, or AVX2 when enabled, for double, with
+// scalar versions for other targets or when RH_NO_SIMD is defined
+// Matrices are row major, so a 4x4 matrix is 16 contiguous values
+// Results said to match the scalar functions exactly only do so when the
+// compiler does not contract a * b + c into fused multiply adds, which GNU C
+// modes do by default on FMA targets; build with -ffp-contract=off (the ISO C
+// default) where that matters. Contraction is a per function option in GCC,
+// so it cannot be turned off for inlined kernels alone
+
+#include <math.h>
+
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(RH_NO_SIMD)
+#define RH_SIMD 1
+#include <immintrin.h>
+#else
+#define RH_SIMD 0
+#endif
+
+// Whether the generated SIZE wide functions for TYPE use these kernels
+#define RH_SIMD_4(SIZE, TYPE)							\
+	((SIZE) == 4 && _Generic((TYPE) 0, float: 1, double: 1, default: 0))
+
+// Kernels only the float 4x4 case has
+#define RH_SIMD_4F(SIZE, TYPE)							\
+	(RH_SIMD && (SIZE) == 4 && _Generic((TYPE) 0, float: 1, default: 0))
+
+// The kernel for TYPE; only ever called when RH_SIMD_4 holds, so other types
+// just need something that compiles
+#define RH_SIMD_FN(TYPE, OP)							\
+	_Generic((TYPE) 0, double: rh_simd_##OP##d, default: rh_simd_##OP##f)
+
+#if RH_SIMD
+
+// Sum of all four lanes into every lane
+static inline __m128 rh_simd_hsumf(__m128 v) {
+	__m128 t = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_add_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+static inline float rh_simd_dot4f(const float *a, const float *b) {
+	return _mm_cvtss_f32(rh_simd_hsumf(
+			_mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))));
+}
+
+// Cross product of the xyz parts, with w = 0
+static inline void rh_simd_cross4f(float *c, const float *a, const float *b) {
+	__m128 va = _mm_loadu_ps(a), vb = _mm_loadu_ps(b);
+	__m128 a_yzx = _mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 b_yzx = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 a_zxy = _mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 1, 0, 2));
+	__m128 b_zxy = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 1, 0, 2));
+	__m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+	_mm_storeu_ps(c, _mm_and_ps(xyz, _mm_sub_ps(_mm_mul_ps(a_yzx, b_zxy)
+				, _mm_mul_ps(a_zxy, b_yzx))));
+}
+
+static inline void rh_simd_norm4f(float *c, const float *a) {
+	__m128 v = _mm_loadu_ps(a);
+	__m128 len = _mm_sqrt_ps(rh_simd_hsumf(_mm_mul_ps(v, v)));
+	_mm_storeu_ps(c, _mm_div_ps(v, len));
+}
+
+// Approximate reciprocal square root refined by one Newton step, within a
+// few ulp rather than exact
+static inline void rh_simd_norm_fast4f(float *c, const float *a) {
+	__m128 v = _mm_loadu_ps(a);
+	__m128 dot = rh_simd_hsumf(_mm_mul_ps(v, v));
+	__m128 r = _mm_rsqrt_ps(dot);
+	r = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), r)
+			, _mm_sub_ps(_mm_set1_ps(3.0f)
+				, _mm_mul_ps(_mm_mul_ps(dot, r), r)));
+	_mm_storeu_ps(c, _mm_mul_ps(v, r));
+}
+
+// Each row of c is the rows of b scaled by the matching row of a and summed,
+// in the same order as the scalar loop so the result is identical
+static inline void rh_simd_mul4f(float *c, const float *a, const float *b) {
+	__m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4);
+	__m128 b2 = _mm_loadu_ps(b + 8), b3 = _mm_loadu_ps(b + 12);
+	for (int y = 0;y < 4;++y) {
+		__m128 acc = _mm_mul_ps(_mm_set1_ps(a[y * 4]), b0);
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(a[y * 4 + 1]), b1));
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(a[y * 4 + 2]), b2));
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(a[y * 4 + 3]), b3));
+		_mm_storeu_ps(c + y * 4, acc);
+	}
+}
+
+// c = m * v, as columns of m scaled by v
+static inline void rh_simd_mul_vec4f(float *c, const float *m, const float *v) {
+	__m128 m0 = _mm_loadu_ps(m), m1 = _mm_loadu_ps(m + 4);
+	__m128 m2 = _mm_loadu_ps(m + 8), m3 = _mm_loadu_ps(m + 12);
+	_MM_TRANSPOSE4_PS(m0, m1, m2, m3);
+	__m128 acc = _mm_mul_ps(m0, _mm_set1_ps(v[0]));
+	acc = _mm_add_ps(acc, _mm_mul_ps(m1, _mm_set1_ps(v[1])));
+	acc = _mm_add_ps(acc, _mm_mul_ps(m2, _mm_set1_ps(v[2])));
+	acc = _mm_add_ps(acc, _mm_mul_ps(m3, _mm_set1_ps(v[3])));
+	_mm_storeu_ps(c, acc);
+}
+
+// Products of 2x2 matrices held row major in one register: a * b, adj(a) * b
+// and a * adj(b)
+static inline __m128 rh_simd_mul2f(__m128 a, __m128 b) {
+	__m128 a_swap = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 b_diag = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0));
+	__m128 b_anti = _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2));
+	return _mm_add_ps(_mm_mul_ps(a, b_diag), _mm_mul_ps(a_swap, b_anti));
+}
+
+static inline __m128 rh_simd_adj_mul2f(__m128 a, __m128 b) {
+	__m128 a_diag = _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3));
+	__m128 a_anti = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1));
+	__m128 b_rows = _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2));
+	return _mm_sub_ps(_mm_mul_ps(a_diag, b), _mm_mul_ps(a_anti, b_rows));
+}
+
+static inline __m128 rh_simd_mul_adj2f(__m128 a, __m128 b) {
+	__m128 a_swap = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 b_diag = _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3));
+	__m128 b_anti = _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2));
+	return _mm_sub_ps(_mm_mul_ps(a, b_diag), _mm_mul_ps(a_swap, b_anti));
+}
+
+// Inverse by 2x2 blocks, m = [A B; C D], using adjugates so nothing is
+// divided until the end; returns 0, leaving c alone, if m is singular
+static inline int rh_simd_inv4f(float *c, const float *m) {
+	__m128 r0 = _mm_loadu_ps(m), r1 = _mm_loadu_ps(m + 4);
+	__m128 r2 = _mm_loadu_ps(m + 8), r3 = _mm_loadu_ps(m + 12);
+	__m128 a = _mm_movelh_ps(r0, r1), b = _mm_movehl_ps(r1, r0);
+	__m128 cc = _mm_movelh_ps(r2, r3), d = _mm_movehl_ps(r3, r2);
+
+	// |A| |B| |C| |D|
+	__m128 even0 = _mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 odd0 = _mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1));
+	__m128 even1 = _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 odd1 = _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1));
+	__m128 dets = _mm_sub_ps(_mm_mul_ps(even0, odd1), _mm_mul_ps(odd0, even1));
+	__m128 det_a = _mm_shuffle_ps(dets, dets, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 det_b = _mm_shuffle_ps(dets, dets, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 det_c = _mm_shuffle_ps(dets, dets, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128 det_d = _mm_shuffle_ps(dets, dets, _MM_SHUFFLE(3, 3, 3, 3));
+
+	__m128 d_c = rh_simd_adj_mul2f(d, cc);
+	__m128 a_b = rh_simd_adj_mul2f(a, b);
+	__m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), rh_simd_mul2f(b, d_c));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), rh_simd_mul2f(cc, a_b));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(det_b, cc), rh_simd_mul_adj2f(d, a_b));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), rh_simd_mul_adj2f(a, d_c));
+
+	// |M| = |A||D| + |B||C| - tr(adj(A) B adj(D) C)
+	__m128 d_c_t = _mm_shuffle_ps(d_c, d_c, _MM_SHUFFLE(3, 1, 2, 0));
+	__m128 tr = rh_simd_hsumf(_mm_mul_ps(a_b, d_c_t));
+	__m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d)
+				, _mm_mul_ps(det_b, det_c)), tr);
+	if (_mm_cvtss_f32(det) == 0) {
+		return 0;
+	}
+
+	__m128 r = _mm_div_ps(_mm_setr_ps(1, -1, -1, 1), det);
+	x = _mm_mul_ps(x, r);
+	y = _mm_mul_ps(y, r);
+	z = _mm_mul_ps(z, r);
+	w = _mm_mul_ps(w, r);
+
+	// Adjugate of each block, as part of storing them
+	_mm_storeu_ps(c, _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(c + 4, _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+	_mm_storeu_ps(c + 8, _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(c + 12, _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+	return 1;
+}
+
+#ifdef __AVX2__
+
+static inline double rh_simd_dot4d(const double *a, const double *b) {
+	__m256d p = _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b));
+	__m128d s = _mm_add_pd(_mm256_castpd256_pd128(p)
+			, _mm256_extractf128_pd(p, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+static inline void rh_simd_cross4d(double *c, const double *a
+		, const double *b) {
+	__m256d va = _mm256_loadu_pd(a), vb = _mm256_loadu_pd(b);
+	__m256d a_yzx = _mm256_permute4x64_pd(va, _MM_SHUFFLE(3, 0, 2, 1));
+	__m256d b_yzx = _mm256_permute4x64_pd(vb, _MM_SHUFFLE(3, 0, 2, 1));
+	__m256d a_zxy = _mm256_permute4x64_pd(va, _MM_SHUFFLE(3, 1, 0, 2));
+	__m256d b_zxy = _mm256_permute4x64_pd(vb, _MM_SHUFFLE(3, 1, 0, 2));
+	_mm256_storeu_pd(c, _mm256_blend_pd(_mm256_sub_pd(
+				_mm256_mul_pd(a_yzx, b_zxy)
+				, _mm256_mul_pd(a_zxy, b_yzx)), _mm256_setzero_pd(), 8));
+}
+
+static inline void rh_simd_norm4d(double *c, const double *a) {
+	__m256d v = _mm256_loadu_pd(a);
+	__m256d len = _mm256_set1_pd(sqrt(rh_simd_dot4d(a, a)));
+	_mm256_storeu_pd(c, _mm256_div_pd(v, len));
+}
+
+static inline void rh_simd_mul4d(double *c, const double *a, const double *b) {
+	__m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+	__m256d b2 = _mm256_loadu_pd(b + 8), b3 = _mm256_loadu_pd(b + 12);
+	for (int y = 0;y < 4;++y) {
+		__m256d acc = _mm256_mul_pd(_mm256_set1_pd(a[y * 4]), b0);
+		acc = _mm256_add_pd(acc
+				, _mm256_mul_pd(_mm256_set1_pd(a[y * 4 + 1]), b1));
+		acc = _mm256_add_pd(acc
+				, _mm256_mul_pd(_mm256_set1_pd(a[y * 4 + 2]), b2));
+		acc = _mm256_add_pd(acc
+				, _mm256_mul_pd(_mm256_set1_pd(a[y * 4 + 3]), b3));
+		_mm256_storeu_pd(c + y * 4, acc);
+	}
+}
+
+static inline void rh_simd_mul_vec4d(double *c, const double *m
+		, const double *v) {
+	__m256d r0 = _mm256_loadu_pd(m), r1 = _mm256_loadu_pd(m + 4);
+	__m256d r2 = _mm256_loadu_pd(m + 8), r3 = _mm256_loadu_pd(m + 12);
+	__m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+	__m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+	__m256d acc = _mm256_mul_pd(_mm256_permute2f128_pd(t0, t2, 0x20)
+			, _mm256_set1_pd(v[0]));
+	acc = _mm256_add_pd(acc, _mm256_mul_pd(
+				_mm256_permute2f128_pd(t1, t3, 0x20)
+				, _mm256_set1_pd(v[1])));
+	acc = _mm256_add_pd(acc, _mm256_mul_pd(
+				_mm256_permute2f128_pd(t0, t2, 0x31)
+				, _mm256_set1_pd(v[2])));
+	acc = _mm256_add_pd(acc, _mm256_mul_pd(
+				_mm256_permute2f128_pd(t1, t3, 0x31)
+				, _mm256_set1_pd(v[3])));
+	_mm256_storeu_pd(c, acc);
+}
+
+#else
+
+// Without AVX2 each 4 wide double operation is done as two SSE2 halves
+static inline double rh_simd_dot4d(const double *a, const double *b) {
+	__m128d lo = _mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b));
+	__m128d hi = _mm_mul_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2));
+	__m128d s = _mm_add_pd(lo, hi);
+	return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+static inline void rh_simd_cross4d(double *c, const double *a
+		, const double *b) {
+	__m128d a_xy = _mm_loadu_pd(a), a_zw = _mm_loadu_pd(a + 2);
+	__m128d b_xy = _mm_loadu_pd(b), b_zw = _mm_loadu_pd(b + 2);
+	__m128d a_yz = _mm_shuffle_pd(a_xy, a_zw, 1);
+	__m128d b_yz = _mm_shuffle_pd(b_xy, b_zw, 1);
+	__m128d a_zx = _mm_shuffle_pd(a_zw, a_xy, 0);
+	__m128d b_zx = _mm_shuffle_pd(b_zw, b_xy, 0);
+	/* x, y from yz * zx - zx * yz, z from the low lanes of xy and yz */
+	_mm_storeu_pd(c, _mm_sub_pd(_mm_mul_pd(a_yz, b_zx)
+				, _mm_mul_pd(a_zx, b_yz)));
+	_mm_storeu_pd(c + 2, _mm_move_sd(_mm_setzero_pd()
+				, _mm_sub_sd(_mm_mul_sd(a_xy, b_yz)
+					, _mm_mul_sd(a_yz, b_xy))));
+}
+
+static inline void rh_simd_norm4d(double *c, const double *a) {
+	__m128d len = _mm_set1_pd(sqrt(rh_simd_dot4d(a, a)));
+	_mm_storeu_pd(c, _mm_div_pd(_mm_loadu_pd(a), len));
+	_mm_storeu_pd(c + 2, _mm_div_pd(_mm_loadu_pd(a + 2), len));
+}
+
+static inline void rh_simd_mul4d(double *c, const double *a, const double *b) {
+	for (int h = 0;h < 4;h += 2) {
+		__m128d b0 = _mm_loadu_pd(b + h), b1 = _mm_loadu_pd(b + 4 + h);
+		__m128d b2 = _mm_loadu_pd(b + 8 + h), b3 = _mm_loadu_pd(b + 12 + h);
+		for (int y = 0;y < 4;++y) {
+			__m128d acc = _mm_mul_pd(_mm_set1_pd(a[y * 4]), b0);
+			acc = _mm_add_pd(acc
+					, _mm_mul_pd(_mm_set1_pd(a[y * 4 + 1]), b1));
+			acc = _mm_add_pd(acc
+					, _mm_mul_pd(_mm_set1_pd(a[y * 4 + 2]), b2));
+			acc = _mm_add_pd(acc
+					, _mm_mul_pd(_mm_set1_pd(a[y * 4 + 3]), b3));
+			_mm_storeu_pd(c + y * 4 + h, acc);
+		}
+	}
+}
+
+// Pairs of rows are interleaved into the matching halves of each column
+static inline void rh_simd_mul_vec4d(double *c, const double *m
+		, const double *v) {
+	__m128d out[2];
+	for (int h = 0;h < 2;++h) {
+		const double *r0 = m + h * 8, *r1 = r0 + 4;
+		__m128d lo0 = _mm_loadu_pd(r0), lo1 = _mm_loadu_pd(r1);
+		__m128d hi0 = _mm_loadu_pd(r0 + 2), hi1 = _mm_loadu_pd(r1 + 2);
+		__m128d acc = _mm_mul_pd(_mm_unpacklo_pd(lo0, lo1)
+				, _mm_set1_pd(v[0]));
+		acc = _mm_add_pd(acc, _mm_mul_pd(_mm_unpackhi_pd(lo0, lo1)
+					, _mm_set1_pd(v[1])));
+		acc = _mm_add_pd(acc, _mm_mul_pd(_mm_unpacklo_pd(hi0, hi1)
+					, _mm_set1_pd(v[2])));
+		acc = _mm_add_pd(acc, _mm_mul_pd(_mm_unpackhi_pd(hi0, hi1)
+					, _mm_set1_pd(v[3])));
+		out[h] = acc;
+	}
+	_mm_storeu_pd(c, out[0]);
+	_mm_storeu_pd(c + 2, out[1]);
+}
+
+#endif
+
+#else
+
+static inline float rh_simd_dot4f(const float *a, const float *b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+}
+
+static inline double rh_simd_dot4d(const double *a, const double *b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+}
+
+#define RH_SIMD_SCALAR(TYPE, S)							\
+static inline void rh_simd_cross4##S(TYPE *c, const TYPE *a, const TYPE *b) {	\
+	TYPE x = a[1] * b[2] - a[2] * b[1];					\
+	TYPE y = a[2] * b[0] - a[0] * b[2];					\
+	TYPE z = a[0] * b[1] - a[1] * b[0];					\
+	c[0] = x, c[1] = y, c[2] = z, c[3] = 0;					\
+}										\
+										\
+static inline void rh_simd_norm4##S(TYPE *c, const TYPE *a) {			\
+	TYPE len = sqrt(rh_simd_dot4##S(a, a));					\
+	for (int i = 0;i < 4;++i) {						\
+		c[i] = a[i] / len;						\
+	}									\
+}										\
+										\
+static inline void rh_simd_mul4##S(TYPE *c, const TYPE *a, const TYPE *b) {	\
+	TYPE t[16];								\
+	for (int y = 0;y < 4;++y) {						\
+	for (int x = 0;x < 4;++x) {						\
+		TYPE acc = 0;							\
+		for (int i = 0;i < 4;++i) {					\
+			acc += a[y * 4 + i] * b[i * 4 + x];			\
+		}								\
+		t[y * 4 + x] = acc;						\
+	}									\
+	}									\
+	for (int i = 0;i < 16;++i) {						\
+		c[i] = t[i];							\
+	}									\
+}										\
+										\
+static inline void rh_simd_mul_vec4##S(TYPE *c, const TYPE *m			\
+		, const TYPE *v) {						\
+	TYPE t[4];								\
+	for (int y = 0;y < 4;++y) {						\
+		t[y] = rh_simd_dot4##S(m + y * 4, v);				\
+	}									\
+	for (int i = 0;i < 4;++i) {						\
+		c[i] = t[i];							\
+	}									\
+}
+
+RH_SIMD_SCALAR(float, f)
+RH_SIMD_SCALAR(double, d)
+
+// Never called, as RH_SIMD_4F is 0 without SIMD
+static inline int rh_simd_inv4f(float *c, const float *m) {
+	(void) c, (void) m;
+	return 0;
+}
+
+static inline void rh_simd_norm_fast4f(float *c, const float *a) {
+	rh_simd_norm4f(c, a);
+}
+
+#endif
+
+// Double has no fast reciprocal square root
+static inline void rh_simd_norm_fast4d(double *c, const double *a) {
+	rh_simd_norm4d(c, a);
+}
+
+// sin(t theta) / sin(theta) = t (1 + b1 (1 + b2 (1 + ...))) with
+// bk = (uk t^2 - vk) (cos theta - 1), uk = 1 / (k (2k + 1)), vk = k / (2k + 1),
+// cut off after RH_SIMD_SLERP_N terms with the last scaled by 1.9168 to make
+// up for the rest, within 3.1e-8 of the series for cos theta >= 0
+#define RH_SIMD_SLERP_N 16
+
+static const double rh_simd_slerp_u[RH_SIMD_SLERP_N] = {
+	1.0 / 3, 1.0 / 10, 1.0 / 21, 1.0 / 36, 1.0 / 55, 1.0 / 78, 1.0 / 105
+	, 1.0 / 136, 1.0 / 171, 1.0 / 210, 1.0 / 253, 1.0 / 300, 1.0 / 351
+	, 1.0 / 406, 1.0 / 465, 1.9168 / 528,
+};
+
+static const double rh_simd_slerp_v[RH_SIMD_SLERP_N] = {
+	1.0 / 3, 2.0 / 5, 3.0 / 7, 4.0 / 9, 5.0 / 11, 6.0 / 13, 7.0 / 15
+	, 8.0 / 17, 9.0 / 19, 10.0 / 21, 11.0 / 23, 12.0 / 25, 13.0 / 27
+	, 14.0 / 29, 15.0 / 31, 1.9168 * 16 / 33,
+};
+
+// Span kernels, over structure of arrays batches of vectors held one
+// component array per axis, working on items [i, n) of each array
+// Generated from one body for whichever vector width V holds W lanes of, with
+// the last n % W items handed to the TAIL instantiation, whose width is 1
+// All inputs are loaded before any output is stored, so outputs may alias
+// inputs, and each lane is computed in the same order as the per vector
+// functions so results match them exactly, contraction permitting (above)
+#define RH_SIMD_SPAN(TYPE, S, TAIL, V, W, LOAD, STORE, SET1			\
+		, ADD, SUB, MUL, DIV, SQRT, MIN, MAX, FLIP)			\
+static inline void rh_simd_add_n##S(TYPE *c, const TYPE *a, const TYPE *b	\
+		, size_t i, size_t n) {						\
+	for (;i + W <= n;i += W) {						\
+		STORE(c + i, ADD(LOAD(a + i), LOAD(b + i)));			\
+	}									\
+	if (i < n) {								\
+		rh_simd_add_n##TAIL(c, a, b, i, n);				\
+	}									\
+}										\
+										\
+static inline void rh_simd_scale_n##S(TYPE *c, const TYPE *a, TYPE f		\
+		, size_t i, size_t n) {						\
+	V vf = SET1(f);								\
+	for (;i + W <= n;i += W) {						\
+		STORE(c + i, MUL(LOAD(a + i), vf));				\
+	}									\
+	if (i < n) {								\
+		rh_simd_scale_n##TAIL(c, a, f, i, n);				\
+	}									\
+}										\
+										\
+static inline void rh_simd_dot_n##S(TYPE *out, const TYPE *const *a		\
+		, const TYPE *const *b, int comps, size_t i, size_t n) {	\
+	for (;i + W <= n;i += W) {						\
+		V acc = MUL(LOAD(a[0] + i), LOAD(b[0] + i));			\
+		for (int k = 1;k < comps;++k) {					\
+			acc = ADD(acc, MUL(LOAD(a[k] + i), LOAD(b[k] + i)));	\
+		}								\
+		STORE(out + i, acc);						\
+	}									\
+	if (i < n) {								\
+		rh_simd_dot_n##TAIL(out, a, b, comps, i, n);			\
+	}									\
+}										\
+										\
+/* Of the xyz components only */						\
+static inline void rh_simd_cross_n##S(TYPE *const *c, const TYPE *const *a	\
+		, const TYPE *const *b, size_t i, size_t n) {			\
+	for (;i + W <= n;i += W) {						\
+		V ax = LOAD(a[0] + i), ay = LOAD(a[1] + i), az = LOAD(a[2] + i);\
+		V bx = LOAD(b[0] + i), by = LOAD(b[1] + i), bz = LOAD(b[2] + i);\
+		STORE(c[0] + i, SUB(MUL(ay, bz), MUL(az, by)));			\
+		STORE(c[1] + i, SUB(MUL(az, bx), MUL(ax, bz)));			\
+		STORE(c[2] + i, SUB(MUL(ax, by), MUL(ay, bx)));			\
+	}									\
+	if (i < n) {								\
+		rh_simd_cross_n##TAIL(c, a, b, i, n);				\
+	}									\
+}										\
+										\
+static inline void rh_simd_norm_n##S(TYPE *const *c, const TYPE *const *a	\
+		, int comps, size_t i, size_t n) {				\
+	for (;i + W <= n;i += W) {						\
+		V v[4];								\
+		v[0] = LOAD(a[0] + i);						\
+		V dot = MUL(v[0], v[0]);					\
+		for (int k = 1;k < comps;++k) {					\
+			v[k] = LOAD(a[k] + i);					\
+			dot = ADD(dot, MUL(v[k], v[k]));			\
+		}								\
+		V len = SQRT(dot);						\
+		for (int k = 0;k < comps;++k) {					\
+			STORE(c[k] + i, DIV(v[k], len));			\
+		}								\
+	}									\
+	if (i < n) {								\
+		rh_simd_norm_n##TAIL(c, a, comps, i, n);			\
+	}									\
+}										\
+										\
+/* c = m * a for a row major 4x4 m, with w taken as 1 for 3 components */	\
+static inline void rh_simd_transform_n##S(TYPE *const *c, const TYPE *m		\
+		, const TYPE *const *a, int comps, size_t i, size_t n) {	\
+	V vm[16];								\
+	for (int k = 0;k < 16;++k) {						\
+		vm[k] = SET1(m[k]);						\
+	}									\
+	for (;i + W <= n;i += W) {						\
+		V v[4], out[4];							\
+		for (int k = 0;k < comps;++k) {					\
+			v[k] = LOAD(a[k] + i);					\
+		}								\
+		for (int y = 0;y < comps;++y) {					\
+			V acc = MUL(vm[y * 4], v[0]);				\
+			acc = ADD(acc, MUL(vm[y * 4 + 1], v[1]));		\
+			acc = ADD(acc, MUL(vm[y * 4 + 2], v[2]));		\
+			out[y] = ADD(acc, comps == 4				\
+					? MUL(vm[y * 4 + 3], v[3]) : vm[y * 4 + 3]);\
+		}								\
+		for (int y = 0;y < comps;++y) {					\
+			STORE(c[y] + i, out[y]);				\
+		}								\
+	}									\
+	if (i < n) {								\
+		rh_simd_transform_n##TAIL(c, m, a, comps, i, n);		\
+	}									\
+}										\
+										\
+/* Widens [*min, *max] to cover the items */					\
+static inline void rh_simd_bounds_n##S(const TYPE *a, TYPE *min, TYPE *max	\
+		, size_t i, size_t n) {						\
+	if (i + W <= n) {							\
+		V lo = SET1(*min), hi = SET1(*max);				\
+		for (;i + W <= n;i += W) {					\
+			V v = LOAD(a + i);					\
+			lo = MIN(v, lo);					\
+			hi = MAX(v, hi);					\
+		}								\
+		TYPE l[W], h[W];						\
+		STORE(l, lo);							\
+		STORE(h, hi);							\
+		for (int k = 0;k < W;++k) {					\
+			*min = l[k] < *min ? l[k] : *min;			\
+			*max = h[k] > *max ? h[k] : *max;			\
+		}								\
+	}									\
+	if (i < n) {								\
+		rh_simd_bounds_n##TAIL(a, min, max, i, n);			\
+	}									\
+}										\
+										\
+/* Quaternion products, c = a * b, as x, y, z, w arrays */			\
+static inline void rh_simd_qmul_n##S(TYPE *const *c, const TYPE *const *a	\
+		, const TYPE *const *b, size_t i, size_t n) {			\
+	for (;i + W <= n;i += W) {						\
+		V ax = LOAD(a[0] + i), ay = LOAD(a[1] + i);			\
+		V az = LOAD(a[2] + i), aw = LOAD(a[3] + i);			\
+		V bx = LOAD(b[0] + i), by = LOAD(b[1] + i);			\
+		V bz = LOAD(b[2] + i), bw = LOAD(b[3] + i);			\
+		STORE(c[0] + i, SUB(ADD(ADD(MUL(aw, bx), MUL(ax, bw))		\
+					, MUL(ay, bz)), MUL(az, by)));		\
+		STORE(c[1] + i, ADD(ADD(SUB(MUL(aw, by), MUL(ax, bz))		\
+					, MUL(ay, bw)), MUL(az, bx)));		\
+		STORE(c[2] + i, ADD(SUB(ADD(MUL(aw, bz), MUL(ax, by))		\
+					, MUL(ay, bx)), MUL(az, bw)));		\
+		STORE(c[3] + i, SUB(SUB(SUB(MUL(aw, bw), MUL(ax, bx))		\
+					, MUL(ay, by)), MUL(az, bz)));		\
+	}									\
+	if (i < n) {								\
+		rh_simd_qmul_n##TAIL(c, a, b, i, n);				\
+	}									\
+}										\
+										\
+/* Rotates the 3 component v by unit quaternions q, as v + w t + u x t */	\
+/* where u is the vector part of q and t = 2 u x v */				\
+static inline void rh_simd_qrotate_n##S(TYPE *const *c, const TYPE *const *q	\
+		, const TYPE *const *v, size_t i, size_t n) {			\
+	V two = SET1(2);							\
+	for (;i + W <= n;i += W) {						\
+		V ux = LOAD(q[0] + i), uy = LOAD(q[1] + i);			\
+		V uz = LOAD(q[2] + i), w = LOAD(q[3] + i);			\
+		V vx = LOAD(v[0] + i), vy = LOAD(v[1] + i), vz = LOAD(v[2] + i);\
+		V tx = MUL(two, SUB(MUL(uy, vz), MUL(uz, vy)));			\
+		V ty = MUL(two, SUB(MUL(uz, vx), MUL(ux, vz)));			\
+		V tz = MUL(two, SUB(MUL(ux, vy), MUL(uy, vx)));			\
+		STORE(c[0] + i, ADD(ADD(vx, MUL(w, tx))				\
+					, SUB(MUL(uy, tz), MUL(uz, ty))));	\
+		STORE(c[1] + i, ADD(ADD(vy, MUL(w, ty))				\
+					, SUB(MUL(uz, tx), MUL(ux, tz))));	\
+		STORE(c[2] + i, ADD(ADD(vz, MUL(w, tz))				\
+					, SUB(MUL(ux, ty), MUL(uy, tx))));	\
+	}									\
+	if (i < n) {								\
+		rh_simd_qrotate_n##TAIL(c, q, v, i, n);				\
+	}									\
+}										\
+										\
+/* Slerp of unit quaternions by t[i], along the shorter arc, using the */	\
+/* polynomial in cos theta from rh_simd_slerp_u and _v in place of acos */	\
+/* and sin, so lanes need no branches */					\
+static inline void rh_simd_slerp_n##S(TYPE *const *c, const TYPE *const *a	\
+		, const TYPE *const *b, const TYPE *t, size_t i, size_t n) {	\
+	V one = SET1(1);							\
+	for (;i + W <= n;i += W) {						\
+		V va[4], vb[4];							\
+		V dot = MUL(va[0] = LOAD(a[0] + i), vb[0] = LOAD(b[0] + i));	\
+		for (int k = 1;k < 4;++k) {					\
+			va[k] = LOAD(a[k] + i);					\
+			vb[k] = LOAD(b[k] + i);					\
+			dot = ADD(dot, MUL(va[k], vb[k]));			\
+		}								\
+		for (int k = 0;k < 4;++k) {					\
+			vb[k] = FLIP(vb[k], dot);				\
+		}								\
+		V xm1 = SUB(FLIP(dot, dot), one);				\
+		V tb = LOAD(t + i), ta = SUB(one, tb);				\
+		V sb = MUL(tb, tb), sa = MUL(ta, ta);				\
+		V rb = one, ra = one;						\
+		for (int k = RH_SIMD_SLERP_N;k--;) {				\
+			V u = SET1(rh_simd_slerp_u[k]);				\
+			V v = SET1(rh_simd_slerp_v[k]);				\
+			rb = ADD(one, MUL(MUL(SUB(MUL(u, sb), v), xm1), rb));	\
+			ra = ADD(one, MUL(MUL(SUB(MUL(u, sa), v), xm1), ra));	\
+		}								\
+		ta = MUL(ta, ra);						\
+		tb = MUL(tb, rb);						\
+		for (int k = 0;k < 4;++k) {					\
+			STORE(c[k] + i, ADD(MUL(ta, va[k]), MUL(tb, vb[k])));	\
+		}								\
+	}									\
+	if (i < n) {								\
+		rh_simd_slerp_n##TAIL(c, a, b, t, i, n);			\
+	}									\
+}
+
+// Width 1 operations, for tails and types without vector support
+#define RH_SIMD_S_LOAD(P) (*(P))
+#define RH_SIMD_S_STORE(P, X) (*(P) = (X))
+#define RH_SIMD_S_SET1(X) (X)
+#define RH_SIMD_S_ADD(A, B) ((A) + (B))
+#define RH_SIMD_S_SUB(A, B) ((A) - (B))
+#define RH_SIMD_S_MUL(A, B) ((A) * (B))
+#define RH_SIMD_S_DIV(A, B) ((A) / (B))
+#define RH_SIMD_S_SQRT(X) sqrt(X)
+#define RH_SIMD_S_MIN(A, B) ((A) < (B) ? (A) : (B))
+#define RH_SIMD_S_MAX(A, B) ((A) > (B) ? (A) : (B))
+#define RH_SIMD_S_FLIP(X, Y) ((Y) < 0 ? -(X) : (X))
+
+#define RH_SIMD_SPAN_SCALAR(TYPE, S)						\
+	RH_SIMD_SPAN(TYPE, S, S, TYPE, 1, RH_SIMD_S_LOAD, RH_SIMD_S_STORE	\
+			, RH_SIMD_S_SET1, RH_SIMD_S_ADD, RH_SIMD_S_SUB		\
+			, RH_SIMD_S_MUL, RH_SIMD_S_DIV, RH_SIMD_S_SQRT		\
+			, RH_SIMD_S_MIN, RH_SIMD_S_MAX, RH_SIMD_S_FLIP)
+
+// The span kernel for TYPE, with the scalar ones RH_VEC_IMPL generates for
+// other types
+#define RH_SIMD_SPAN_FN(TYPE, OP)						\
+	_Generic((TYPE) 0, float: rh_simd_##OP##f, double: rh_simd_##OP##d	\
+			, default: rh_simd_##OP##_##TYPE)
+
+#if RH_SIMD
+RH_SIMD_SPAN_SCALAR(float, f1)
+RH_SIMD_SPAN_SCALAR(double, d1)
+
+// min and max take the second operand when either is NaN, like the scalar
+// comparisons they replace, and flip negates x where y < 0
+#ifdef __AVX__
+static inline __m256 rh_simd_flip8f(__m256 x, __m256 y) {
+	__m256 neg = _mm256_cmp_ps(y, _mm256_setzero_ps(), _CMP_LT_OQ);
+	return _mm256_xor_ps(x, _mm256_and_ps(neg, _mm256_set1_ps(-0.0f)));
+}
+
+static inline __m256d rh_simd_flip4d(__m256d x, __m256d y) {
+	__m256d neg = _mm256_cmp_pd(y, _mm256_setzero_pd(), _CMP_LT_OQ);
+	return _mm256_xor_pd(x, _mm256_and_pd(neg, _mm256_set1_pd(-0.0)));
+}
+
+RH_SIMD_SPAN(float, f, f1, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps
+		, _mm256_set1_ps, _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps
+		, _mm256_div_ps, _mm256_sqrt_ps, _mm256_min_ps, _mm256_max_ps
+		, rh_simd_flip8f)
+RH_SIMD_SPAN(double, d, d1, __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd
+		, _mm256_set1_pd, _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd
+		, _mm256_div_pd, _mm256_sqrt_pd, _mm256_min_pd, _mm256_max_pd
+		, rh_simd_flip4d)
+#else
+static inline __m128 rh_simd_flip4f(__m128 x, __m128 y) {
+	__m128 neg = _mm_cmplt_ps(y, _mm_setzero_ps());
+	return _mm_xor_ps(x, _mm_and_ps(neg, _mm_set1_ps(-0.0f)));
+}
+
+static inline __m128d rh_simd_flip2d(__m128d x, __m128d y) {
+	__m128d neg = _mm_cmplt_pd(y, _mm_setzero_pd());
+	return _mm_xor_pd(x, _mm_and_pd(neg, _mm_set1_pd(-0.0)));
+}
+
+RH_SIMD_SPAN(float, f, f1, __m128, 4, _mm_loadu_ps, _mm_storeu_ps
+		, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps
+		, _mm_div_ps, _mm_sqrt_ps, _mm_min_ps, _mm_max_ps
+		, rh_simd_flip4f)
+RH_SIMD_SPAN(double, d, d1, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd
+		, _mm_set1_pd, _mm_add_pd, _mm_sub_pd, _mm_mul_pd
+		, _mm_div_pd, _mm_sqrt_pd, _mm_min_pd, _mm_max_pd
+		, rh_simd_flip2d)
+#endif
+#else
+RH_SIMD_SPAN_SCALAR(float, f)
+RH_SIMD_SPAN_SCALAR(double, d)
+#endif
+
+// GEMM micro kernel, adding the product of a k long strip of RH_SIMD_GEMM_MR
+// rows of a and one of 2 * W columns of b to the m by n block of c at the
+// start of c, where m and n may be smaller at the edges of c
+// Strips are packed, a as MR values per step of k and b as 2 * W, so every
+// load is contiguous; the MR * 2 accumulators stay in registers throughout
+#define RH_SIMD_GEMM_MR 4
+
+#define RH_SIMD_GEMM(TYPE, S, V, W, LOAD, STORE, SET1, ADD, FMA)		\
+static inline void rh_simd_gemm##S(size_t k, const TYPE *a, const TYPE *b	\
+		, TYPE *c, size_t ldc, size_t m, size_t n) {			\
+	V c00 = SET1(0), c01 = c00, c10 = c00, c11 = c00;			\
+	V c20 = c00, c21 = c00, c30 = c00, c31 = c00;				\
+	for (size_t p = 0;p < k;++p, a += RH_SIMD_GEMM_MR, b += 2 * W) {	\
+		V b0 = LOAD(b), b1 = LOAD(b + W), x;				\
+		x = SET1(a[0]);							\
+		c00 = FMA(x, b0, c00);						\
+		c01 = FMA(x, b1, c01);						\
+		x = SET1(a[1]);							\
+		c10 = FMA(x, b0, c10);						\
+		c11 = FMA(x, b1, c11);						\
+		x = SET1(a[2]);							\
+		c20 = FMA(x, b0, c20);						\
+		c21 = FMA(x, b1, c21);						\
+		x = SET1(a[3]);							\
+		c30 = FMA(x, b0, c30);						\
+		c31 = FMA(x, b1, c31);						\
+	}									\
+										\
+	if (m == RH_SIMD_GEMM_MR && n == 2 * W) {				\
+		STORE(c, ADD(LOAD(c), c00));					\
+		STORE(c + W, ADD(LOAD(c + W), c01));				\
+		c += ldc;							\
+		STORE(c, ADD(LOAD(c), c10));					\
+		STORE(c + W, ADD(LOAD(c + W), c11));				\
+		c += ldc;							\
+		STORE(c, ADD(LOAD(c), c20));					\
+		STORE(c + W, ADD(LOAD(c + W), c21));				\
+		c += ldc;							\
+		STORE(c, ADD(LOAD(c), c30));					\
+		STORE(c + W, ADD(LOAD(c + W), c31));				\
+		return;								\
+	}									\
+										\
+	TYPE t[RH_SIMD_GEMM_MR][2 * W];						\
+	STORE(t[0], c00);							\
+	STORE(t[0] + W, c01);							\
+	STORE(t[1], c10);							\
+	STORE(t[1] + W, c11);							\
+	STORE(t[2], c20);							\
+	STORE(t[2] + W, c21);							\
+	STORE(t[3], c30);							\
+	STORE(t[3] + W, c31);							\
+	for (size_t i = 0;i < m;++i, c += ldc) {				\
+		for (size_t j = 0;j < n;++j) {					\
+			c[j] += t[i][j];					\
+		}								\
+	}									\
+}
+
+#define RH_SIMD_S_FMA(A, B, C) ((A) * (B) + (C))
+
+#define RH_SIMD_GEMM_SCALAR(TYPE, S)						\
+	RH_SIMD_GEMM(TYPE, S, TYPE, 1, RH_SIMD_S_LOAD, RH_SIMD_S_STORE		\
+			, RH_SIMD_S_SET1, RH_SIMD_S_ADD, RH_SIMD_S_FMA)
+
+// Columns of b per strip for TYPE's kernel
+#define RH_SIMD_GEMM_NR(TYPE)							\
+	_Generic((TYPE) 0, float: RH_SIMD_GEMM_NRF, double: RH_SIMD_GEMM_NRD	\
+			, default: 2)
+
+#if RH_SIMD
+#ifdef __AVX__
+#define RH_SIMD_GEMM_NRF 16
+#define RH_SIMD_GEMM_NRD 8
+
+#ifdef __FMA__
+#define RH_SIMD_FMA256F _mm256_fmadd_ps
+#define RH_SIMD_FMA256D _mm256_fmadd_pd
+#else
+#define RH_SIMD_FMA256F(A, B, C) _mm256_add_ps(_mm256_mul_ps(A, B), C)
+#define RH_SIMD_FMA256D(A, B, C) _mm256_add_pd(_mm256_mul_pd(A, B), C)
+#endif
+
+RH_SIMD_GEMM(float, f, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps
+		, _mm256_set1_ps, _mm256_add_ps, RH_SIMD_FMA256F)
+RH_SIMD_GEMM(double, d, __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd
+		, _mm256_set1_pd, _mm256_add_pd, RH_SIMD_FMA256D)
+#else
+#define RH_SIMD_GEMM_NRF 8
+#define RH_SIMD_GEMM_NRD 4
+
+#define RH_SIMD_FMA128F(A, B, C) _mm_add_ps(_mm_mul_ps(A, B), C)
+#define RH_SIMD_FMA128D(A, B, C) _mm_add_pd(_mm_mul_pd(A, B), C)
+
+RH_SIMD_GEMM(float, f, __m128, 4, _mm_loadu_ps, _mm_storeu_ps
+		, _mm_set1_ps, _mm_add_ps, RH_SIMD_FMA128F)
+RH_SIMD_GEMM(double, d, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd
+		, _mm_set1_pd, _mm_add_pd, RH_SIMD_FMA128D)
+#endif
+#else
+#define RH_SIMD_GEMM_NRF 2
+#define RH_SIMD_GEMM_NRD 2
+
+RH_SIMD_GEMM_SCALAR(float, f)
+RH_SIMD_GEMM_SCALAR(double, d)
+#endif
+
+#endif
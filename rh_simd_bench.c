@@ -0,0 +1,227 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_vec.h"
+#include "rh_mat.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+RH_VEC_MAKE(float);
+RH_VEC_MAKE(double);
+RH_MAT_MAKE(float);
+RH_MAT_MAKE(double);
+RH_MAT_VEC_IMPL(float);
+RH_MAT_VEC_IMPL(double);
+
+// A transform pipeline's working set, resident in L1/L2
+#define COUNT 1024
+#define ROUNDS 4096
+
+// The scalar loops the generated functions used before, for comparison
+#define SCALAR(TYPE)								\
+static inline TYPE scalar_dot_##TYPE(const v4##TYPE a, const v4##TYPE b) {	\
+	TYPE dot = 0;								\
+	for (int i = 0;i < 4;++i) {						\
+		dot += a.array[i] * b.array[i];					\
+	}									\
+	return dot;								\
+}										\
+										\
+static inline v4##TYPE scalar_norm_##TYPE(const v4##TYPE a) {			\
+	TYPE len = sqrt(scalar_dot_##TYPE(a, a));				\
+	v4##TYPE ret;								\
+	for (int i = 0;i < 4;++i) {						\
+		ret.array[i] = a.array[i] / len;				\
+	}									\
+	return ret;								\
+}										\
+										\
+static inline m4##TYPE scalar_mul_##TYPE(const m4##TYPE a, const m4##TYPE b) {	\
+	m4##TYPE c;								\
+	for (int y = 0;y < 4;++y) {						\
+	for (int x = 0;x < 4;++x) {						\
+		TYPE acc = 0;							\
+		for (int i = 0;i < 4;++i) {					\
+			acc += a.array[y][i] * b.array[i][x];			\
+		}								\
+		c.array[y][x] = acc;						\
+	}									\
+	}									\
+	return c;								\
+}										\
+										\
+static inline v4##TYPE scalar_mul_vec_##TYPE(const m4##TYPE m			\
+		, const v4##TYPE v) {						\
+	v4##TYPE c;								\
+	for (int y = 0;y < 4;++y) {						\
+		TYPE acc = 0;							\
+		for (int i = 0;i < 4;++i) {					\
+			acc += m.array[y][i] * v.array[i];			\
+		}								\
+		c.array[y] = acc;						\
+	}									\
+	return c;								\
+}
+
+SCALAR(float)
+SCALAR(double)
+
+// Chains each result into the next input so the kernels cannot overlap
+// across iterations more than a real pipeline would
+#define BENCH(TYPE)								\
+static void bench_##TYPE(void) {						\
+	static m4##TYPE mats[COUNT];						\
+	static v4##TYPE vecs[COUNT];						\
+	uint64_t seed = 8;							\
+	for (size_t i = 0;i < COUNT;++i) {					\
+		for (int j = 0;j < 16;++j) {					\
+			mats[i].flat[j] = (rh_bench_rand(&seed) >> 40) * 0x1p-24;\
+		}								\
+		for (int j = 0;j < 4;++j) {					\
+			vecs[i].array[j] = (rh_bench_rand(&seed) >> 40) * 0x1p-24;\
+		}								\
+	}									\
+										\
+	TYPE check = 0;								\
+	uint64_t ops = (uint64_t) COUNT * ROUNDS;				\
+	uint64_t start, end;							\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		m4##TYPE acc = mats[0];						\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			acc = m4##TYPE##_mul(mats[i], acc);			\
+		}								\
+		check += acc.flat[r & 15];					\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("m4" #TYPE " mul simd", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		m4##TYPE acc = mats[0];						\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			acc = scalar_mul_##TYPE(mats[i], acc);			\
+		}								\
+		check += acc.flat[r & 15];					\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("m4" #TYPE " mul scalar", ops, end - start);		\
+										\
+	/* Independent transforms, as when streaming points */			\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		m4##TYPE m = mats[r & (COUNT - 1)];				\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			check += m4##TYPE##_mul_vec(m, vecs[i]).w;		\
+		}								\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("m4" #TYPE " mul_vec simd", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		m4##TYPE m = mats[r & (COUNT - 1)];				\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			check += scalar_mul_vec_##TYPE(m, vecs[i]).w;		\
+		}								\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("m4" #TYPE " mul_vec scalar", ops, end - start);	\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i + 1 < COUNT;++i) {				\
+			check += v4##TYPE##_dot(vecs[i], vecs[i + 1]);		\
+		}								\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("v4" #TYPE " dot simd", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i + 1 < COUNT;++i) {				\
+			check += scalar_dot_##TYPE(vecs[i], vecs[i + 1]);	\
+		}								\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("v4" #TYPE " dot scalar", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i + 1 < COUNT;++i) {				\
+			check += v4##TYPE##_cross(vecs[i], vecs[i + 1]).x;	\
+		}								\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("v4" #TYPE " cross simd", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i + 1 < COUNT;++i) {				\
+			check += v3##TYPE##_cross(vecs[i].vec3, vecs[i + 1].vec3).x;\
+		}								\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("v3" #TYPE " cross scalar", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			check += v4##TYPE##_norm(vecs[i]).x;			\
+		}								\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("v4" #TYPE " norm simd", ops, end - start);		\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			check += v4##TYPE##_norm_fast(vecs[i]).x;		\
+		}								\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("v4" #TYPE " norm_fast simd", ops, end - start);	\
+										\
+	start = rh_bench_now();							\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		for (size_t i = 0;i < COUNT;++i) {				\
+			check += scalar_norm_##TYPE(vecs[i]).x;			\
+		}								\
+	}									\
+	end = rh_bench_now();							\
+	rh_bench_report("v4" #TYPE " norm scalar", ops, end - start);		\
+										\
+	rh_bench_use((uint64_t) check);						\
+}
+
+BENCH(float)
+BENCH(double)
+
+int main() {
+	bench_float();
+	bench_double();
+
+	return 0;
+}
@@ -0,0 +1,304 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+// The kernels are held to the scalar functions' rounding, which only holds
+// with contraction to fused multiply adds off for the whole file
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#else
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "rh_vec.h"
+#include "rh_mat.h"
+#include "rh_bench.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+RH_VEC_MAKE(float);
+RH_VEC_MAKE(double);
+RH_VEC_MAKE(int);
+RH_MAT_MAKE(float);
+RH_MAT_MAKE(double);
+RH_MAT_MAKE(int);
+RH_MAT_VEC_IMPL(float);
+RH_MAT_VEC_IMPL(double);
+RH_MAT_VEC_IMPL(int);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+#define ROUNDS 10000
+
+// Distance in representable values, so the SIMD kernels can be held to a
+// number of ulp from the scalar reference
+static uint64_t ulp_f(float a, float b) {
+	int32_t x, y;
+	memcpy(&x, &a, sizeof(x));
+	memcpy(&y, &b, sizeof(y));
+	x = x < 0 ? INT32_MIN - x : x;
+	y = y < 0 ? INT32_MIN - y : y;
+	return x < y ? (uint64_t) y - x : (uint64_t) x - y;
+}
+
+static uint64_t ulp_d(double a, double b) {
+	int64_t x, y;
+	memcpy(&x, &a, sizeof(x));
+	memcpy(&y, &b, sizeof(y));
+	x = x < 0 ? INT64_MIN - x : x;
+	y = y < 0 ? INT64_MIN - y : y;
+	return x < y ? (uint64_t) y - x : (uint64_t) x - y;
+}
+
+#define ULP(A, B) _Generic((A), float: ulp_f, double: ulp_d)(A, B)
+
+// Positive values keep the dot products well conditioned
+static double rand_val(uint64_t *seed) {
+	return 0.5 + (rh_bench_rand(seed) >> 11) * (1.5 / (1LU << 53));
+}
+
+// Scalar references, written out as the generated loops were
+#define REFERENCE(TYPE)								\
+static TYPE ref_dot_##TYPE(const TYPE *a, const TYPE *b) {			\
+	TYPE dot = 0;								\
+	for (int i = 0;i < 4;++i) {						\
+		dot += a[i] * b[i];						\
+	}									\
+	return dot;								\
+}										\
+										\
+static void ref_norm_##TYPE(TYPE *c, const TYPE *a) {				\
+	TYPE len = sqrt(ref_dot_##TYPE(a, a));					\
+	for (int i = 0;i < 4;++i) {						\
+		c[i] = a[i] / len;						\
+	}									\
+}										\
+										\
+static void ref_mul_##TYPE(TYPE *c, const TYPE *a, const TYPE *b) {		\
+	for (int y = 0;y < 4;++y) {						\
+	for (int x = 0;x < 4;++x) {						\
+		TYPE acc = 0;							\
+		for (int i = 0;i < 4;++i) {					\
+			acc += a[y * 4 + i] * b[i * 4 + x];			\
+		}								\
+		c[y * 4 + x] = acc;						\
+	}									\
+	}									\
+}
+
+REFERENCE(float)
+REFERENCE(double)
+
+#define CHECK_KERNELS(TYPE)							\
+int kernels_##TYPE(void) {							\
+	uint64_t seed = 0x9e3779b97f4a7c15;					\
+	uint64_t worst_dot = 0, worst_norm = 0, worst_fast = 0;			\
+	uint64_t worst_mul = 0, worst_vec = 0, worst_cross = 0;			\
+	for (int r = 0;r < ROUNDS;++r) {					\
+		v4##TYPE a, b;							\
+		m4##TYPE m, n;							\
+		for (int i = 0;i < 4;++i) {					\
+			a.array[i] = rand_val(&seed);				\
+			b.array[i] = rand_val(&seed);				\
+		}								\
+		for (int i = 0;i < 16;++i) {					\
+			m.flat[i] = rand_val(&seed);				\
+			n.flat[i] = rand_val(&seed);				\
+		}								\
+										\
+		uint64_t u = ULP(v4##TYPE##_dot(a, b)				\
+				, ref_dot_##TYPE(a.array, b.array));		\
+		worst_dot = u > worst_dot ? u : worst_dot;			\
+										\
+		TYPE ref[16];							\
+		v4##TYPE c = v4##TYPE##_norm(a);				\
+		v4##TYPE f = v4##TYPE##_norm_fast(a);				\
+		ref_norm_##TYPE(ref, a.array);					\
+		for (int i = 0;i < 4;++i) {					\
+			u = ULP(c.array[i], ref[i]);				\
+			worst_norm = u > worst_norm ? u : worst_norm;		\
+			u = ULP(f.array[i], ref[i]);				\
+			worst_fast = u > worst_fast ? u : worst_fast;		\
+		}								\
+										\
+		c = v4##TYPE##_cross(a, b);					\
+		v3##TYPE c3 = v3##TYPE##_cross(a.vec3, b.vec3);			\
+		for (int i = 0;i < 3;++i) {					\
+			u = ULP(c.array[i], c3.array[i]);			\
+			worst_cross = u > worst_cross ? u : worst_cross;	\
+		}								\
+		worst_cross = c.w != 0 ? UINT64_MAX : worst_cross;		\
+										\
+		m4##TYPE p = m4##TYPE##_mul(m, n);				\
+		ref_mul_##TYPE(ref, m.flat, n.flat);				\
+		for (int i = 0;i < 16;++i) {					\
+			u = ULP(p.flat[i], ref[i]);				\
+			worst_mul = u > worst_mul ? u : worst_mul;		\
+		}								\
+										\
+		c = m4##TYPE##_mul_vec(m, a);					\
+		for (int i = 0;i < 4;++i) {					\
+			u = ULP(c.array[i], ref_dot_##TYPE(&m.flat[i * 4], a.array));\
+			worst_vec = u > worst_vec ? u : worst_vec;		\
+		}								\
+	}									\
+										\
+	/* Products are accumulated in the scalar order, so only the */		\
+	/* horizontal sums in dot and norm may round differently */		\
+	if (worst_dot > 2 || worst_norm > 4 || worst_fast > 16			\
+	|| worst_mul || worst_cross || worst_vec) {				\
+		ERROR_MSG("%s kernels test FAILED! dot %lu norm %lu fast %lu "	\
+				"mul %lu cross %lu mul_vec %lu ulp", #TYPE	\
+				, worst_dot, worst_norm, worst_fast		\
+				, worst_mul, worst_cross, worst_vec);		\
+		return 1;							\
+	}									\
+	return 0;								\
+}
+
+CHECK_KERNELS(float)
+CHECK_KERNELS(double)
+
+// Batch kernels compute each lane as the per vector functions do, so must
+// match them exactly, including the scalar tails; the SoA loops vectorise
+// differently to the per vector code, so this also relies on the pragma above
+#define BATCH_COUNT 1003
+
+#define CHECK_BATCH(TYPE)							\
+int batch_##TYPE(void) {							\
+	static v3##TYPE pts[BATCH_COUNT], out[BATCH_COUNT];			\
+	static v4##TYPE hpts[BATCH_COUNT];					\
+	static TYPE dots[BATCH_COUNT];						\
+	uint64_t seed = 77;							\
+	m4##TYPE m;								\
+	for (int i = 0;i < 16;++i) {						\
+		m.flat[i] = (rand_val(&seed) - 1.25) * 64;			\
+	}									\
+	for (int i = 0;i < BATCH_COUNT;++i) {					\
+		for (int k = 0;k < 3;++k) {					\
+			pts[i].array[k] = (rand_val(&seed) - 1.25) * 64;	\
+		}								\
+		hpts[i] = (v4##TYPE) {{pts[i].x, pts[i].y, pts[i].z, 1}};	\
+	}									\
+										\
+	int errors = 0;								\
+	v3##TYPE##_batch a = v3##TYPE##_batch_from(pts, BATCH_COUNT);		\
+	v3##TYPE##_batch b = v3##TYPE##_batch_from(pts + 1, BATCH_COUNT - 1);	\
+	v3##TYPE##_batch c = {0};						\
+	v3##TYPE##_batch_to(&a, out);						\
+	errors += memcmp(out, pts, sizeof(pts)) != 0;				\
+										\
+	v3##TYPE##_batch_add(&c, &b, &a);					\
+	for (int i = 0;i < BATCH_COUNT - 1;++i) {				\
+		errors += !v3##TYPE##_eq(v3##TYPE##_batch_get(&c, i)		\
+				, v3##TYPE##_add(pts[i + 1], pts[i]));		\
+	}									\
+	v3##TYPE##_batch_scale(&c, &a, 3);					\
+	v3##TYPE##_batch_dot(dots, &b, &a);					\
+	for (int i = 0;i < BATCH_COUNT - 1;++i) {				\
+		errors += !v3##TYPE##_eq(v3##TYPE##_batch_get(&c, i)		\
+				, v3##TYPE##_scale(pts[i], 3));			\
+		errors += dots[i] != v3##TYPE##_dot(pts[i + 1], pts[i]);	\
+	}									\
+										\
+	/* In place, over a copy of b */					\
+	v3##TYPE##_batch_scale(&c, &b, 1);					\
+	v3##TYPE##_batch_cross(&c, &c, &a);					\
+	for (int i = 0;i < BATCH_COUNT - 1;++i) {				\
+		errors += !v3##TYPE##_eq(v3##TYPE##_batch_get(&c, i)		\
+				, v3##TYPE##_cross(pts[i + 1], pts[i]));	\
+	}									\
+	v3##TYPE##_batch_norm(&c, &a);						\
+	for (int i = 0;i < BATCH_COUNT;++i) {					\
+		errors += !v3##TYPE##_eq(v3##TYPE##_batch_get(&c, i)		\
+				, v3##TYPE##_norm(pts[i]));			\
+	}									\
+										\
+	m4##TYPE##_mul_v3##TYPE##_batch(&c, m, &a);				\
+	v4##TYPE##_batch h = v4##TYPE##_batch_from(hpts, BATCH_COUNT);		\
+	m4##TYPE##_mul_v4##TYPE##_batch(&h, m, &h);				\
+	for (int i = 0;i < BATCH_COUNT;++i) {					\
+		v4##TYPE t = m4##TYPE##_mul_vec(m, hpts[i]);			\
+		errors += !v3##TYPE##_eq(v3##TYPE##_batch_get(&c, i), t.vec3);	\
+		errors += !v4##TYPE##_eq(v4##TYPE##_batch_get(&h, i), t);	\
+	}									\
+										\
+	v3##TYPE min, max;							\
+	v3##TYPE##_batch_bounds(&a, &min, &max);				\
+	for (int i = 0;i < BATCH_COUNT;++i) {					\
+		for (int k = 0;k < 3;++k) {					\
+			errors += pts[i].array[k] < min.array[k];		\
+			errors += pts[i].array[k] > max.array[k];		\
+		}								\
+	}									\
+										\
+	v3##TYPE##_batch_free(&a);						\
+	v3##TYPE##_batch_free(&b);						\
+	v3##TYPE##_batch_free(&c);						\
+	v4##TYPE##_batch_free(&h);						\
+	if (errors) {								\
+		ERROR_MSG("%s batch test FAILED! %d mismatches", #TYPE, errors);\
+		return 1;							\
+	}									\
+	return 0;								\
+}
+
+CHECK_BATCH(float)
+CHECK_BATCH(double)
+CHECK_BATCH(int)
+
+// Not commutative, so catches the product being transposed
+int mul_order(void) {
+	m2int a = {{{1, 2}, {3, 4}}};
+	m2int b = {{{5, 6}, {7, 8}}};
+	m2int ab = {{{19, 22}, {43, 50}}};
+	m4float c = {{{1, 2, 0, 0}, {3, 4, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
+	m4float d = {{{5, 6, 0, 0}, {7, 8, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
+	m4float cd = m4float_mul(c, d);
+	v2int v = m2int_mul_vec(a, (v2int) {{1, 1}});
+	v4float w = m4float_mul_vec(c, (v4float) {{1, 1, 2, 3}});
+	if (!m2int_eq(m2int_mul(a, b), ab) || cd.array[0][1] != 22
+	|| cd.array[1][0] != 43 || v.x != 3 || v.y != 7
+	|| w.x != 3 || w.y != 7 || w.z != 2 || w.w != 3) {
+		ERROR_MSG("Mul order test FAILED!");
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += kernels_float();
+	no_errors += kernels_double();
+	no_errors += mul_order();
+	no_errors += batch_float();
+	no_errors += batch_double();
+	no_errors += batch_int();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -0,0 +1,171 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_SLOTMAP_H
+#define RH_SLOTMAP_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+// Generational slot map
+// Values are kept packed in items[0, top) so iterating is an array scan, and
+// are referred to by 64 bit handles of (generation << 32 | slot); the slot
+// records where its value is, and erasing moves the last value into the gap
+// Erasing bumps the slot's generation, so stale handles are rejected rather
+// than finding whatever later reuses the slot; 0 is never a valid handle
+#define RH_SLOTMAP_MAKE(NAME, TYPE)						\
+	RH_SLOTMAP_DEF(NAME, TYPE);						\
+	RH_SLOTMAP_IMPL(NAME, TYPE);
+
+// Slots are 32 bit
+#define RH_SLOTMAP_MAX UINT32_MAX
+
+// Useful iteration macro, over the values in no particular order
+#define rh_slotmap_for(iter, sm)						\
+if (sm.items)									\
+	for (size_t _i = 0, _j = 0; _i < sm.top; ++_i, _j=0)			\
+		for (iter = sm.items[_i]; !_j; _j = 1)
+
+#define RH_SLOTMAP_DEF(NAME, TYPE)						\
+typedef struct {								\
+	uint32_t gen;								\
+	/* Position in items when in use, otherwise the next free slot + 1 */	\
+	uint32_t index;								\
+} NAME##_slot;									\
+										\
+typedef struct {								\
+	size_t size;								\
+	size_t top;								\
+										\
+	TYPE *items;								\
+	/* Slot of each value */						\
+	uint32_t *owner;							\
+										\
+	size_t no_slots;							\
+	NAME##_slot *slots;							\
+	/* First free slot + 1, or 0 if none */					\
+	uint32_t free;								\
+} NAME;
+
+#define RH_SLOTMAP_IMPL(NAME, TYPE)						\
+static inline size_t NAME##_resize(NAME *sm, size_t to) {			\
+	if (sm->no_slots > to || to >= RH_SLOTMAP_MAX) {			\
+		return 0;							\
+	}									\
+										\
+	TYPE *items = realloc(sm->items, to * sizeof(*items));			\
+	if (!items) {								\
+		return 0;							\
+	}									\
+	sm->items = items;							\
+										\
+	uint32_t *owner = realloc(sm->owner, to * sizeof(*owner));		\
+	if (!owner) {								\
+		return 0;							\
+	}									\
+	sm->owner = owner;							\
+										\
+	/* Slots never outnumber the most values held */			\
+	NAME##_slot *slots = realloc(sm->slots, to * sizeof(*slots));		\
+	if (!slots) {								\
+		return 0;							\
+	}									\
+	sm->slots = slots;							\
+	sm->size = to;								\
+										\
+	return sm->size;							\
+}										\
+										\
+static inline NAME NAME##_new(size_t size) {					\
+	NAME ret = {0};								\
+	NAME##_resize(&ret, size);						\
+	return ret;								\
+}										\
+										\
+static inline void NAME##_free(NAME *sm) {					\
+	free(sm->items);							\
+	free(sm->owner);							\
+	free(sm->slots);							\
+	*sm = (NAME) {0};							\
+}										\
+										\
+static inline uint64_t NAME##_handle_at(NAME *sm, size_t i) {			\
+	uint32_t slot = sm->owner[i];						\
+	return (uint64_t) sm->slots[slot].gen << 32 | slot;			\
+}										\
+										\
+static inline TYPE *NAME##_get(NAME *sm, uint64_t handle) {			\
+	uint32_t slot = (uint32_t) handle;					\
+	if (slot >= sm->no_slots || sm->slots[slot].gen != handle >> 32) {	\
+		return NULL;							\
+	}									\
+	return &sm->items[sm->slots[slot].index];				\
+}										\
+										\
+static inline int NAME##_contains(NAME *sm, uint64_t handle) {			\
+	return NAME##_get(sm, handle) != NULL;					\
+}										\
+										\
+/* Returns the new value's handle, or 0 if it could not be added */		\
+static inline uint64_t NAME##_ins(NAME *sm, TYPE value) {			\
+	if (sm->top == sm->size							\
+	&& !NAME##_resize(sm, (sm->size?:4) * 2)) {				\
+		return 0;							\
+	}									\
+										\
+	uint32_t slot;								\
+	if (!sm->free) {							\
+		slot = sm->no_slots++;						\
+		sm->slots[slot].gen = 1;					\
+	} else {								\
+		slot = sm->free - 1;						\
+		sm->free = sm->slots[slot].index;				\
+	}									\
+										\
+	sm->slots[slot].index = sm->top;					\
+	sm->owner[sm->top] = slot;						\
+	sm->items[sm->top++] = value;						\
+	return (uint64_t) sm->slots[slot].gen << 32 | slot;			\
+}										\
+										\
+/* Returns 0 if handle was not in the map */					\
+static inline int NAME##_erase(NAME *sm, uint64_t handle) {			\
+	if (!NAME##_contains(sm, handle)) {					\
+		return 0;							\
+	}									\
+										\
+	uint32_t slot = (uint32_t) handle;					\
+	uint32_t i = sm->slots[slot].index;					\
+	if (i != --sm->top) {							\
+		sm->items[i] = sm->items[sm->top];				\
+		sm->owner[i] = sm->owner[sm->top];				\
+		sm->slots[sm->owner[i]].index = i;				\
+	}									\
+										\
+	/* Generation 0 is skipped so 0 is never a handle */			\
+	sm->slots[slot].gen = sm->slots[slot].gen + 1 ?: 1;			\
+	sm->slots[slot].index = sm->free;					\
+	sm->free = slot + 1;							\
+	return 1;								\
+}										\
+
+#endif
@@ -0,0 +1,143 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_slotmap.h"
+#include "rh_hash.h"
+#include "rh_pool.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+typedef struct {
+	uint64_t id;
+	double x, y, vx, vy;
+} entity;
+
+static inline uint64_t hash_u64(uint64_t key) {
+	key *= 0x9E3779B97F4A7C15LU;
+	return (key ^ key >> 32) ?: 1;
+}
+
+#define EQ_U64(A, B) ((A) == (B))
+
+RH_SLOTMAP_MAKE(entity_map, entity);
+RH_HASH_MAKE(entity_index, uint64_t, entity *, hash_u64, EQ_U64, 0.9);
+RH_SIZED_POOL_MAKE(entity_pool, sizeof(entity), malloc, free);
+
+#define ENTITIES (1 << 20)
+#define LOOKUPS (1 << 23)
+#define CHURN (1 << 20)
+
+// Entities are created, looked up by id at random, churned by destroying a
+// random entity and creating a new one, then all updated in a scan
+static void bench_slotmap(uint64_t *ids) {
+	entity_map sm = entity_map_new(ENTITIES);
+	uint64_t seed = 12;
+	double sum = 0;
+
+	uint64_t start = rh_bench_now();
+	for (size_t i = 0;i < ENTITIES;++i) {
+		ids[i] = entity_map_ins(&sm, (entity) {i, i, i, 1, 1});
+	}
+	uint64_t created = rh_bench_now();
+	for (size_t i = 0;i < LOOKUPS;++i) {
+		sum += entity_map_get(&sm, ids[rh_bench_rand(&seed) % ENTITIES])->x;
+	}
+	uint64_t looked = rh_bench_now();
+	for (size_t i = 0;i < CHURN;++i) {
+		size_t j = rh_bench_rand(&seed) % ENTITIES;
+		entity_map_erase(&sm, ids[j]);
+		ids[j] = entity_map_ins(&sm, (entity) {j, j, j, 1, 1});
+	}
+	uint64_t churned = rh_bench_now();
+	for (size_t i = 0;i < sm.top;++i) {
+		sm.items[i].x += sm.items[i].vx;
+		sm.items[i].y += sm.items[i].vy;
+		sum += sm.items[i].y;
+	}
+	uint64_t end = rh_bench_now();
+	rh_bench_use(sum);
+
+	rh_bench_report("slotmap create", ENTITIES, created - start);
+	rh_bench_report("slotmap lookup", LOOKUPS, looked - created);
+	rh_bench_report("slotmap destroy+create", CHURN, churned - looked);
+	rh_bench_report("slotmap update scan", ENTITIES, end - churned);
+	entity_map_free(&sm);
+}
+
+static void bench_hash_pool(uint64_t *ids) {
+	entity_index index = entity_index_new(ENTITIES * 2);
+	uint64_t seed = 12;
+	uint64_t next_id = 1;
+	double sum = 0;
+
+	uint64_t start = rh_bench_now();
+	for (size_t i = 0;i < ENTITIES;++i) {
+		entity *e = entity_pool_alloc();
+		*e = (entity) {next_id, i, i, 1, 1};
+		ids[i] = next_id++;
+		entity_index_set(&index, e->id, e);
+	}
+	uint64_t created = rh_bench_now();
+	for (size_t i = 0;i < LOOKUPS;++i) {
+		size_t j = rh_bench_rand(&seed) % ENTITIES;
+		sum += entity_index_find(&index, ids[j])->value->x;
+	}
+	uint64_t looked = rh_bench_now();
+	for (size_t i = 0;i < CHURN;++i) {
+		size_t j = rh_bench_rand(&seed) % ENTITIES;
+		entity_pool_free(entity_index_remove(&index, ids[j]).value);
+		entity *e = entity_pool_alloc();
+		*e = (entity) {next_id, j, j, 1, 1};
+		ids[j] = next_id++;
+		entity_index_set(&index, e->id, e);
+	}
+	uint64_t churned = rh_bench_now();
+	rh_hash_ref_for(entity *e, index) {
+		e->x += e->vx;
+		e->y += e->vy;
+		sum += e->y;
+	}
+	uint64_t end = rh_bench_now();
+	rh_bench_use(sum);
+
+	rh_bench_report("hash+pool create", ENTITIES, created - start);
+	rh_bench_report("hash+pool lookup", LOOKUPS, looked - created);
+	rh_bench_report("hash+pool destroy+create", CHURN, churned - looked);
+	rh_bench_report("hash+pool update scan", ENTITIES, end - churned);
+
+	rh_hash_for(entity *e, index) {
+		entity_pool_free(e);
+	}
+	entity_index_free(&index);
+	entity_pool_freeall();
+}
+
+int main() {
+	uint64_t *ids = malloc(ENTITIES * sizeof(*ids));
+
+	bench_slotmap(ids);
+	bench_hash_pool(ids);
+
+	free(ids);
+	return 0;
+}
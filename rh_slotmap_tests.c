@@ -0,0 +1,104 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_slotmap.h"
+#include <stdio.h>
+
+RH_SLOTMAP_MAKE(test_map, int);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+int ins_get(void) {
+	test_map sm = {0};
+	uint64_t a = test_map_ins(&sm, 1);
+	uint64_t b = test_map_ins(&sm, 2);
+	if (!a || !b || a == b || *test_map_get(&sm, a) != 1
+	|| *test_map_get(&sm, b) != 2 || test_map_get(&sm, 0)) {
+		ERROR_MSG("Ins get test FAILED!");
+		return 1;
+	}
+
+	test_map_free(&sm);
+	return 0;
+}
+
+int erase_stale(void) {
+	test_map sm = test_map_new(4);
+	uint64_t a = test_map_ins(&sm, 1);
+	uint64_t b = test_map_ins(&sm, 2);
+	uint64_t c = test_map_ins(&sm, 3);
+	test_map_erase(&sm, a);
+	// The slot is reused with a new generation
+	uint64_t d = test_map_ins(&sm, 4);
+	if (test_map_erase(&sm, a) || test_map_get(&sm, a)
+	|| (uint32_t) d != (uint32_t) a || *test_map_get(&sm, b) != 2
+	|| *test_map_get(&sm, c) != 3 || *test_map_get(&sm, d) != 4
+	|| sm.top != 3) {
+		ERROR_MSG("Erase stale test FAILED!");
+		return 1;
+	}
+
+	test_map_free(&sm);
+	return 0;
+}
+
+int dense(void) {
+	test_map sm = {0};
+	uint64_t handles[100];
+	for (int i = 0;i < 100;++i) {
+		handles[i] = test_map_ins(&sm, i);
+	}
+	for (int i = 0;i < 100;i += 2) {
+		test_map_erase(&sm, handles[i]);
+	}
+
+	int sum = 0;
+	rh_slotmap_for(int v, sm) {
+		sum += v;
+	}
+	for (size_t i = 0;i < sm.top;++i) {
+		if (*test_map_get(&sm, test_map_handle_at(&sm, i)) != sm.items[i]) {
+			sum = -1;
+		}
+	}
+	if (sm.top != 50 || sum != 2500) {
+		ERROR_MSG("Dense test FAILED!");
+		return 1;
+	}
+
+	test_map_free(&sm);
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += ins_get();
+	no_errors += erase_stale();
+	no_errors += dense();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
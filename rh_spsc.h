@@ -0,0 +1,158 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_SPSC_H
+#define RH_SPSC_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#ifndef RH_CACHE_LINE
+#define RH_CACHE_LINE 64
+#endif
+
+// Lock free ring for exactly one producer thread and one consumer thread
+// Indices run freely and are masked on access, so all CAPACITY slots are used
+// Each side keeps a cached copy of the other side's index and only reloads
+// it (an acquire on the other side's cache line) when the ring looks full
+// or empty
+#define RH_SPSC_MAKE(NAME, TYPE, CAPACITY)					\
+	RH_SPSC_DEF(NAME, TYPE, CAPACITY);					\
+	RH_SPSC_IMPL(NAME, TYPE, CAPACITY);
+
+#define RH_SPSC_DEF(NAME, TYPE, CAPACITY)					\
+_Static_assert((CAPACITY) && !((CAPACITY) & ((CAPACITY) - 1)),			\
+		#NAME " capacity must be a power of two");			\
+typedef struct {								\
+	/* Written by the consumer */						\
+	_Alignas(RH_CACHE_LINE) _Atomic size_t head;				\
+	size_t tail_cache;							\
+										\
+	/* Written by the producer */						\
+	_Alignas(RH_CACHE_LINE) _Atomic size_t tail;				\
+	size_t head_cache;							\
+										\
+	_Alignas(RH_CACHE_LINE) TYPE items[CAPACITY];				\
+} NAME;										\
+
+#define RH_SPSC_IMPL(NAME, TYPE, CAPACITY)					\
+static inline void NAME##_init(NAME *q) {					\
+	atomic_init(&q->head, 0);						\
+	atomic_init(&q->tail, 0);						\
+	q->tail_cache = 0;							\
+	q->head_cache = 0;							\
+}										\
+										\
+static inline NAME *NAME##_new(void) {						\
+	NAME *q = aligned_alloc(_Alignof(NAME), sizeof(NAME));			\
+	if (q) {								\
+		NAME##_init(q);							\
+	}									\
+	return q;								\
+}										\
+										\
+static inline void NAME##_free(NAME *q) {					\
+	free(q);								\
+}										\
+										\
+/* Approximate unless called from the producer or consumer */			\
+static inline size_t NAME##_size(NAME *q) {					\
+	return atomic_load_explicit(&q->tail, memory_order_acquire)		\
+		- atomic_load_explicit(&q->head, memory_order_acquire);		\
+}										\
+										\
+/* Producer only */								\
+static inline int NAME##_push(NAME *q, TYPE push) {				\
+	size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);	\
+	if (tail - q->head_cache == (CAPACITY)) {				\
+		q->head_cache = atomic_load_explicit(&q->head,			\
+				memory_order_acquire);				\
+		if (tail - q->head_cache == (CAPACITY)) {			\
+			return 0;						\
+		}								\
+	}									\
+										\
+	q->items[tail & ((CAPACITY) - 1)] = push;				\
+	atomic_store_explicit(&q->tail, tail + 1, memory_order_release);	\
+	return 1;								\
+}										\
+										\
+/* Producer only, returns the number of items pushed */				\
+static inline size_t NAME##_push_n(NAME *q, const TYPE *push, size_t n) {	\
+	size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);	\
+	if ((CAPACITY) - (tail - q->head_cache) < n) {				\
+		q->head_cache = atomic_load_explicit(&q->head,			\
+				memory_order_acquire);				\
+		size_t space = (CAPACITY) - (tail - q->head_cache);		\
+		n = n < space ? n : space;					\
+	}									\
+	if (!n) {								\
+		return 0;							\
+	}									\
+										\
+	size_t at = tail & ((CAPACITY) - 1);					\
+	size_t first = (CAPACITY) - at < n ? (CAPACITY) - at : n;		\
+	memcpy(&q->items[at], push, first * sizeof(TYPE));			\
+	memcpy(q->items, push + first, (n - first) * sizeof(TYPE));		\
+	atomic_store_explicit(&q->tail, tail + n, memory_order_release);	\
+	return n;								\
+}										\
+										\
+/* Consumer only */								\
+static inline int NAME##_pop(NAME *q, TYPE *pop) {				\
+	size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);	\
+	if (head == q->tail_cache) {						\
+		q->tail_cache = atomic_load_explicit(&q->tail,			\
+				memory_order_acquire);				\
+		if (head == q->tail_cache) {					\
+			return 0;						\
+		}								\
+	}									\
+										\
+	*pop = q->items[head & ((CAPACITY) - 1)];				\
+	atomic_store_explicit(&q->head, head + 1, memory_order_release);	\
+	return 1;								\
+}										\
+										\
+/* Consumer only, returns the number of items popped */				\
+static inline size_t NAME##_pop_n(NAME *q, TYPE *pop, size_t n) {		\
+	size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);	\
+	if (q->tail_cache - head < n) {						\
+		q->tail_cache = atomic_load_explicit(&q->tail,			\
+				memory_order_acquire);				\
+		size_t avail = q->tail_cache - head;				\
+		n = n < avail ? n : avail;					\
+	}									\
+	if (!n) {								\
+		return 0;							\
+	}									\
+										\
+	size_t at = head & ((CAPACITY) - 1);					\
+	size_t first = (CAPACITY) - at < n ? (CAPACITY) - at : n;		\
+	memcpy(pop, &q->items[at], first * sizeof(TYPE));			\
+	memcpy(pop + first, q->items, (n - first) * sizeof(TYPE));		\
+	atomic_store_explicit(&q->head, head + n, memory_order_release);	\
+	return n;								\
+}										\
+
+#endif
@@ -0,0 +1,212 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_spsc.h"
+#include "rh_deq.h"
+#include "rh_bench.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+RH_SPSC_MAKE(ring, uint64_t, 1 << 12);
+RH_DEQ_MAKE(locked_deq, uint64_t);
+
+#define MESSAGES (1 << 24)
+#define ROUND_TRIPS (1 << 16)
+#define BATCH 64
+
+// Spinning without ever yielding livelocks when both threads share one core
+static inline void relax(unsigned *spins) {
+	if (++*spins & 0xff) {
+		__asm__ volatile("" ::: "memory");
+	} else {
+		sched_yield();
+	}
+}
+
+typedef struct {
+	ring *a, *b;
+	locked_deq *d;
+	pthread_mutex_t *lock;
+	uint64_t sum;
+} bench_args;
+
+static void *ring_consumer(void *arg) {
+	bench_args *args = arg;
+	unsigned spins = 0;
+	uint64_t v;
+	for (size_t i = 0;i < MESSAGES;++i) {
+		while (!ring_pop(args->a, &v)) {
+			relax(&spins);
+		}
+		args->sum += v;
+	}
+	return NULL;
+}
+
+static void *ring_batch_consumer(void *arg) {
+	bench_args *args = arg;
+	unsigned spins = 0;
+	uint64_t v[BATCH];
+	for (size_t i = 0;i < MESSAGES;) {
+		size_t n = ring_pop_n(args->a, v, BATCH);
+		if (!n) {
+			relax(&spins);
+		}
+		for (size_t j = 0;j < n;++j) {
+			args->sum += v[j];
+		}
+		i += n;
+	}
+	return NULL;
+}
+
+static void *deq_consumer(void *arg) {
+	bench_args *args = arg;
+	unsigned spins = 0;
+	for (size_t i = 0;i < MESSAGES;) {
+		pthread_mutex_lock(args->lock);
+		int got = !locked_deq_empty(args->d);
+		uint64_t v = got ? locked_deq_rpop(args->d) : 0;
+		pthread_mutex_unlock(args->lock);
+		if (got) {
+			args->sum += v;
+			++i;
+		} else {
+			relax(&spins);
+		}
+	}
+	return NULL;
+}
+
+static void *ring_echo(void *arg) {
+	bench_args *args = arg;
+	unsigned spins = 0;
+	uint64_t v;
+	for (size_t i = 0;i < ROUND_TRIPS;++i) {
+		while (!ring_pop(args->a, &v)) {
+			relax(&spins);
+		}
+		while (!ring_push(args->b, v)) {
+			relax(&spins);
+		}
+	}
+	return NULL;
+}
+
+static void bench_throughput(void) {
+	bench_args args = { .a = ring_new() };
+	pthread_t t;
+	unsigned spins = 0;
+
+	uint64_t start = rh_bench_now();
+	pthread_create(&t, NULL, ring_consumer, &args);
+	for (uint64_t i = 0;i < MESSAGES;++i) {
+		while (!ring_push(args.a, i)) {
+			relax(&spins);
+		}
+	}
+	pthread_join(t, NULL);
+	rh_bench_report("spsc push/pop", MESSAGES, rh_bench_now() - start);
+	if (args.sum != (uint64_t) MESSAGES * (MESSAGES - 1) / 2) {
+		fprintf(stderr, "spsc push/pop lost messages\n");
+	}
+	ring_free(args.a);
+}
+
+static void bench_batch_throughput(void) {
+	bench_args args = { .a = ring_new() };
+	pthread_t t;
+	unsigned spins = 0;
+	uint64_t v[BATCH];
+
+	uint64_t start = rh_bench_now();
+	pthread_create(&t, NULL, ring_batch_consumer, &args);
+	for (uint64_t i = 0;i < MESSAGES;) {
+		for (size_t j = 0;j < BATCH;++j) {
+			v[j] = i + j;
+		}
+		size_t n = ring_push_n(args.a, v, BATCH);
+		if (!n) {
+			relax(&spins);
+		}
+		/* Unpushed tail of the batch is regenerated next time round */
+		i += n;
+	}
+	pthread_join(t, NULL);
+	rh_bench_report("spsc push_n/pop_n", MESSAGES, rh_bench_now() - start);
+	if (args.sum != (uint64_t) MESSAGES * (MESSAGES - 1) / 2) {
+		fprintf(stderr, "spsc push_n/pop_n lost messages\n");
+	}
+	ring_free(args.a);
+}
+
+static void bench_locked_deq(void) {
+	locked_deq d = locked_deq_new(1 << 12);
+	pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+	bench_args args = { .d = &d, .lock = &lock };
+	pthread_t t;
+
+	uint64_t start = rh_bench_now();
+	pthread_create(&t, NULL, deq_consumer, &args);
+	for (uint64_t i = 0;i < MESSAGES;++i) {
+		pthread_mutex_lock(&lock);
+		locked_deq_push(&d, i);
+		pthread_mutex_unlock(&lock);
+	}
+	pthread_join(t, NULL);
+	rh_bench_report("mutex deq push/rpop", MESSAGES, rh_bench_now() - start);
+	locked_deq_free(&d);
+}
+
+static void bench_latency(void) {
+	bench_args args = { .a = ring_new(), .b = ring_new() };
+	pthread_t t;
+	unsigned spins = 0;
+	uint64_t v;
+
+	pthread_create(&t, NULL, ring_echo, &args);
+	uint64_t start = rh_bench_now();
+	for (uint64_t i = 0;i < ROUND_TRIPS;++i) {
+		while (!ring_push(args.a, i)) {
+			relax(&spins);
+		}
+		while (!ring_pop(args.b, &v)) {
+			relax(&spins);
+		}
+	}
+	uint64_t end = rh_bench_now();
+	pthread_join(t, NULL);
+	rh_bench_report("spsc round trip", ROUND_TRIPS, end - start);
+	ring_free(args.a);
+	ring_free(args.b);
+}
+
+int main() {
+	bench_throughput();
+	bench_batch_throughput();
+	bench_locked_deq();
+	bench_latency();
+
+	return 0;
+}
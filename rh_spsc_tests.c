@@ -0,0 +1,195 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_spsc.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+RH_SPSC_MAKE(test_ring, size_t, 8);
+RH_SPSC_MAKE(big_ring, uint64_t, 256);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+int bounds(void) {
+	test_ring *q = test_ring_new();
+	if (!q) {
+		ERROR_MSG("New test FAILED!");
+		return 1;
+	}
+
+	// All 8 slots are used
+	int errors = 0;
+	size_t item = 0, pushed = 0;
+	while (test_ring_push(q, pushed)) {
+		++pushed;
+	}
+	errors += pushed != 8 || test_ring_size(q) != 8;
+	for (size_t i = 0;i < 8;++i) {
+		errors += !test_ring_pop(q, &item) || item != i;
+	}
+	errors += test_ring_pop(q, &item) || test_ring_size(q);
+
+	// Batches are cut to the space or items there are
+	size_t in[12] = {0}, out[12] = {0};
+	for (size_t i = 0;i < 12;++i) {
+		in[i] = i + 100;
+	}
+	errors += test_ring_push_n(q, in, 5) != 5;
+	errors += test_ring_push_n(q, in + 5, 7) != 3;
+	errors += test_ring_push_n(q, in, 1) || test_ring_push(q, 0);
+	errors += test_ring_pop_n(q, out, 12) != 8;
+	errors += test_ring_pop_n(q, out, 1) || test_ring_pop(q, &item);
+	for (size_t i = 0;i < 8;++i) {
+		errors += out[i] != in[i];
+	}
+
+	test_ring_free(q);
+	if (errors) {
+		ERROR_MSG("Bounds test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+// Pushes and pops single items and batches across the end of the items,
+// starting the indices at start so they also wrap around their type
+static int wrap_from(size_t start) {
+	test_ring *q = test_ring_new();
+	q->head = q->tail = q->head_cache = q->tail_cache = start;
+
+	int errors = 0;
+	size_t in[8], out[8], item, next_in = 0, next_out = 0;
+	for (size_t round = 0;round < 40;++round) {
+		// Batches of 1 to 7 land at every offset, so split both ways
+		size_t n = 1 + round % 7;
+		for (size_t i = 0;i < n;++i) {
+			in[i] = next_in++;
+		}
+		if (round & 1) {
+			errors += test_ring_push_n(q, in, n) != n;
+		} else {
+			for (size_t i = 0;i < n;++i) {
+				errors += !test_ring_push(q, in[i]);
+			}
+		}
+		errors += test_ring_size(q) != n;
+
+		if (round % 3) {
+			errors += test_ring_pop_n(q, out, 8) != n;
+		} else {
+			for (size_t i = 0;i < n;++i) {
+				errors += !test_ring_pop(q, &out[i]);
+			}
+		}
+		for (size_t i = 0;i < n;++i) {
+			errors += out[i] != next_out++;
+		}
+		errors += test_ring_pop(q, &item);
+	}
+
+	test_ring_free(q);
+	return errors;
+}
+
+int wrap(void) {
+	int errors = wrap_from(0) + wrap_from(5) + wrap_from(SIZE_MAX - 20);
+	if (errors) {
+		ERROR_MSG("Wrap test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+// One producer and one consumer, each mixing single items and batches of
+// varying size; the consumer must see every item once and in order
+#define ITEMS (1 << 22)
+
+static void *producer(void *arg) {
+	big_ring *q = arg;
+	uint64_t batch[32];
+	uint64_t next = 0;
+	while (next < ITEMS) {
+		size_t n = 1 + next % 32;
+		n = n < ITEMS - next ? n : ITEMS - next;
+		if (n == 1) {
+			if (big_ring_push(q, next)) {
+				++next;
+				continue;
+			}
+		} else {
+			for (size_t i = 0;i < n;++i) {
+				batch[i] = next + i;
+			}
+			size_t pushed = big_ring_push_n(q, batch, n);
+			next += pushed;
+			if (pushed) {
+				continue;
+			}
+		}
+		sched_yield();
+	}
+	return NULL;
+}
+
+int threads(void) {
+	big_ring *q = big_ring_new();
+	pthread_t thread;
+	pthread_create(&thread, NULL, producer, q);
+
+	uint64_t batch[32];
+	uint64_t expected = 0;
+	size_t wrong = 0;
+	while (expected < ITEMS) {
+		size_t got = expected & 1 ? (size_t) big_ring_pop(q, batch)
+			: big_ring_pop_n(q, batch, 1 + expected % 31);
+		for (size_t i = 0;i < got;++i) {
+			wrong += batch[i] != expected++;
+		}
+		if (!got) {
+			sched_yield();
+		}
+	}
+	pthread_join(thread, NULL);
+	int left = big_ring_pop(q, batch);
+	big_ring_free(q);
+	if (wrong || left) {
+		ERROR_MSG("Threads test FAILED! %zu out of order", wrong);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += bounds();
+	no_errors += wrap();
+	no_errors += threads();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -0,0 +1,192 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_STAT_H
+#define RH_STAT_H
+
+// Opt-in memory accounting for pools and containers
+// Compiling with RH_INSTRUMENT defined gives each generated pool and
+// container type a NAME##_stat, registered on its first event, counting:
+// - live objects (pools) or live buffers (containers), and their peak
+// - bytes reserved from the backing allocator, and their peak
+// - bytes in use, live objects for pools and held items for containers,
+//   and their peak
+// - allocation, resize and free events
+// rh_stat_dump lists every registered type; without RH_INSTRUMENT the hooks
+// compile to nothing and none of this is declared
+
+#ifdef RH_INSTRUMENT
+#include <stdio.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+typedef struct rh_stat {
+	const char *name;
+	// Size of a pool's objects, 0 for containers
+	size_t object_size;
+
+	struct rh_stat *next;
+	_Atomic int registered;
+
+	_Atomic size_t live, peak_live;
+	_Atomic size_t reserved, peak_reserved;
+	// Containers only, pools use live * object_size
+	_Atomic size_t used, peak_used;
+	_Atomic size_t allocs, resizes, frees;
+} rh_stat;
+
+// Shared between translation units like the NAME##_stat themselves
+__attribute__((weak)) _Atomic(rh_stat *) rh_stat_list;
+
+static inline void rh_stat_register(rh_stat *s) {
+	if (atomic_load_explicit(&s->registered, memory_order_relaxed)
+	|| atomic_exchange(&s->registered, 1)) {
+		return;
+	}
+
+	s->next = atomic_load(&rh_stat_list);
+	while (!atomic_compare_exchange_weak(&rh_stat_list, &s->next, s));
+}
+
+static inline void rh_stat_add(_Atomic size_t *count, _Atomic size_t *peak, size_t by) {
+	size_t now = atomic_fetch_add_explicit(count, by, memory_order_relaxed) + by;
+	size_t seen = atomic_load_explicit(peak, memory_order_relaxed);
+	while (seen < now && !atomic_compare_exchange_weak_explicit(peak, &seen
+				, now, memory_order_relaxed, memory_order_relaxed));
+}
+
+static inline void rh_stat_sub(_Atomic size_t *count, size_t by) {
+	atomic_fetch_sub_explicit(count, by, memory_order_relaxed);
+}
+
+static inline void rh_stat_event(_Atomic size_t *count) {
+	atomic_fetch_add_explicit(count, 1, memory_order_relaxed);
+}
+
+// A container's buffer moving from old to new bytes, 0 meaning none
+static inline void rh_stat_resize(rh_stat *s, size_t old, size_t new) {
+	rh_stat_register(s);
+	if (!old) {
+		rh_stat_event(&s->allocs);
+		rh_stat_add(&s->live, &s->peak_live, 1);
+	} else {
+		rh_stat_event(&s->resizes);
+	}
+
+	if (new > old) {
+		rh_stat_add(&s->reserved, &s->peak_reserved, new - old);
+	} else {
+		rh_stat_sub(&s->reserved, old - new);
+	}
+}
+
+// Items of a container's buffer taking or giving up bytes
+static inline void rh_stat_use(rh_stat *s, size_t bytes) {
+	rh_stat_register(s);
+	rh_stat_add(&s->used, &s->peak_used, bytes);
+}
+
+static inline void rh_stat_unuse(rh_stat *s, size_t bytes) {
+	rh_stat_sub(&s->used, bytes);
+}
+
+// A container's buffer of bytes freed with used of them still held
+static inline void rh_stat_free(rh_stat *s, size_t bytes, size_t used) {
+	if (!bytes) {
+		return;
+	}
+
+	rh_stat_register(s);
+	rh_stat_event(&s->frees);
+	rh_stat_sub(&s->live, 1);
+	rh_stat_sub(&s->reserved, bytes);
+	rh_stat_sub(&s->used, used);
+}
+
+// An object taken from a pool, which reserved bytes more to provide it
+static inline void rh_stat_pool_alloc(rh_stat *s, size_t reserved) {
+	rh_stat_register(s);
+	rh_stat_event(&s->allocs);
+	rh_stat_add(&s->live, &s->peak_live, 1);
+	if (reserved) {
+		rh_stat_add(&s->reserved, &s->peak_reserved, reserved);
+	}
+}
+
+static inline void rh_stat_pool_free(rh_stat *s) {
+	rh_stat_register(s);
+	rh_stat_event(&s->frees);
+	rh_stat_sub(&s->live, 1);
+}
+
+// After the pool's free objects are released, or everything if clear
+static inline void rh_stat_pool_freeall(rh_stat *s, int clear) {
+	if (clear) {
+		atomic_store_explicit(&s->live, 0, memory_order_relaxed);
+	}
+	atomic_store_explicit(&s->reserved, atomic_load(&s->live) * s->object_size
+			, memory_order_relaxed);
+}
+
+static inline void rh_stat_dump(FILE *out) {
+	fprintf(out, "%-24s %10s %10s %12s %12s %12s %12s %10s %10s %10s\n"
+			, "name", "live", "peak", "reserved", "peak res", "used"
+			, "peak used", "allocs", "resizes", "frees");
+	for (rh_stat *s = atomic_load(&rh_stat_list);s;s = s->next) {
+		char peak_used[24] = "-";
+		size_t used = atomic_load(&s->live) * s->object_size;
+		if (!s->object_size) {
+			used = atomic_load(&s->used);
+			snprintf(peak_used, sizeof(peak_used), "%zu"
+					, atomic_load(&s->peak_used));
+		}
+		fprintf(out, "%-24s %10zu %10zu %12zu %12zu %12zu %12s %10zu %10zu %10zu\n"
+				, s->name, atomic_load(&s->live), atomic_load(&s->peak_live)
+				, atomic_load(&s->reserved), atomic_load(&s->peak_reserved)
+				, used, peak_used, atomic_load(&s->allocs)
+				, atomic_load(&s->resizes), atomic_load(&s->frees));
+	}
+}
+
+// Hooks used by the generators
+#define RH_STAT_DEF(NAME, SIZE)							\
+__attribute__((weak)) rh_stat NAME##_stat = {.name = #NAME, .object_size = SIZE};
+#define RH_STAT_RESIZE(NAME, OLD, NEW) rh_stat_resize(&NAME##_stat, OLD, NEW)
+#define RH_STAT_USE(NAME, BYTES) rh_stat_use(&NAME##_stat, BYTES)
+#define RH_STAT_UNUSE(NAME, BYTES) rh_stat_unuse(&NAME##_stat, BYTES)
+#define RH_STAT_FREE(NAME, BYTES, USED) rh_stat_free(&NAME##_stat, BYTES, USED)
+#define RH_STAT_POOL_ALLOC(NAME, RESERVED) rh_stat_pool_alloc(&NAME##_stat, RESERVED)
+#define RH_STAT_POOL_FREE(NAME) rh_stat_pool_free(&NAME##_stat)
+#define RH_STAT_POOL_FREEALL(NAME, CLEAR) rh_stat_pool_freeall(&NAME##_stat, CLEAR)
+#else
+#define RH_STAT_DEF(NAME, SIZE)
+#define RH_STAT_RESIZE(NAME, OLD, NEW) ((void) 0)
+#define RH_STAT_USE(NAME, BYTES) ((void) 0)
+#define RH_STAT_UNUSE(NAME, BYTES) ((void) 0)
+#define RH_STAT_FREE(NAME, BYTES, USED) ((void) 0)
+#define RH_STAT_POOL_ALLOC(NAME, RESERVED) ((void) 0)
+#define RH_STAT_POOL_FREE(NAME) ((void) 0)
+#define RH_STAT_POOL_FREEALL(NAME, CLEAR) ((void) 0)
+#define rh_stat_dump(OUT) ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,141 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_INSTRUMENT
+#define RH_INSTRUMENT
+#endif
+#ifndef RH_POOL_DEBUG
+#define RH_POOL_DEBUG
+#endif
+
+#include "rh_al.h"
+#include "rh_hash.h"
+#include "rh_pool.h"
+#include <stdio.h>
+
+RH_AL_MAKE(test_al, int);
+RH_HASH_MAKE(test_map, const char *, int, rh_string_hash, rh_string_eq, 0.9);
+RH_SIZED_POOL_MAKE(test_pool, 32, malloc, free);
+RH_SIZED_SLAB_POOL_MAKE(test_slab, 32, 1024, 32);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__); rh_stat_dump(stderr)
+
+int container_stats(void) {
+	test_al a = {0}, b = {0};
+	for (int i = 0;i < 5;++i) {
+		test_al_push(&a, i);
+	}
+	test_al_push(&b, 1);
+	test_al_pop(&a);
+	// a grows 2 -> 4 -> 8 ints and b is 2, the first growths are allocs
+	if (test_al_stat.live != 2 || test_al_stat.allocs != 2
+	|| test_al_stat.resizes != 2 || test_al_stat.reserved != 10 * sizeof(int)
+	|| test_al_stat.used != 5 * sizeof(int)
+	|| test_al_stat.peak_used != 6 * sizeof(int)) {
+		ERROR_MSG("Container stats test FAILED!");
+		return 1;
+	}
+
+	test_al_free(&a);
+	test_al_free(&b);
+	// Held items count once each, across the map growing and a clone
+	size_t item = sizeof(uint64_t) + sizeof(test_map_bucket);
+	test_map map = test_map_new(2);
+	const char *keys[] = {"a", "b", "c", "d", "e", "f"};
+	for (int i = 0;i < 6;++i) {
+		test_map_set(&map, keys[i], i);
+	}
+	test_map_set(&map, "a", 7);
+	test_map_remove(&map, "b");
+	test_map copy = test_map_clone(&map);
+	if (test_map_stat.used != 10 * item || test_map_stat.peak_used != 10 * item) {
+		ERROR_MSG("Map used stats test FAILED!");
+		return 1;
+	}
+	test_map_free(&copy);
+	test_map_free(&map);
+	if (test_al_stat.live || test_al_stat.reserved || test_al_stat.used
+	|| test_al_stat.peak_reserved != 10 * sizeof(int)
+	|| test_map_stat.frees != 2 || test_map_stat.reserved
+	|| test_map_stat.used) {
+		ERROR_MSG("Container free stats test FAILED!");
+		return 1;
+	}
+	return 0;
+}
+
+int pool_stats(void) {
+	void *a = test_pool_alloc();
+	void *b = test_pool_alloc();
+	test_pool_free(a);
+	void *c = test_pool_alloc();
+	if (a != c || test_pool_stat.live != 2 || test_pool_stat.peak_live != 2
+	|| test_pool_stat.reserved != 64) {
+		ERROR_MSG("Pool stats test FAILED!");
+		return 1;
+	}
+
+	test_pool_free(b);
+	test_pool_freeall();
+	void *d = test_slab_alloc();
+	if (test_pool_stat.reserved != 32 || test_slab_stat.reserved != 1024) {
+		ERROR_MSG("Pool freeall stats test FAILED!");
+		return 1;
+	}
+
+	test_slab_free(d);
+	test_slab_freeall();
+	test_pool_free(c);
+	test_pool_freeall();
+	return 0;
+}
+
+int double_free(void) {
+	unsigned char *a = test_slab_alloc();
+	test_slab_free(a);
+	// Reported and ignored rather than corrupting the free list
+	test_slab_free(a);
+	void *b = test_slab_alloc();
+	void *c = test_slab_alloc();
+	if (b != a || c == a || a[sizeof(rh_mem_link)] != RH_POOL_POISON) {
+		ERROR_MSG("Double free test FAILED!");
+		return 1;
+	}
+
+	test_slab_freeall();
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += container_stats();
+	no_errors += pool_stats();
+	no_errors += double_free();
+
+	rh_stat_dump(stdout);
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -0,0 +1,428 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_hash.h"
+#include "rh_al.h"
+#include "rh_short_al.h"
+#include "rh_deq.h"
+#include "rh_heap.h"
+#include "rh_pool.h"
+#include "rh_vec.h"
+#include "rh_mat.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Every container under the same harness: each workload is run over sizes
+// from inside L1 to well past the last level cache, with keys drawn uniformly
+// and from a Zipfian distribution, reporting ns/op, percentiles over batches
+// of ops and, built with -DRH_BENCH_PERF, hardware counters per op
+// Results are also written to bench_output.txt, one line each
+//
+// Usage: rh_suite_bench [max log2 size] [name filter]
+
+static inline uint64_t hash_u64(uint64_t key) {
+	key *= 0x9E3779B97F4A7C15LU;
+	return (key ^ key >> 32) ?: 1;
+}
+
+#define EQ_U64(A, B) ((A) == (B))
+#define CMP_U64(A, B) (((A) > (B)) - ((A) < (B)))
+
+RH_HASH_MAKE(u64_map, uint64_t, uint64_t, hash_u64, EQ_U64, 0.9);
+RH_AL_MAKE(u64_al, uint64_t);
+RH_SHORT_AL_MAKE(u64_short_al, uint64_t);
+RH_DEQ_MAKE(u64_deq, uint64_t);
+RH_HEAP_MAKE(u64_heap, uint64_t, CMP_U64);
+
+#define OBJECT 64
+RH_SIZED_POOL_MAKE(object_pool, OBJECT, malloc, free);
+
+RH_VEC_MAKE(float);
+RH_MAT_MAKE(float);
+RH_MAT_VEC_IMPL(float);
+
+#define OPS (1 << 20)
+#define BATCH 256
+#define ZIPF_THETA 0.99
+
+#define MIN_LOG2 10
+#define STEP_LOG2 3
+#define MAX_LOG2 22
+
+// Workloads keep their state here between setup and teardown
+static size_t size;
+static u64_map map;
+static u64_al al;
+static u64_short_al *lists;
+static u64_deq deq;
+static u64_heap heap;
+static void **objects;
+static v4float *va, *vb;
+static m4float *ma;
+
+// Hash map of keys [0, size), looked up by present and absent keys, and
+// churned by removing a key and setting it again
+static void hash_setup(uint64_t *seed) {
+	(void) seed;
+	map = u64_map_new(16);
+	for (size_t i = 0;i < size;++i) {
+		u64_map_set(&map, i, i);
+	}
+}
+
+static uint64_t hash_find_hit(const uint64_t *keys, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		sum += u64_map_find(&map, keys[i])->value;
+	}
+	return sum;
+}
+
+static uint64_t hash_find_miss(const uint64_t *keys, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		sum += !u64_map_find(&map, keys[i] + size);
+	}
+	return sum;
+}
+
+static uint64_t hash_churn(const uint64_t *keys, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		sum += u64_map_remove(&map, keys[i]).value;
+		u64_map_set(&map, keys[i], keys[i]);
+	}
+	return sum;
+}
+
+static void hash_teardown(void) {
+	u64_map_free(&map);
+}
+
+// Array list read at random positions, and filled to size then freed
+static void al_setup(uint64_t *seed) {
+	al = u64_al_new(size);
+	for (size_t i = 0;i < size;++i) {
+		u64_al_push(&al, rh_bench_rand(seed));
+	}
+}
+
+static uint64_t al_view(const uint64_t *keys, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		sum += u64_al_view(&al, keys[i]);
+	}
+	return sum;
+}
+
+static uint64_t al_push(const uint64_t *keys, size_t n) {
+	for (size_t i = 0;i < n;++i) {
+		if (al.top == size) {
+			u64_al_free(&al);
+			al = (u64_al) {0};
+		}
+		u64_al_push(&al, keys[i]);
+	}
+	return al.top;
+}
+
+static void al_teardown(void) {
+	u64_al_free(&al);
+}
+
+// Many short lists, a quarter as many as size, pushed until they spill past
+// their inline items and popped back
+#define SHORT_LISTS(N) ((N) / 4 ?: 1)
+#define SHORT_DEPTH 4
+
+static void short_al_setup(uint64_t *seed) {
+	(void) seed;
+	lists = calloc(SHORT_LISTS(size), sizeof(*lists));
+}
+
+static uint64_t short_al_push_pop(const uint64_t *keys, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		u64_short_al *list = &lists[keys[i] % SHORT_LISTS(size)];
+		if (list->top < SHORT_DEPTH) {
+			u64_short_al_push(list, keys[i]);
+		} else {
+			sum += u64_short_al_pop(list);
+		}
+		sum += u64_short_al_view(list, 0);
+	}
+	return sum;
+}
+
+static void short_al_teardown(void) {
+	for (size_t i = 0;i < SHORT_LISTS(size);++i) {
+		u64_short_al_free(&lists[i]);
+	}
+	free(lists);
+}
+
+// FIFO queue holding size items, each op pushing one and taking the oldest
+static void deq_setup(uint64_t *seed) {
+	deq = u64_deq_new(size);
+	for (size_t i = 0;i < size;++i) {
+		u64_deq_push(&deq, rh_bench_rand(seed));
+	}
+}
+
+static uint64_t deq_fifo(const uint64_t *keys, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		u64_deq_push(&deq, keys[i]);
+		sum += u64_deq_rpop(&deq);
+	}
+	return sum;
+}
+
+static void deq_teardown(void) {
+	u64_deq_free(&deq);
+}
+
+// The hold model: size items, removing the least and inserting it again
+// a key's delay later
+static void heap_setup(uint64_t *seed) {
+	heap = u64_heap_new(size);
+	for (size_t i = 0;i < size;++i) {
+		u64_heap_ins(&heap, rh_bench_rand(seed) >> 32);
+	}
+}
+
+static uint64_t heap_hold(const uint64_t *keys, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		uint64_t v = u64_heap_rem(&heap);
+		u64_heap_ins(&heap, v + keys[i]);
+		sum += v;
+	}
+	return sum;
+}
+
+static void heap_teardown(void) {
+	u64_heap_free(&heap);
+}
+
+// size live objects, each op freeing one and allocating its replacement,
+// from the pool and from malloc
+static void objects_setup(uint64_t *seed) {
+	(void) seed;
+	objects = malloc(size * sizeof(*objects));
+	for (size_t i = 0;i < size;++i) {
+		objects[i] = object_pool_alloc();
+		memset(objects[i], 0, OBJECT);
+	}
+}
+
+static uint64_t pool_replace(const uint64_t *keys, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		object_pool_free(objects[keys[i]]);
+		uint64_t *object = objects[keys[i]] = object_pool_alloc();
+		object[0] = keys[i];
+		sum += object[OBJECT / sizeof(uint64_t) - 1];
+	}
+	return sum;
+}
+
+static uint64_t malloc_replace(const uint64_t *keys, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		free(objects[keys[i]]);
+		uint64_t *object = objects[keys[i]] = malloc(OBJECT);
+		object[0] = keys[i];
+		sum += object[OBJECT / sizeof(uint64_t) - 1];
+	}
+	return sum;
+}
+
+static void objects_teardown(void) {
+	for (size_t i = 0;i < size;++i) {
+		object_pool_free(objects[i]);
+	}
+	object_pool_freeall();
+	free(objects);
+}
+
+// Vectors and matrices picked by key, so larger sizes stream from memory
+static void vec_setup(uint64_t *seed) {
+	va = malloc(size * sizeof(*va));
+	vb = malloc(size * sizeof(*vb));
+	ma = malloc(size * sizeof(*ma));
+	for (size_t i = 0;i < size;++i) {
+		for (int k = 0;k < 4;++k) {
+			va[i].array[k] = (rh_bench_rand(seed) >> 40) * 0x1p-24f;
+			vb[i].array[k] = (rh_bench_rand(seed) >> 40) * 0x1p-24f;
+		}
+		for (int k = 0;k < 16;++k) {
+			ma[i].flat[k] = (rh_bench_rand(seed) >> 40) * 0x1p-24f;
+		}
+	}
+}
+
+static uint64_t vec_dot(const uint64_t *keys, size_t n) {
+	float sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		sum += v4float_dot(va[keys[i]], vb[keys[i]]);
+	}
+	return sum;
+}
+
+static uint64_t mat_mul(const uint64_t *keys, size_t n) {
+	float sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		sum += m4float_mul(ma[keys[i]], ma[(keys[i] + 1) % size]).flat[5];
+	}
+	return sum;
+}
+
+static uint64_t mat_mul_vec(const uint64_t *keys, size_t n) {
+	float sum = 0;
+	for (size_t i = 0;i < n;++i) {
+		sum += m4float_mul_vec(ma[keys[i]], va[keys[i]]).y;
+	}
+	return sum;
+}
+
+static void vec_teardown(void) {
+	free(va);
+	free(vb);
+	free(ma);
+}
+
+// Keyed workloads take keys in [0, size) under each distribution, the rest
+// take uniform 32 bit values
+typedef struct {
+	const char *name;
+	int keyed;
+	void (*setup)(uint64_t *seed);
+	uint64_t (*run)(const uint64_t *keys, size_t n);
+	void (*teardown)(void);
+} workload;
+
+static const workload workloads[] = {
+	{"hash find hit", 1, hash_setup, hash_find_hit, hash_teardown},
+	{"hash find miss", 1, hash_setup, hash_find_miss, hash_teardown},
+	{"hash remove+set", 1, hash_setup, hash_churn, hash_teardown},
+	{"al view", 1, al_setup, al_view, al_teardown},
+	{"al push", 0, al_setup, al_push, al_teardown},
+	{"short_al push/pop", 1, short_al_setup, short_al_push_pop
+		, short_al_teardown},
+	{"deq push+rpop", 0, deq_setup, deq_fifo, deq_teardown},
+	{"heap rem+ins", 0, heap_setup, heap_hold, heap_teardown},
+	{"pool free+alloc", 1, objects_setup, pool_replace, objects_teardown},
+	{"malloc free+alloc", 1, objects_setup, malloc_replace
+		, objects_teardown},
+	{"v4float dot", 1, vec_setup, vec_dot, vec_teardown},
+	{"m4float mul", 1, vec_setup, mat_mul, vec_teardown},
+	{"m4float mul_vec", 1, vec_setup, mat_mul_vec, vec_teardown},
+};
+
+enum { UNIFORM, ZIPF, DISTS };
+static const char *const dist_names[DISTS] = {"uniform", "zipf"};
+
+static void make_keys(uint64_t *keys, int keyed, int dist, uint64_t *seed) {
+	if (!keyed) {
+		for (size_t i = 0;i < OPS;++i) {
+			keys[i] = rh_bench_rand(seed) >> 32;
+		}
+		return;
+	}
+
+	// Multiplying by an odd constant permutes [0, size), scattering the
+	// popular Zipfian ranks across the container
+	rh_bench_zipf zipf = rh_bench_zipf_new(size, ZIPF_THETA);
+	for (size_t i = 0;i < OPS;++i) {
+		uint64_t rank = dist == ZIPF ? rh_bench_zipf_next(&zipf, seed)
+				: rh_bench_rand(seed);
+		keys[i] = (rank * 0x9E3779B97F4A7C15LU) & (size - 1);
+	}
+}
+
+static void bench(const workload *w, int dist, uint64_t *keys, FILE *out
+		, rh_bench_perf *perf) {
+	uint64_t seed = 0x5EED + size;
+	make_keys(keys, w->keyed, dist, &seed);
+	w->setup(&seed);
+
+	// Warm the caches and branch predictors over the first batches
+	rh_bench_use(w->run(keys, OPS / 16));
+
+	rh_bench_lat lat = rh_bench_lat_new(OPS / BATCH);
+	uint64_t check = 0;
+	rh_bench_perf_start(perf);
+	uint64_t start = rh_bench_now();
+	uint64_t last = start;
+	for (size_t i = 0;i < OPS;i += BATCH) {
+		check += w->run(&keys[i], BATCH);
+		uint64_t now = rh_bench_now();
+		rh_bench_lat_add(&lat, now - last, BATCH);
+		last = now;
+	}
+	rh_bench_perf_stop(perf);
+	rh_bench_use(check);
+	w->teardown();
+
+	char label[64];
+	snprintf(label, sizeof(label), "%s %zu %s", w->name, size
+			, dist_names[dist]);
+	rh_bench_report(label, OPS, last - start);
+	rh_bench_record(out, w->name, dist_names[dist], size, OPS, last - start
+			, &lat, perf);
+	rh_bench_lat_free(&lat);
+}
+
+int main(int argc, char **argv) {
+	int max_log2 = argc > 1 ? atoi(argv[1]) : MAX_LOG2;
+	const char *filter = argc > 2 ? argv[2] : NULL;
+
+	FILE *out = fopen("bench_output.txt", "w");
+	uint64_t *keys = malloc(OPS * sizeof(*keys));
+	if (!out || !keys) {
+		fprintf(stderr, "rh_suite_bench: cannot open bench_output.txt\n");
+		return 1;
+	}
+	rh_bench_perf perf = rh_bench_perf_open();
+
+	for (size_t i = 0;i < sizeof(workloads) / sizeof(workloads[0]);++i) {
+		const workload *w = &workloads[i];
+		if (filter && !strstr(w->name, filter)) {
+			continue;
+		}
+		for (int l = MIN_LOG2;l <= max_log2;l += STEP_LOG2) {
+			size = (size_t) 1 << l;
+			for (int dist = 0;dist < (w->keyed ? DISTS : 1);++dist) {
+				bench(w, dist, keys, out, &perf);
+			}
+		}
+	}
+
+	rh_bench_perf_close(&perf);
+	free(keys);
+	fclose(out);
+
+	return 0;
+}
@@ -0,0 +1,315 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_TASK_H
+#define RH_TASK_H
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "rh_pool.h"
+#include "rh_futex.h"
+#include "rh_ws.h"
+
+// Work stealing task pool
+// Each worker owns a work stealing deque, spawning and running its own tasks
+// depth first while idle workers steal the oldest (largest) tasks from others
+// The thread calling rh_task_pool_init becomes worker 0 and runs tasks while
+// it waits in rh_task_sync; spawn and sync may only be called from workers,
+// i.e. that thread or from inside a task
+
+// Spawned tasks are counted against a group, which sync waits on
+typedef struct {
+	_Atomic size_t pending;
+} rh_task_group;
+
+typedef void rh_task_fn(void *arg);
+typedef void rh_task_range_fn(void *arg, size_t begin, size_t end);
+
+typedef struct rh_task {
+	rh_task_group *group;
+	void *arg;
+	rh_task_fn *fn;
+
+	// Set for parallel_for ranges, which split themselves when run
+	rh_task_range_fn *range;
+	size_t begin, end, grain;
+} rh_task;
+
+RH_WS_DEQ_MAKE(rh_task_deq, rh_task *);
+
+typedef struct rh_task_worker {
+	_Alignas(RH_CACHE_LINE) rh_task_deq deq;
+	// Tasks are freed into the running worker's own pool
+	rh_mem_link *free;
+	uint64_t seed;
+	size_t id;
+	struct rh_task_pool *pool;
+} rh_task_worker;
+
+typedef struct rh_task_pool {
+	size_t no_workers;
+	rh_task_worker *workers;
+	pthread_t *threads;
+
+	_Atomic int stop;
+	// Idle workers sleep on work, woken when a task is spawned
+	_Atomic uint32_t work;
+	_Atomic uint32_t armed;
+} rh_task_pool;
+
+// Shared between translation units so a task may spawn from any of them
+__attribute__((weak)) _Thread_local rh_task_worker *rh_task_self;
+
+#ifndef RH_TASK_SPIN
+#define RH_TASK_SPIN 256
+#endif
+
+static inline void rh_task_run(rh_task_worker *self, rh_task *task);
+
+static inline int rh_task_find(rh_task_worker *self, rh_task **task) {
+	if (rh_task_deq_pop(&self->deq, task)) {
+		return 1;
+	}
+
+	rh_task_pool *pool = self->pool;
+	if (pool->no_workers < 2) {
+		return 0;
+	}
+
+	// xorshift to pick the first victim, then try everyone once
+	self->seed ^= self->seed << 13;
+	self->seed ^= self->seed >> 7;
+	self->seed ^= self->seed << 17;
+	size_t start = self->seed % pool->no_workers;
+	for (size_t i = 0;i < pool->no_workers;++i) {
+		size_t victim = (start + i) % pool->no_workers;
+		if (victim != self->id
+		&& rh_task_deq_steal(&pool->workers[victim].deq, task)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static inline void *rh_task_worker_main(void *arg) {
+	rh_task_worker *self = arg;
+	rh_task_pool *pool = self->pool;
+	rh_task_self = self;
+
+	rh_task *task;
+	while (!atomic_load_explicit(&pool->stop, memory_order_acquire)) {
+		int found = 0;
+		for (int i = 0;i < RH_TASK_SPIN && !found;++i) {
+			found = rh_task_find(self, &task);
+		}
+		if (found) {
+			rh_task_run(self, task);
+			continue;
+		}
+
+		uint32_t seen = atomic_load(&pool->work);
+		atomic_store(&pool->armed, 1);
+		atomic_thread_fence(memory_order_seq_cst);
+		if (rh_task_find(self, &task)) {
+			rh_task_run(self, task);
+			continue;
+		}
+		if (!atomic_load(&pool->stop)) {
+			rh_futex_wait(&pool->work, seen);
+		}
+	}
+
+	return NULL;
+}
+
+static inline void rh_task_push(rh_task_worker *self, rh_task *task) {
+	atomic_fetch_add_explicit(&task->group->pending, 1, memory_order_relaxed);
+	if (!rh_task_deq_push(&self->deq, task)) {
+		// Out of memory for the deque, so run it now instead
+		rh_task_run(self, task);
+		return;
+	}
+	rh_futex_signal(&self->pool->work, &self->pool->armed);
+}
+
+static inline void rh_task_spawn(rh_task_group *group, rh_task_fn *fn
+		, void *arg) {
+	rh_task_worker *self = rh_task_self;
+	rh_task *task;
+	if (!self || !(task = rh_pool_alloc(&self->free, malloc, sizeof(*task)))) {
+		fn(arg);
+		return;
+	}
+
+	*task = (rh_task) {
+		.group = group,
+		.arg = arg,
+		.fn = fn,
+	};
+	rh_task_push(self, task);
+}
+
+// Runs other tasks until every task spawned against group has finished
+static inline void rh_task_sync(rh_task_group *group) {
+	rh_task_worker *self = rh_task_self;
+	rh_task *task;
+	unsigned spins = 0;
+
+	while (atomic_load_explicit(&group->pending, memory_order_acquire)) {
+		if (self && rh_task_find(self, &task)) {
+			rh_task_run(self, task);
+			spins = 0;
+		} else if (++spins > RH_TASK_SPIN) {
+			sched_yield();
+		}
+	}
+}
+
+static inline void rh_task_run(rh_task_worker *self, rh_task *task) {
+	rh_task_group *group = task->group;
+
+	if (task->range) {
+		// Hand the upper halves to thieves, keep splitting the lower half
+		while (task->end - task->begin > task->grain) {
+			size_t mid = task->begin + (task->end - task->begin) / 2;
+			rh_task *half = rh_pool_alloc(&self->free, malloc
+					, sizeof(*half));
+			if (!half) {
+				break;
+			}
+			*half = *task;
+			half->begin = mid;
+			task->end = mid;
+			rh_task_push(self, half);
+		}
+		task->range(task->arg, task->begin, task->end);
+	} else {
+		task->fn(task->arg);
+	}
+
+	rh_pool_free_sized(&self->free, task, sizeof(*task));
+	atomic_fetch_sub_explicit(&group->pending, 1, memory_order_release);
+}
+
+// Calls fn over [begin, end) in pieces of at most grain, in parallel
+static inline void rh_task_parallel_for(size_t begin, size_t end, size_t grain
+		, rh_task_range_fn *fn, void *arg) {
+	rh_task_worker *self = rh_task_self;
+	rh_task *task;
+	if (!self || !(task = rh_pool_alloc(&self->free, malloc, sizeof(*task)))) {
+		fn(arg, begin, end);
+		return;
+	}
+
+	rh_task_group group = {0};
+	*task = (rh_task) {
+		.group = &group,
+		.arg = arg,
+		.range = fn,
+		.begin = begin,
+		.end = end,
+		.grain = grain?:1,
+	};
+	atomic_fetch_add_explicit(&group.pending, 1, memory_order_relaxed);
+	rh_task_run(self, task);
+	rh_task_sync(&group);
+}
+
+// Stops and joins worker threads 1 to started - 1 and frees the first
+// no_deqs workers' deques, then the pool
+static inline void rh_task_pool_stop(rh_task_pool *pool, size_t started
+		, size_t no_deqs) {
+	atomic_store(&pool->stop, 1);
+	atomic_fetch_add(&pool->work, 1);
+	rh_futex_wake(&pool->work, INT32_MAX);
+
+	for (size_t i = 1;i < started;++i) {
+		pthread_join(pool->threads[i], NULL);
+	}
+	for (size_t i = 0;i < no_deqs;++i) {
+		rh_task_deq_free(&pool->workers[i].deq);
+		rh_pool_freeall(&pool->workers[i].free, free);
+	}
+	if (rh_task_self && rh_task_self->pool == pool) {
+		rh_task_self = NULL;
+	}
+
+	free(pool->workers);
+	free(pool->threads);
+	*pool = (rh_task_pool) {0};
+}
+
+// no_workers of 0 uses one worker per online CPU
+// Returns 0, leaving nothing to free, if a deque or thread cannot be made
+static inline int rh_task_pool_init(rh_task_pool *pool, size_t no_workers) {
+	if (!no_workers) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		no_workers = cpus > 0 ? cpus : 1;
+	}
+
+	*pool = (rh_task_pool) {
+		.no_workers = no_workers,
+		.workers = aligned_alloc(_Alignof(rh_task_worker)
+				, no_workers * sizeof(rh_task_worker)),
+		.threads = calloc(no_workers, sizeof(pthread_t)),
+	};
+	if (!pool->workers || !pool->threads) {
+		free(pool->workers);
+		free(pool->threads);
+		*pool = (rh_task_pool) {0};
+		return 0;
+	}
+
+	for (size_t i = 0;i < no_workers;++i) {
+		rh_task_worker *w = &pool->workers[i];
+		w->free = NULL;
+		w->seed = 0x9E3779B97F4A7C15LU * (i + 1);
+		w->id = i;
+		w->pool = pool;
+		if (!rh_task_deq_init(&w->deq, 64)) {
+			rh_task_pool_stop(pool, 0, i);
+			return 0;
+		}
+	}
+
+	rh_task_self = &pool->workers[0];
+	for (size_t i = 1;i < no_workers;++i) {
+		if (pthread_create(&pool->threads[i], NULL, rh_task_worker_main
+				, &pool->workers[i])) {
+			rh_task_pool_stop(pool, i, no_workers);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// Must be called by the thread which initialised the pool, with no tasks left
+static inline void rh_task_pool_free(rh_task_pool *pool) {
+	rh_task_pool_stop(pool, pool->no_workers, pool->no_workers);
+}
+
+#endif
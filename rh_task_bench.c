@@ -0,0 +1,236 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_task.h"
+#include "rh_deq.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+#define FIB_N 30
+#define FIB_CUTOFF 12
+#define SUM_N (1 << 24)
+#define SUM_GRAIN 4096
+
+// Baseline: one deque shared by every thread behind a single lock
+RH_DEQ_MAKE(shared_deq, rh_task *);
+
+static struct {
+	pthread_mutex_t lock;
+	shared_deq deq;
+	pthread_t *threads;
+	size_t no_threads;
+	_Atomic int stop;
+} shared = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static int shared_take(rh_task **task) {
+	pthread_mutex_lock(&shared.lock);
+	int got = !shared_deq_empty(&shared.deq);
+	if (got) {
+		*task = shared_deq_pop(&shared.deq);
+	}
+	pthread_mutex_unlock(&shared.lock);
+	return got;
+}
+
+static void shared_run(rh_task *task) {
+	rh_task_group *group = task->group;
+	if (task->range) {
+		task->range(task->arg, task->begin, task->end);
+	} else {
+		task->fn(task->arg);
+	}
+	free(task);
+	atomic_fetch_sub(&group->pending, 1);
+}
+
+static void *shared_worker(void *arg) {
+	(void) arg;
+	rh_task *task;
+	while (!atomic_load(&shared.stop)) {
+		if (shared_take(&task)) {
+			shared_run(task);
+		} else {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static void shared_push(rh_task *task) {
+	atomic_fetch_add(&task->group->pending, 1);
+	pthread_mutex_lock(&shared.lock);
+	shared_deq_push(&shared.deq, task);
+	pthread_mutex_unlock(&shared.lock);
+}
+
+static void shared_spawn(rh_task_group *group, rh_task_fn *fn, void *arg) {
+	rh_task *task = malloc(sizeof(*task));
+	*task = (rh_task) { .group = group, .fn = fn, .arg = arg };
+	shared_push(task);
+}
+
+static void shared_sync(rh_task_group *group) {
+	rh_task *task;
+	while (atomic_load(&group->pending)) {
+		if (shared_take(&task)) {
+			shared_run(task);
+		} else {
+			sched_yield();
+		}
+	}
+}
+
+static void shared_parallel_for(size_t begin, size_t end, size_t grain
+		, rh_task_range_fn *fn, void *arg) {
+	rh_task_group group = {0};
+	for (size_t i = begin;i < end;i += grain) {
+		rh_task *task = malloc(sizeof(*task));
+		*task = (rh_task) {
+			.group = &group,
+			.range = fn,
+			.arg = arg,
+			.begin = i,
+			.end = i + grain < end ? i + grain : end,
+		};
+		shared_push(task);
+	}
+	shared_sync(&group);
+}
+
+static void shared_init(size_t no_threads) {
+	shared.deq = shared_deq_new(64);
+	shared.no_threads = no_threads;
+	shared.threads = calloc(no_threads, sizeof(pthread_t));
+	for (size_t i = 1;i < no_threads;++i) {
+		pthread_create(&shared.threads[i], NULL, shared_worker, NULL);
+	}
+}
+
+static void shared_stop(void) {
+	atomic_store(&shared.stop, 1);
+	for (size_t i = 1;i < shared.no_threads;++i) {
+		pthread_join(shared.threads[i], NULL);
+	}
+	free(shared.threads);
+	shared_deq_free(&shared.deq);
+}
+
+// Workloads, parameterised over spawn and sync
+
+typedef struct {
+	uint64_t n;
+	uint64_t result;
+} fib_arg;
+
+static uint64_t fib_serial(uint64_t n) {
+	return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+#define FIB(NAME, SPAWN, SYNC)							\
+static void NAME(void *arg) {							\
+	fib_arg *f = arg;							\
+	if (f->n < FIB_CUTOFF) {						\
+		f->result = fib_serial(f->n);					\
+		return;								\
+	}									\
+										\
+	rh_task_group group = {0};						\
+	fib_arg a = { .n = f->n - 1 }, b = { .n = f->n - 2 };			\
+	SPAWN(&group, NAME, &a);						\
+	NAME(&b);								\
+	SYNC(&group);								\
+	f->result = a.result + b.result;					\
+}
+
+FIB(fib_ws, rh_task_spawn, rh_task_sync)
+FIB(fib_shared, shared_spawn, shared_sync)
+
+static uint32_t *values;
+static _Atomic uint64_t total;
+
+static void sum_range(void *arg, size_t begin, size_t end) {
+	(void) arg;
+	uint64_t sum = 0;
+	for (size_t i = begin;i < end;++i) {
+		sum += values[i];
+	}
+	atomic_fetch_add_explicit(&total, sum, memory_order_relaxed);
+}
+
+// Optional argument overrides the thread count, defaulting to one per CPU
+int main(int argc, char **argv) {
+	long cpus = argc > 1 ? atol(argv[1]) : sysconf(_SC_NPROCESSORS_ONLN);
+	size_t no_threads = cpus > 0 ? cpus : 1;
+	uint64_t expected_fib = fib_serial(FIB_N);
+
+	values = malloc(SUM_N * sizeof(*values));
+	uint64_t expected_sum = 0;
+	for (size_t i = 0;i < SUM_N;++i) {
+		values[i] = i * 2654435761U;
+		expected_sum += values[i];
+	}
+
+	rh_task_pool pool;
+	rh_task_pool_init(&pool, no_threads);
+
+	fib_arg f = { .n = FIB_N };
+	uint64_t start = rh_bench_now();
+	fib_ws(&f);
+	rh_bench_report("work stealing fib", 1, rh_bench_now() - start);
+	if (f.result != expected_fib) {
+		fprintf(stderr, "work stealing fib wrong\n");
+	}
+
+	total = 0;
+	start = rh_bench_now();
+	rh_task_parallel_for(0, SUM_N, SUM_GRAIN, sum_range, NULL);
+	rh_bench_report("work stealing parallel_for", SUM_N, rh_bench_now() - start);
+	if (total != expected_sum) {
+		fprintf(stderr, "work stealing parallel_for wrong\n");
+	}
+
+	rh_task_pool_free(&pool);
+
+	shared_init(no_threads);
+
+	f = (fib_arg) { .n = FIB_N };
+	start = rh_bench_now();
+	fib_shared(&f);
+	rh_bench_report("shared queue fib", 1, rh_bench_now() - start);
+	if (f.result != expected_fib) {
+		fprintf(stderr, "shared queue fib wrong\n");
+	}
+
+	total = 0;
+	start = rh_bench_now();
+	shared_parallel_for(0, SUM_N, SUM_GRAIN, sum_range, NULL);
+	rh_bench_report("shared queue parallel_for", SUM_N, rh_bench_now() - start);
+	if (total != expected_sum) {
+		fprintf(stderr, "shared queue parallel_for wrong\n");
+	}
+
+	shared_stop();
+	free(values);
+
+	return 0;
+}
@@ -0,0 +1,148 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_task.h"
+#include <stdio.h>
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+#define WORKERS 4
+
+// Each node of a binary tree spawns one child and runs the other itself, so
+// every node must run exactly once before the root's sync returns
+#define DEPTH 14
+
+static _Atomic size_t nodes;
+
+static void tree(void *arg) {
+	size_t depth = (size_t) arg;
+	atomic_fetch_add(&nodes, 1);
+	if (!depth) {
+		return;
+	}
+
+	rh_task_group group = {0};
+	rh_task_spawn(&group, tree, (void *) (depth - 1));
+	tree((void *) (depth - 1));
+	rh_task_sync(&group);
+}
+
+int spawn_sync(void) {
+	rh_task_pool pool;
+	if (!rh_task_pool_init(&pool, WORKERS)) {
+		ERROR_MSG("Pool init test FAILED!");
+		return 1;
+	}
+
+	// Many tasks against one group, then nested groups
+	rh_task_group group = {0};
+	for (size_t i = 0;i < 1000;++i) {
+		rh_task_spawn(&group, tree, (void *) 0);
+	}
+	rh_task_sync(&group);
+	size_t flat = atomic_exchange(&nodes, 0);
+	tree((void *) DEPTH);
+	size_t nested = atomic_exchange(&nodes, 0);
+	rh_task_pool_free(&pool);
+
+	// Without a pool tasks run inline
+	rh_task_spawn(&group, tree, (void *) 2);
+	size_t inline_nodes = atomic_exchange(&nodes, 0);
+	if (flat != 1000 || nested != ((size_t) 2 << DEPTH) - 1
+	|| inline_nodes != 7 || group.pending) {
+		ERROR_MSG("Spawn sync test FAILED! %zu %zu %zu", flat, nested
+				, inline_nodes);
+		return 1;
+	}
+	return 0;
+}
+
+// Every index of each range must be visited exactly once, including ranges
+// which nest a parallel_for inside their pieces
+#define RANGE (1 << 18)
+
+static _Atomic unsigned char hits[RANGE];
+
+static void mark(void *arg, size_t begin, size_t end) {
+	(void) arg;
+	for (size_t i = begin;i < end;++i) {
+		atomic_fetch_add(&hits[i], 1);
+	}
+}
+
+static void mark_nested(void *arg, size_t begin, size_t end) {
+	for (size_t i = begin;i < end;i += 1024) {
+		size_t to = i + 1024 < end ? i + 1024 : end;
+		rh_task_parallel_for(i, to, 7, mark, arg);
+	}
+}
+
+static size_t check_hits(size_t begin, size_t end) {
+	size_t wrong = 0;
+	for (size_t i = 0;i < RANGE;++i) {
+		wrong += hits[i] != (i >= begin && i < end);
+		atomic_store(&hits[i], 0);
+	}
+	return wrong;
+}
+
+int parallel_for(void) {
+	rh_task_pool pool;
+	if (!rh_task_pool_init(&pool, WORKERS)) {
+		ERROR_MSG("Pool init test FAILED!");
+		return 1;
+	}
+
+	size_t wrong = 0;
+	rh_task_parallel_for(0, RANGE, 64, mark, NULL);
+	wrong += check_hits(0, RANGE);
+	// Grain of 0 means single items, and an odd sized offset range
+	rh_task_parallel_for(3, 4099, 0, mark, NULL);
+	wrong += check_hits(3, 4099);
+	rh_task_parallel_for(5, 5, 1, mark, NULL);
+	wrong += check_hits(0, 0);
+	rh_task_parallel_for(17, RANGE - 9, 4096, mark_nested, NULL);
+	wrong += check_hits(17, RANGE - 9);
+	rh_task_pool_free(&pool);
+
+	// Without a pool the whole range is called at once
+	rh_task_parallel_for(0, 100, 1, mark, NULL);
+	wrong += check_hits(0, 100);
+	if (wrong) {
+		ERROR_MSG("Parallel for test FAILED! %zu not hit once", wrong);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += spawn_sync();
+	no_errors += parallel_for();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
@@ -0,0 +1,270 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_TIMER_H
+#define RH_TIMER_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "rh_pool.h"
+
+// Hierarchical timing wheel
+// Level l has RH_TIMER_SLOTS slots each covering 2^(l * RH_TIMER_BITS) ticks;
+// a timer is placed in the lowest level whose range covers its deadline and
+// moved down a level (cascaded) when its slot comes around, so add, cancel
+// and reschedule are O(1) and each timer is moved at most once per level
+// Deadlines beyond the top level are parked in its furthest slot and placed
+// again each time it cascades
+// Time is in caller defined ticks, advancing a tick at a time; runs of empty
+// slots are skipped using a bitmap per level
+
+#define RH_TIMER_BITS 8
+#define RH_TIMER_SLOTS (1 << RH_TIMER_BITS)
+#define RH_TIMER_MASK (RH_TIMER_SLOTS - 1)
+#define RH_TIMER_LEVELS 5
+
+typedef struct rh_timer {
+	struct rh_timer *next;
+	struct rh_timer *prev;
+
+	uint64_t deadline;
+	void *data;
+} rh_timer;
+
+typedef void rh_timer_fn(void *data);
+
+typedef struct {
+	uint64_t now;
+	size_t count;
+	// Freed timers are kept for reuse
+	rh_mem_link *free;
+
+	// Set bits mark slots which may be non empty
+	uint64_t bits[RH_TIMER_LEVELS][RH_TIMER_SLOTS / 64];
+	// Sentinels of circular lists
+	rh_timer slots[RH_TIMER_LEVELS][RH_TIMER_SLOTS];
+} rh_timer_wheel;
+
+static inline void rh_timer_wheel_init(rh_timer_wheel *w, uint64_t now) {
+	w->now = now;
+	w->count = 0;
+	w->free = NULL;
+	for (size_t l = 0;l < RH_TIMER_LEVELS;++l) {
+		for (size_t i = 0;i < RH_TIMER_SLOTS / 64;++i) {
+			w->bits[l][i] = 0;
+		}
+		for (size_t s = 0;s < RH_TIMER_SLOTS;++s) {
+			rh_timer *sentinel = &w->slots[l][s];
+			*sentinel = (rh_timer) {sentinel, sentinel, 0, NULL};
+		}
+	}
+}
+
+// Frees all pending timers without calling them
+static inline void rh_timer_wheel_free(rh_timer_wheel *w) {
+	for (size_t l = 0;l < RH_TIMER_LEVELS;++l) {
+		for (size_t s = 0;s < RH_TIMER_SLOTS;++s) {
+			rh_timer *sentinel = &w->slots[l][s];
+			while (sentinel->next != sentinel) {
+				rh_timer *t = sentinel->next;
+				sentinel->next = t->next;
+				free(t);
+			}
+			sentinel->prev = sentinel;
+		}
+	}
+	rh_pool_freeall(&w->free, free);
+	w->count = 0;
+}
+
+static inline void rh_timer_unlink(rh_timer *t) {
+	t->prev->next = t->next;
+	t->next->prev = t->prev;
+}
+
+// Links t into the slot for its deadline, where first is the earliest tick
+// which has not yet fired
+static inline void rh_timer_link(rh_timer_wheel *w, rh_timer *t, uint64_t first) {
+	uint64_t deadline = t->deadline;
+	if (deadline < first) {
+		// Already expired, fires on the next tick
+		deadline = first;
+	}
+
+	uint64_t delta = deadline - first;
+	size_t l = 0;
+	while (l < RH_TIMER_LEVELS - 1
+	&& delta >= (uint64_t) 1 << ((l + 1) * RH_TIMER_BITS)) {
+		++l;
+	}
+	if (delta >= (uint64_t) 1 << (RH_TIMER_LEVELS * RH_TIMER_BITS)) {
+		deadline = first
+			+ ((uint64_t) 1 << (RH_TIMER_LEVELS * RH_TIMER_BITS)) - 1;
+	}
+
+	size_t s = (deadline >> (l * RH_TIMER_BITS)) & RH_TIMER_MASK;
+	rh_timer *sentinel = &w->slots[l][s];
+	t->next = sentinel;
+	t->prev = sentinel->prev;
+	sentinel->prev->next = t;
+	sentinel->prev = t;
+	w->bits[l][s / 64] |= (uint64_t) 1 << (s % 64);
+}
+
+// Returns NULL if a timer could not be allocated
+static inline rh_timer *rh_timer_add(rh_timer_wheel *w, uint64_t deadline, void *data) {
+	rh_timer *t = rh_pool_alloc(&w->free, malloc, sizeof(rh_timer));
+	if (!t) {
+		return NULL;
+	}
+
+	t->deadline = deadline;
+	t->data = data;
+	rh_timer_link(w, t, w->now + 1);
+	++w->count;
+	return t;
+}
+
+// t must be pending, i.e. added and not yet fired or cancelled
+static inline void rh_timer_cancel(rh_timer_wheel *w, rh_timer *t) {
+	rh_timer_unlink(t);
+	rh_pool_free_sized(&w->free, t, sizeof(*t));
+	--w->count;
+}
+
+static inline void rh_timer_reschedule(rh_timer_wheel *w, rh_timer *t, uint64_t deadline) {
+	rh_timer_unlink(t);
+	t->deadline = deadline;
+	rh_timer_link(w, t, w->now + 1);
+}
+
+// The first slot from s in a level which may be non empty, or RH_TIMER_SLOTS
+static inline size_t rh_timer_next_slot(const uint64_t *bits, size_t s) {
+	if (s >= RH_TIMER_SLOTS) {
+		return RH_TIMER_SLOTS;
+	}
+
+	uint64_t word = bits[s / 64] >> (s % 64);
+	if (word) {
+		return s + __builtin_ctzll(word);
+	}
+	for (size_t i = s / 64 + 1;i < RH_TIMER_SLOTS / 64;++i) {
+		if (bits[i]) {
+			return i * 64 + __builtin_ctzll(bits[i]);
+		}
+	}
+	return RH_TIMER_SLOTS;
+}
+
+// The last tick from t which has nothing to fire or cascade, or t - 1
+// Ticks on a slot boundary may cascade, so are never skipped
+static inline uint64_t rh_timer_skip(rh_timer_wheel *w, uint64_t t) {
+	uint64_t end = t - 1;
+	if (!(t & RH_TIMER_MASK)) {
+		return end;
+	}
+
+	for (size_t l = 0;l < RH_TIMER_LEVELS;++l) {
+		size_t shift = l * RH_TIMER_BITS;
+		uint64_t rotation = ((uint64_t) 1 << (shift + RH_TIMER_BITS)) - 1;
+		// Higher levels' current slots have already been cascaded
+		size_t s = ((t >> shift) & RH_TIMER_MASK) + !!l;
+		size_t next = rh_timer_next_slot(w->bits[l], s);
+		end = (t & ~rotation) + ((uint64_t) next << shift) - 1;
+
+		// Going up a level skips whole rotations of this one
+		if (next < RH_TIMER_SLOTS || rh_timer_next_slot(w->bits[l], 0) < s) {
+			break;
+		}
+	}
+	return end;
+}
+
+// Re-links the timers of a slot at the start of tick t, now they are nearer
+static inline void rh_timer_cascade(rh_timer_wheel *w, uint64_t t, size_t l) {
+	size_t s = (t >> (l * RH_TIMER_BITS)) & RH_TIMER_MASK;
+	rh_timer *sentinel = &w->slots[l][s];
+	rh_timer *timer = sentinel->next;
+	*sentinel = (rh_timer) {sentinel, sentinel, 0, NULL};
+	w->bits[l][s / 64] &= ~((uint64_t) 1 << (s % 64));
+
+	while (timer != sentinel) {
+		rh_timer *next = timer->next;
+		rh_timer_link(w, timer, t);
+		timer = next;
+	}
+}
+
+// Advances the wheel to now, calling fn with the data of each timer which
+// expires, in deadline order; fn may add, cancel or reschedule other timers
+// Returns the number of timers fired
+static inline size_t rh_timer_advance(rh_timer_wheel *w, uint64_t now, rh_timer_fn *fn) {
+	size_t fired = 0;
+	while (w->now < now) {
+		if (!w->count) {
+			w->now = now;
+			break;
+		}
+
+		uint64_t t = w->now + 1;
+		uint64_t skip = rh_timer_skip(w, t);
+		if (skip >= t) {
+			w->now = skip < now ? skip : now;
+			continue;
+		}
+
+		w->now = t;
+		for (size_t l = RH_TIMER_LEVELS - 1;l > 0;--l) {
+			if (!(t & (((uint64_t) 1 << (l * RH_TIMER_BITS)) - 1))) {
+				rh_timer_cascade(w, t, l);
+			}
+		}
+
+		// Detach the slot before firing, as timers fn adds a whole
+		// rotation ahead land back in it and must wait for that rotation
+		// Its timers stay pending on the local list, so fn may still
+		// cancel or reschedule them
+		size_t s = t & RH_TIMER_MASK;
+		rh_timer *sentinel = &w->slots[0][s];
+		rh_timer due = {&due, &due, 0, NULL};
+		if (sentinel->next != sentinel) {
+			due.next = sentinel->next;
+			due.prev = sentinel->prev;
+			due.next->prev = &due;
+			due.prev->next = &due;
+			*sentinel = (rh_timer) {sentinel, sentinel, 0, NULL};
+		}
+		w->bits[0][s / 64] &= ~((uint64_t) 1 << (s % 64));
+
+		while (due.next != &due) {
+			rh_timer *timer = due.next;
+			void *data = timer->data;
+			rh_timer_cancel(w, timer);
+			fn(data);
+			++fired;
+		}
+	}
+	return fired;
+}
+
+#endif
@@ -0,0 +1,184 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_timer.h"
+#include "rh_heap.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+// Connection timeouts: each of CONNS connections rearms its timeout on
+// activity, cancelling the previous one 95% of the time and otherwise
+// leaving it to fire; time advances a tick every TICK_OPS operations
+// A connection comes round again well within TIMEOUT, so its last timer is
+// always still pending
+#define OPS (1 << 23)
+#define CONNS (1 << 20)
+#define TICK_OPS 64
+#define TIMEOUT 30000
+
+typedef struct {
+	uint64_t deadline;
+	size_t id;
+} timeout;
+
+#define CMP_TIMEOUT(A, B) (((A).deadline > (B).deadline)			\
+		- ((A).deadline < (B).deadline))
+#define CMP_U64(A, B) (((A) > (B)) - ((A) < (B)))
+
+RH_HEAP_MAKE(lazy_heap, timeout, CMP_TIMEOUT);
+RH_IHEAP_MAKE(timeout_heap, uint64_t, CMP_U64);
+
+static size_t no_fired;
+
+static void fire(void *data) {
+	rh_bench_use((uintptr_t) data);
+	++no_fired;
+}
+
+static int cancels(uint64_t *seed) {
+	return rh_bench_rand(seed) % 100 < 95;
+}
+
+static void bench_wheel(void) {
+	static rh_timer_wheel w;
+	rh_timer **conns = calloc(CONNS, sizeof(*conns));
+	uint64_t seed = 9;
+	no_fired = 0;
+
+	rh_timer_wheel_init(&w, 0);
+	uint64_t start = rh_bench_now();
+	for (size_t i = 0;i < OPS;++i) {
+		size_t c = i % CONNS;
+		if (conns[c] && cancels(&seed)) {
+			rh_timer_cancel(&w, conns[c]);
+		}
+		conns[c] = rh_timer_add(&w, w.now + TIMEOUT, (void *) i);
+		if (!((i + 1) % TICK_OPS)) {
+			rh_timer_advance(&w, w.now + 1, fire);
+		}
+	}
+	rh_timer_advance(&w, UINT64_MAX, fire);
+	uint64_t end = rh_bench_now();
+
+	rh_bench_report("timer wheel", OPS, end - start);
+	printf("%-40s %12zu fired\n", "timer wheel", no_fired);
+	rh_timer_wheel_free(&w);
+	free(conns);
+}
+
+static void bench_iheap(void) {
+	timeout_heap hp = timeout_heap_new(CONNS);
+	timeout_heap_reserve_handles(&hp, OPS);
+	size_t *conns = malloc(CONNS * sizeof(*conns));
+	uint64_t seed = 9;
+	uint64_t now = 0;
+	no_fired = 0;
+
+	for (size_t i = 0;i < CONNS;++i) {
+		conns[i] = RH_IHEAP_NONE;
+	}
+
+	uint64_t start = rh_bench_now();
+	for (size_t i = 0;i < OPS;++i) {
+		size_t c = i % CONNS;
+		if (conns[c] != RH_IHEAP_NONE && cancels(&seed)) {
+			timeout_heap_remove(&hp, conns[c]);
+		}
+		timeout_heap_ins(&hp, i, now + TIMEOUT);
+		conns[c] = i;
+		if (!((i + 1) % TICK_OPS)) {
+			++now;
+			while (hp.top && timeout_heap_peek(&hp) <= now) {
+				size_t id;
+				timeout_heap_rem(&hp, &id);
+				fire((void *) id);
+			}
+		}
+	}
+	while (hp.top) {
+		size_t id;
+		timeout_heap_rem(&hp, &id);
+		fire((void *) id);
+	}
+	uint64_t end = rh_bench_now();
+
+	rh_bench_report("indexed heap", OPS, end - start);
+	printf("%-40s %12zu fired\n", "indexed heap", no_fired);
+	timeout_heap_free(&hp);
+	free(conns);
+}
+
+// Cancelled timers stay in the heap, skipped when they reach the top
+static void bench_lazy(void) {
+	lazy_heap hp = lazy_heap_new(CONNS);
+	unsigned char *cancelled = calloc(OPS, 1);
+	size_t *conns = malloc(CONNS * sizeof(*conns));
+	uint64_t seed = 9;
+	uint64_t now = 0;
+	size_t peak = 0;
+	no_fired = 0;
+
+	for (size_t i = 0;i < CONNS;++i) {
+		conns[i] = RH_IHEAP_NONE;
+	}
+
+	uint64_t start = rh_bench_now();
+	for (size_t i = 0;i < OPS;++i) {
+		size_t c = i % CONNS;
+		if (conns[c] != RH_IHEAP_NONE && cancels(&seed)) {
+			cancelled[conns[c]] = 1;
+		}
+		lazy_heap_ins(&hp, (timeout) {now + TIMEOUT, i});
+		conns[c] = i;
+		if (!((i + 1) % TICK_OPS)) {
+			++now;
+			while (hp.top && lazy_heap_peek(&hp).deadline <= now) {
+				timeout t = lazy_heap_rem(&hp);
+				if (!cancelled[t.id]) {
+					fire((void *) t.id);
+				}
+			}
+		}
+		peak = hp.top > peak ? hp.top : peak;
+	}
+	while (hp.top) {
+		timeout t = lazy_heap_rem(&hp);
+		if (!cancelled[t.id]) {
+			fire((void *) t.id);
+		}
+	}
+	uint64_t end = rh_bench_now();
+
+	rh_bench_report("lazy heap", OPS, end - start);
+	printf("%-40s %12zu fired %zu peak\n", "lazy heap", no_fired, peak);
+	lazy_heap_free(&hp);
+	free(cancelled);
+	free(conns);
+}
+
+int main(void) {
+	bench_wheel();
+	bench_iheap();
+	bench_lazy();
+	return 0;
+}
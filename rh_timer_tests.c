@@ -0,0 +1,208 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_timer.h"
+#include <stdio.h>
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+static rh_timer_wheel wheel;
+
+// Records the wheel's time when each test timer fires
+#define NO_TIMERS 4096
+static uint64_t fired_at[NO_TIMERS];
+static size_t no_fired;
+
+static void record(void *data) {
+	fired_at[(size_t) data] = wheel.now;
+	++no_fired;
+}
+
+int fire_in_order(void) {
+	rh_timer_wheel_init(&wheel, 0);
+	no_fired = 0;
+	rh_timer_add(&wheel, 300, (void *) 2);
+	rh_timer_add(&wheel, 5, (void *) 0);
+	rh_timer_add(&wheel, 70000, (void *) 3);
+	rh_timer_add(&wheel, 255, (void *) 1);
+	if (rh_timer_advance(&wheel, 299, record) != 2 || fired_at[0] != 5
+	|| fired_at[1] != 255 || wheel.count != 2) {
+		ERROR_MSG("Fire in order test FAILED!");
+		return 1;
+	}
+	if (rh_timer_advance(&wheel, 100000, record) != 2 || fired_at[2] != 300
+	|| fired_at[3] != 70000 || wheel.now != 100000) {
+		ERROR_MSG("Fire in order cascade test FAILED!");
+		return 1;
+	}
+
+	rh_timer_wheel_free(&wheel);
+	return 0;
+}
+
+int cancel_reschedule(void) {
+	rh_timer_wheel_init(&wheel, 1000);
+	no_fired = 0;
+	rh_timer *a = rh_timer_add(&wheel, 2000, (void *) 0);
+	rh_timer *b = rh_timer_add(&wheel, 3000, (void *) 1);
+	rh_timer_add(&wheel, 10, (void *) 2);
+	rh_timer_cancel(&wheel, a);
+	rh_timer_reschedule(&wheel, b, 1500);
+	if (rh_timer_advance(&wheel, 5000, record) != 2 || fired_at[2] != 1001
+	|| fired_at[1] != 1500 || wheel.count) {
+		ERROR_MSG("Cancel reschedule test FAILED!");
+		return 1;
+	}
+
+	rh_timer_wheel_free(&wheel);
+	return 0;
+}
+
+// Timers added or rescheduled from a callback a whole rotation ahead land in
+// the slot being fired, and must wait for that rotation
+#define REARMS 4
+static uint64_t rearmed_at[REARMS];
+static size_t no_rearmed;
+static rh_timer *other;
+
+static void rearm(void *data) {
+	if (data) {
+		fired_at[0] = wheel.now;
+		++no_fired;
+		return;
+	}
+
+	rearmed_at[no_rearmed++] = wheel.now;
+	if (no_rearmed < REARMS) {
+		rh_timer_add(&wheel, wheel.now + RH_TIMER_SLOTS, NULL);
+	}
+	if (no_rearmed == 1) {
+		rh_timer_reschedule(&wheel, other, wheel.now + RH_TIMER_SLOTS);
+	}
+}
+
+int callback_rearm(void) {
+	rh_timer_wheel_init(&wheel, 0);
+	no_fired = 0;
+	no_rearmed = 0;
+	rh_timer_add(&wheel, 10, NULL);
+	other = rh_timer_add(&wheel, 10, (void *) 1);
+	if (rh_timer_advance(&wheel, 10, rearm) != 1 || no_rearmed != 1
+	|| no_fired || wheel.count != 2) {
+		ERROR_MSG("Callback rearm same tick test FAILED!");
+		return 1;
+	}
+	if (rh_timer_advance(&wheel, 10000, rearm) != REARMS
+	|| no_fired != 1 || fired_at[0] != 10 + RH_TIMER_SLOTS
+	|| wheel.count) {
+		ERROR_MSG("Callback rearm test FAILED!");
+		return 1;
+	}
+	for (size_t i = 0;i < REARMS;++i) {
+		if (rearmed_at[i] != 10 + i * RH_TIMER_SLOTS) {
+			ERROR_MSG("Callback rearm %zu fired at %lu FAILED!", i
+					, rearmed_at[i]);
+			return 1;
+		}
+	}
+
+	rh_timer_wheel_free(&wheel);
+	return 0;
+}
+
+// Random operations against the expected firing time of each timer
+int random_ops(void) {
+	static rh_timer *timers[NO_TIMERS];
+	static uint64_t expect[NO_TIMERS];
+	uint64_t seed = 88172645463325252LU;
+	size_t pending = 0;
+
+	rh_timer_wheel_init(&wheel, 12345);
+	no_fired = 0;
+	for (size_t i = 0;i < NO_TIMERS;++i) {
+		fired_at[i] = 0;
+		timers[i] = NULL;
+	}
+
+	for (size_t i = 0;i < NO_TIMERS;++i) {
+		seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+		// Deadlines from the past to beyond the top level
+		uint64_t deadline = wheel.now + (seed % 4 == 3
+			? seed >> (14 + seed % 50) : seed % 100000) - 50;
+		timers[i] = rh_timer_add(&wheel, deadline, (void *) i);
+		expect[i] = deadline > wheel.now ? deadline : wheel.now + 1;
+		++pending;
+
+		size_t j = (seed >> 8) % (i + 1);
+		if (timers[j] && !fired_at[j] && expect[j] > wheel.now) {
+			if (seed & 0x10000) {
+				rh_timer_cancel(&wheel, timers[j]);
+				timers[j] = NULL;
+				--pending;
+			} else {
+				deadline = wheel.now + (seed >> 20) % 5000;
+				rh_timer_reschedule(&wheel, timers[j], deadline);
+				expect[j] = deadline > wheel.now ? deadline : wheel.now + 1;
+			}
+		}
+
+		size_t before = no_fired;
+		uint64_t to = wheel.now + (seed % 16 ? (seed >> 32) % 600 : seed >> 30);
+		size_t fired = rh_timer_advance(&wheel, to, record);
+		if (fired != no_fired - before) {
+			ERROR_MSG("Random ops fired count test FAILED!");
+			return 1;
+		}
+		pending -= fired;
+		if (wheel.count != pending || wheel.now != to) {
+			ERROR_MSG("Random ops count test FAILED!");
+			return 1;
+		}
+	}
+
+	rh_timer_advance(&wheel, UINT64_MAX, record);
+	for (size_t i = 0;i < NO_TIMERS;++i) {
+		if (timers[i] && fired_at[i] != expect[i]) {
+			ERROR_MSG("Random ops timer %zu fired at %lu not %lu FAILED!"
+					, i, fired_at[i], expect[i]);
+			return 1;
+		}
+	}
+
+	rh_timer_wheel_free(&wheel);
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += fire_in_order();
+	no_errors += cancel_reschedule();
+	no_errors += callback_rearm();
+	no_errors += random_ops();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}
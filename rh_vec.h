@@ -23,6 +23,10 @@
 #define RH_VEC_H
 
 #include "math.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "rh_simd.h"
 
 #define RH_IMPL_SIZED_VEC(NAME, SIZE, TYPE)					\
 static inline NAME NAME##_add(const NAME a, const NAME b) {			\
@@ -55,6 +59,10 @@ static inline NAME NAME##_scale(const NAME a, const TYPE factor) {		\
 	return b;								\
 }										\
 static inline TYPE NAME##_dot(const NAME a, const NAME b) {			\
+	if (RH_SIMD_4(SIZE, TYPE)) {						\
+		return RH_SIMD_FN(TYPE, dot4)((const void *) a.array		\
+				, (const void *) b.array);			\
+	}									\
 	TYPE dot = 0;								\
 	for (int i = 0;i < SIZE;++i) {						\
 		dot += a.array[i] * b.array[i];				\
@@ -69,8 +77,13 @@ static inline TYPE NAME##_sum(const NAME a) {					\
 	return sum;								\
 }										\
 static inline NAME NAME##_norm(const NAME a) {					\
-	TYPE len = sqrt(NAME##_dot(a, a));					\
 	NAME ret;								\
+	if (RH_SIMD_4(SIZE, TYPE)) {						\
+		RH_SIMD_FN(TYPE, norm4)((void *) ret.array			\
+				, (const void *) a.array);			\
+		return ret;							\
+	}									\
+	TYPE len = sqrt(NAME##_dot(a, a));					\
 	for (int i = 0;i < SIZE;++i) {						\
 		ret.array[i] = a.array[i] / len;				\
 	}									\
@@ -85,6 +98,364 @@ static inline NAME NAME##_cross(const NAME a, const NAME b) {			\
 	return (NAME){{x, y, z}};						\
 }										\
 
+// The cross product of the xyz parts, with w = 0, and a normalise which may
+// trade a few ulp for speed (an approximate reciprocal square root for float)
+#define RH_IMPL_4_VEC(NAME, TYPE)						\
+static inline NAME NAME##_cross(const NAME a, const NAME b) {			\
+	NAME c;									\
+	if (RH_SIMD_4(4, TYPE)) {						\
+		RH_SIMD_FN(TYPE, cross4)((void *) c.array			\
+				, (const void *) a.array, (const void *) b.array);\
+		return c;							\
+	}									\
+	c.x = a.y*b.z - a.z*b.y;						\
+	c.y = a.z*b.x - a.x*b.z;						\
+	c.z = a.x*b.y - a.y*b.x;						\
+	c.w = 0;								\
+	return c;								\
+}										\
+static inline NAME NAME##_norm_fast(const NAME a) {				\
+	if (RH_SIMD_4(4, TYPE)) {						\
+		NAME ret;							\
+		RH_SIMD_FN(TYPE, norm_fast4)((void *) ret.array			\
+				, (const void *) a.array);			\
+		return ret;							\
+	}									\
+	return NAME##_norm(a);							\
+}										\
+
+// Quaternions x i + y j + z k + w, stored x, y, z, w like v4 so vec3 is the
+// vector part; rotations are by unit quaternions, and a * b rotates by b
+// then by a
+#define RH_IMPL_QUAT(NAME, VEC, TYPE)						\
+static inline NAME NAME##_identity(void) {					\
+	return (NAME) {{0, 0, 0, 1}};						\
+}										\
+/* The rotation by angle radians about the unit vector axis */			\
+static inline NAME NAME##_axis_angle(const VEC axis, const TYPE angle) {	\
+	TYPE s = sin(angle / 2);						\
+	return (NAME) {{axis.x * s, axis.y * s, axis.z * s, cos(angle / 2)}};	\
+}										\
+static inline NAME NAME##_mul(const NAME a, const NAME b) {			\
+	return (NAME) {{							\
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,			\
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,			\
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,			\
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,			\
+	}};									\
+}										\
+static inline NAME NAME##_conj(const NAME a) {					\
+	return (NAME) {{-a.x, -a.y, -a.z, a.w}};				\
+}										\
+static inline TYPE NAME##_dot(const NAME a, const NAME b) {			\
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;			\
+}										\
+static inline NAME NAME##_norm(const NAME a) {					\
+	TYPE len = sqrt(NAME##_dot(a, a));					\
+	return (NAME) {{a.x / len, a.y / len, a.z / len, a.w / len}};		\
+}										\
+static inline NAME NAME##_inv(const NAME a) {					\
+	TYPE len2 = NAME##_dot(a, a);						\
+	return (NAME) {{-a.x / len2, -a.y / len2, -a.z / len2, a.w / len2}};	\
+}										\
+/* v + w t + u x t, where u is the vector part and t = 2 u x v */		\
+static inline VEC NAME##_rotate(const NAME q, const VEC v) {			\
+	TYPE tx = 2 * (q.y * v.z - q.z * v.y);					\
+	TYPE ty = 2 * (q.z * v.x - q.x * v.z);					\
+	TYPE tz = 2 * (q.x * v.y - q.y * v.x);					\
+	return (VEC) {{								\
+		v.x + q.w * tx + (q.y * tz - q.z * ty),				\
+		v.y + q.w * ty + (q.z * tx - q.x * tz),				\
+		v.z + q.w * tz + (q.x * ty - q.y * tx),				\
+	}};									\
+}										\
+/* Both interpolate along the shorter arc, as q and -q are one rotation */	\
+static inline NAME NAME##_nlerp(const NAME a, const NAME b, const TYPE t) {	\
+	TYPE s = NAME##_dot(a, b) < 0 ? -1 : 1;					\
+	NAME c;									\
+	for (int i = 0;i < 4;++i) {						\
+		c.array[i] = a.array[i] + (s * b.array[i] - a.array[i]) * t;	\
+	}									\
+	return NAME##_norm(c);							\
+}										\
+static inline NAME NAME##_slerp(const NAME a, const NAME b, const TYPE t) {	\
+	TYPE d = NAME##_dot(a, b);						\
+	TYPE s = d < 0 ? -1 : 1;						\
+	TYPE theta = d * s < 1 ? acos(d * s) : 0, st = sin(theta);		\
+	/* Too close for sin theta to divide by, where lerp is as good */	\
+	if (st < (TYPE) 1e-6) {							\
+		return NAME##_nlerp(a, b, t);					\
+	}									\
+										\
+	TYPE wa = sin((1 - t) * theta) / st, wb = sin(t * theta) / st * s;	\
+	NAME c;									\
+	for (int i = 0;i < 4;++i) {						\
+		c.array[i] = wa * a.array[i] + wb * b.array[i];			\
+	}									\
+	return c;								\
+}										\
+
+// Structure of arrays batches, one array per component, so that the span
+// kernels in rh_simd.h work on many vectors per instruction
+// The component arrays share one allocation and each starts
+// RH_VEC_BATCH_ALIGN aligned, as the size is rounded up to keep them so
+#ifndef RH_VEC_BATCH_ALIGN
+#define RH_VEC_BATCH_ALIGN 64
+#endif
+
+#define RH_VEC_BATCH_DEF(TYPE)							\
+typedef struct {								\
+	size_t count, size;							\
+	union {									\
+		TYPE *array[2];							\
+		struct {							\
+			TYPE *x, *y;						\
+		};								\
+	};									\
+} v2##TYPE##_batch;								\
+										\
+typedef struct {								\
+	size_t count, size;							\
+	union {									\
+		TYPE *array[3];							\
+		struct {							\
+			TYPE *x, *y, *z;					\
+		};								\
+	};									\
+} v3##TYPE##_batch;								\
+										\
+typedef struct {								\
+	size_t count, size;							\
+	union {									\
+		TYPE *array[4];							\
+		struct {							\
+			TYPE *x, *y, *z, *w;					\
+		};								\
+	};									\
+} v4##TYPE##_batch;								\
+										\
+typedef struct {								\
+	size_t count, size;							\
+	union {									\
+		TYPE *array[4];							\
+		struct {							\
+			TYPE *x, *y, *z, *w;					\
+		};								\
+	};									\
+} q##TYPE##_batch;
+
+// Kernels write to a batch that is grown to fit if needed, returning 0 only
+// if that fails; outputs may be inputs, and a second input must hold at least
+// as many vectors as the first
+#define RH_IMPL_SIZED_VEC_BATCH(NAME, VEC, SIZE, TYPE)				\
+static inline int NAME##_resize(NAME *b, size_t size) {				\
+	size_t per = RH_VEC_BATCH_ALIGN / sizeof(TYPE) ?: 1;			\
+	size = ((size ?: 1) + per - 1) / per * per;				\
+	if (size < b->count) {							\
+		return 0;							\
+	}									\
+										\
+	TYPE *mem = aligned_alloc(RH_VEC_BATCH_ALIGN				\
+			, SIZE * size * sizeof(TYPE));				\
+	if (!mem) {								\
+		return 0;							\
+	}									\
+	for (int k = 0;k < SIZE;++k) {						\
+		if (b->count) {							\
+			memcpy(mem + k * size, b->array[k]			\
+					, b->count * sizeof(TYPE));		\
+		}								\
+	}									\
+	free(b->array[0]);							\
+	for (int k = 0;k < SIZE;++k) {						\
+		b->array[k] = mem + k * size;					\
+	}									\
+	b->size = size;								\
+	return 1;								\
+}										\
+										\
+static inline NAME NAME##_new(size_t size) {					\
+	NAME ret = {0};								\
+	NAME##_resize(&ret, size);						\
+	return ret;								\
+}										\
+										\
+static inline void NAME##_free(NAME *b) {					\
+	free(b->array[0]);							\
+}										\
+										\
+static inline int NAME##_push(NAME *b, const VEC v) {				\
+	if (b->count == b->size && !NAME##_resize(b, (b->size ?: 8) * 2)) {	\
+		return 0;							\
+	}									\
+										\
+	for (int k = 0;k < SIZE;++k) {						\
+		b->array[k][b->count] = v.array[k];				\
+	}									\
+	++b->count;								\
+	return 1;								\
+}										\
+										\
+static inline VEC NAME##_get(const NAME *b, size_t i) {				\
+	VEC v = {0};								\
+	if (i >= b->count) {							\
+		return v;							\
+	}									\
+										\
+	for (int k = 0;k < SIZE;++k) {						\
+		v.array[k] = b->array[k][i];					\
+	}									\
+	return v;								\
+}										\
+										\
+static inline NAME NAME##_from(const VEC *v, size_t n) {			\
+	NAME ret = NAME##_new(n);						\
+	if (!ret.size) {							\
+		return ret;							\
+	}									\
+										\
+	for (size_t i = 0;i < n;++i) {						\
+		for (int k = 0;k < SIZE;++k) {					\
+			ret.array[k][i] = v[i].array[k];			\
+		}								\
+	}									\
+	ret.count = n;								\
+	return ret;								\
+}										\
+										\
+static inline void NAME##_to(const NAME *b, VEC *v) {				\
+	for (size_t i = 0;i < b->count;++i) {					\
+		for (int k = 0;k < SIZE;++k) {					\
+			v[i].array[k] = b->array[k][i];				\
+		}								\
+	}									\
+}										\
+										\
+static inline int NAME##_fit(NAME *b, size_t count) {				\
+	if (b->size < count && !NAME##_resize(b, count)) {			\
+		return 0;							\
+	}									\
+	b->count = count;							\
+	return 1;								\
+}										\
+										\
+static inline int NAME##_add(NAME *c, const NAME *a, const NAME *b) {		\
+	size_t n = a->count;							\
+	if (!NAME##_fit(c, n)) {						\
+		return 0;							\
+	}									\
+	for (int k = 0;k < SIZE;++k) {						\
+		RH_SIMD_SPAN_FN(TYPE, add_n)(c->array[k], a->array[k]		\
+				, b->array[k], 0, n);				\
+	}									\
+	return 1;								\
+}										\
+										\
+static inline int NAME##_scale(NAME *c, const NAME *a, const TYPE factor) {	\
+	size_t n = a->count;							\
+	if (!NAME##_fit(c, n)) {						\
+		return 0;							\
+	}									\
+	for (int k = 0;k < SIZE;++k) {						\
+		RH_SIMD_SPAN_FN(TYPE, scale_n)(c->array[k], a->array[k]		\
+				, factor, 0, n);				\
+	}									\
+	return 1;								\
+}										\
+										\
+/* out must hold a->count values */						\
+static inline void NAME##_dot(TYPE *out, const NAME *a, const NAME *b) {	\
+	RH_SIMD_SPAN_FN(TYPE, dot_n)(out, (const void *) a->array		\
+			, (const void *) b->array, SIZE, 0, a->count);		\
+}										\
+										\
+static inline int NAME##_norm(NAME *c, const NAME *a) {				\
+	size_t n = a->count;							\
+	if (!NAME##_fit(c, n)) {						\
+		return 0;							\
+	}									\
+	RH_SIMD_SPAN_FN(TYPE, norm_n)(c->array, (const void *) a->array		\
+			, SIZE, 0, n);						\
+	return 1;								\
+}										\
+										\
+/* The componentwise minimum and maximum, returning 0 if a is empty */		\
+static inline int NAME##_bounds(const NAME *a, VEC *min, VEC *max) {		\
+	if (!a->count) {							\
+		return 0;							\
+	}									\
+										\
+	*min = *max = NAME##_get(a, 0);						\
+	for (int k = 0;k < SIZE;++k) {						\
+		RH_SIMD_SPAN_FN(TYPE, bounds_n)(a->array[k], &min->array[k]	\
+				, &max->array[k], 1, a->count);			\
+	}									\
+	return 1;								\
+}										\
+
+// The cross product of the xyz parts, with w = 0 for 4 components
+#define RH_IMPL_3_VEC_BATCH(NAME, SIZE, TYPE)					\
+static inline int NAME##_cross(NAME *c, const NAME *a, const NAME *b) {		\
+	size_t n = a->count;							\
+	if (!NAME##_fit(c, n)) {						\
+		return 0;							\
+	}									\
+	RH_SIMD_SPAN_FN(TYPE, cross_n)(c->array, (const void *) a->array	\
+			, (const void *) b->array, 0, n);			\
+	if (SIZE == 4) {							\
+		memset(c->array[SIZE - 1], 0, n * sizeof(TYPE));		\
+	}									\
+	return 1;								\
+}										\
+
+#define RH_IMPL_QUAT_BATCH(NAME, VEC, TYPE)					\
+static inline int NAME##_mul(NAME *c, const NAME *a, const NAME *b) {		\
+	size_t n = a->count;							\
+	if (!NAME##_fit(c, n)) {						\
+		return 0;							\
+	}									\
+	RH_SIMD_SPAN_FN(TYPE, qmul_n)(c->array, (const void *) a->array		\
+			, (const void *) b->array, 0, n);			\
+	return 1;								\
+}										\
+										\
+/* Rotates each vector of v by the matching quaternion of q */			\
+static inline int NAME##_rotate(VEC *c, const NAME *q, const VEC *v) {		\
+	size_t n = q->count;							\
+	if (!VEC##_fit(c, n)) {							\
+		return 0;							\
+	}									\
+	RH_SIMD_SPAN_FN(TYPE, qrotate_n)(c->array, (const void *) q->array	\
+			, (const void *) v->array, 0, n);			\
+	return 1;								\
+}										\
+										\
+/* Slerps from a[i] to b[i] by t[i], which must hold a->count values */		\
+/* Within a few ulp of _slerp for float, but 3e-8 for double, as the */		\
+/* lanes use a polynomial for sin rather than the library's */			\
+static inline int NAME##_slerp(NAME *c, const NAME *a, const NAME *b		\
+		, const TYPE *t) {						\
+	size_t n = a->count;							\
+	if (!NAME##_fit(c, n)) {						\
+		return 0;							\
+	}									\
+	RH_SIMD_SPAN_FN(TYPE, slerp_n)(c->array, (const void *) a->array	\
+			, (const void *) b->array, t, 0, n);			\
+	return 1;								\
+}										\
+
+// Scalar span kernels are generated for every type, though float and double
+// use the vector ones from rh_simd.h
+#define RH_VEC_BATCH_IMPL(TYPE)							\
+	RH_SIMD_SPAN_SCALAR(TYPE, _##TYPE)					\
+	RH_IMPL_SIZED_VEC_BATCH(v2##TYPE##_batch, v2##TYPE, 2, TYPE);		\
+	RH_IMPL_SIZED_VEC_BATCH(v3##TYPE##_batch, v3##TYPE, 3, TYPE);		\
+	RH_IMPL_SIZED_VEC_BATCH(v4##TYPE##_batch, v4##TYPE, 4, TYPE);		\
+	RH_IMPL_SIZED_VEC_BATCH(q##TYPE##_batch, q##TYPE, 4, TYPE);		\
+	RH_IMPL_3_VEC_BATCH(v3##TYPE##_batch, 3, TYPE);				\
+	RH_IMPL_3_VEC_BATCH(v4##TYPE##_batch, 4, TYPE);				\
+	RH_IMPL_QUAT_BATCH(q##TYPE##_batch, v3##TYPE##_batch, TYPE);
+
 #define RH_VEC_DEF(TYPE)				\
 	typedef union {					\
 		TYPE array[2];				\
@@ -143,12 +514,31 @@ static inline NAME NAME##_cross(const NAME a, const NAME b) {			\
 			TYPE _;				\
 		};					\
 	} v4##TYPE;					\
+						\
+	typedef union {					\
+		TYPE array[4];				\
+		struct {				\
+			TYPE x;				\
+			TYPE y;				\
+			TYPE z;				\
+			TYPE w;				\
+		};					\
+		struct {				\
+			v3##TYPE vec3;		\
+			TYPE _;				\
+		};					\
+	} q##TYPE;								\
+						\
+	RH_VEC_BATCH_DEF(TYPE)
 
 #define RH_VEC_IMPL(TYPE)				\
 	RH_IMPL_SIZED_VEC(v2##TYPE, 2, TYPE);		\
 	RH_IMPL_SIZED_VEC(v3##TYPE, 3, TYPE);		\
 	RH_IMPL_SIZED_VEC(v4##TYPE, 4, TYPE);		\
-	RH_IMPL_3_VEC(v3##TYPE, TYPE);
+	RH_IMPL_3_VEC(v3##TYPE, TYPE);		\
+	RH_IMPL_4_VEC(v4##TYPE, TYPE);		\
+	RH_IMPL_QUAT(q##TYPE, v3##TYPE, TYPE);					\
+	RH_VEC_BATCH_IMPL(TYPE);
 
 #define RH_VEC_MAKE(TYPE)					\
 	RH_VEC_DEF(TYPE);					\
@@ -0,0 +1,185 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_vec.h"
+#include "rh_mat.h"
+#include "rh_bench.h"
+
+#include <stdint.h>
+
+RH_VEC_MAKE(float);
+RH_MAT_MAKE(float);
+RH_MAT_VEC_IMPL(float);
+
+// A point cloud well past the caches, so streaming throughput counts
+#define POINTS (1 << 20)
+#define ROUNDS 16
+
+static v3float pts[POINTS], other[POINTS], out[POINTS];
+static float dots[POINTS];
+
+static void report(const char *name, uint64_t start) {
+	rh_bench_report(name, (uint64_t) POINTS * ROUNDS, rh_bench_now() - start);
+}
+
+int main() {
+	uint64_t seed = 12;
+	for (size_t i = 0;i < POINTS;++i) {
+		for (int k = 0;k < 3;++k) {
+			pts[i].array[k] = (rh_bench_rand(&seed) >> 40) * 0x1p-20f - 8;
+			other[i].array[k] = (rh_bench_rand(&seed) >> 40) * 0x1p-20f - 8;
+		}
+	}
+	m4float m = {{
+		{0.8f, -0.6f, 0, 3},
+		{0.6f, 0.8f, 0, -2},
+		{0, 0, 1, 1},
+		{0, 0, 0, 1},
+	}};
+
+	v3float_batch a = v3float_batch_from(pts, POINTS);
+	v3float_batch b = v3float_batch_from(other, POINTS);
+	v3float_batch c = v3float_batch_new(POINTS);
+	float check = 0;
+	uint64_t start;
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		for (size_t i = 0;i < POINTS;++i) {
+			v4float p = {{pts[i].x, pts[i].y, pts[i].z, 1}};
+			out[i] = m4float_mul_vec(m, p).vec3;
+		}
+		check += out[r].x;
+	}
+	report("transform per vector", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		m4float_mul_v3float_batch(&c, m, &a);
+		check += c.x[r];
+	}
+	report("transform batch", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		for (size_t i = 0;i < POINTS;++i) {
+			out[i] = v3float_scale(v3float_add(pts[i], other[i]), 0.5f);
+		}
+		check += out[r].x;
+	}
+	report("add+scale per vector", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		v3float_batch_add(&c, &a, &b);
+		v3float_batch_scale(&c, &c, 0.5f);
+		check += c.x[r];
+	}
+	report("add+scale batch", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		for (size_t i = 0;i < POINTS;++i) {
+			dots[i] = v3float_dot(pts[i], other[i]);
+		}
+		check += dots[r];
+	}
+	report("dot per vector", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		v3float_batch_dot(dots, &a, &b);
+		check += dots[r];
+	}
+	report("dot batch", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		for (size_t i = 0;i < POINTS;++i) {
+			out[i] = v3float_cross(pts[i], other[i]);
+		}
+		check += out[r].x;
+	}
+	report("cross per vector", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		v3float_batch_cross(&c, &a, &b);
+		check += c.x[r];
+	}
+	report("cross batch", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		for (size_t i = 0;i < POINTS;++i) {
+			out[i] = v3float_norm(pts[i]);
+		}
+		check += out[r].x;
+	}
+	report("norm per vector", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		v3float_batch_norm(&c, &a);
+		check += c.x[r];
+	}
+	report("norm batch", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		v3float min = pts[0], max = pts[0];
+		for (size_t i = 1;i < POINTS;++i) {
+			for (int k = 0;k < 3;++k) {
+				min.array[k] = pts[i].array[k] < min.array[k]
+					? pts[i].array[k] : min.array[k];
+				max.array[k] = pts[i].array[k] > max.array[k]
+					? pts[i].array[k] : max.array[k];
+			}
+		}
+		check += min.x + max.y;
+	}
+	report("bounds per vector", start);
+
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		v3float min, max;
+		v3float_batch_bounds(&a, &min, &max);
+		check += min.x + max.y;
+	}
+	report("bounds batch", start);
+
+	// Converting in and out costs a pass each way
+	start = rh_bench_now();
+	for (int r = 0;r < ROUNDS;++r) {
+		v3float_batch_free(&c);
+		c = v3float_batch_from(pts, POINTS);
+		v3float_batch_to(&c, out);
+		check += out[r].x;
+	}
+	report("from+to batch", start);
+
+	rh_bench_use((uint64_t) check);
+	v3float_batch_free(&a);
+	v3float_batch_free(&b);
+	v3float_batch_free(&c);
+	return 0;
+}
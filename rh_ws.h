@@ -0,0 +1,175 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef RH_WS_H
+#define RH_WS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifndef RH_CACHE_LINE
+#define RH_CACHE_LINE 64
+#endif
+
+// Chase-Lev work stealing deque, using the C11 orderings of Le et al. (2013)
+// The owning thread pushes and pops at the bottom (LIFO) while any number of
+// other threads steal from the top (FIFO)
+// TYPE is held in _Atomic slots so should be a pointer or integer
+// The array doubles when full; old arrays may still be read by a stealer, so
+// they are kept and released with the deque
+#define RH_WS_DEQ_MAKE(NAME, TYPE)						\
+	RH_WS_DEQ_DEF(NAME, TYPE);						\
+	RH_WS_DEQ_IMPL(NAME, TYPE);
+
+#define RH_WS_DEQ_DEF(NAME, TYPE)						\
+typedef struct NAME##_array {							\
+	size_t size;								\
+	struct NAME##_array *prev;						\
+	_Atomic(TYPE) items[];							\
+} NAME##_array;									\
+										\
+typedef struct {								\
+	_Alignas(RH_CACHE_LINE) _Atomic int64_t top;				\
+	_Alignas(RH_CACHE_LINE) _Atomic int64_t bottom;				\
+	_Atomic(NAME##_array *) array;						\
+} NAME;										\
+
+#define RH_WS_DEQ_IMPL(NAME, TYPE)						\
+static inline NAME##_array *NAME##_array_new(size_t size) {			\
+	NAME##_array *a = malloc(sizeof(*a) + size * sizeof(a->items[0]));	\
+	if (a) {								\
+		a->size = size;							\
+		a->prev = NULL;							\
+	}									\
+	return a;								\
+}										\
+										\
+/* Size is rounded up to a power of two */					\
+static inline int NAME##_init(NAME *q, size_t size) {				\
+	size_t to = 2;								\
+	while (to < size) {							\
+		to <<= 1;							\
+	}									\
+										\
+	NAME##_array *a = NAME##_array_new(to);					\
+	if (!a) {								\
+		return 0;							\
+	}									\
+	atomic_init(&q->top, 0);						\
+	atomic_init(&q->bottom, 0);						\
+	atomic_init(&q->array, a);						\
+	return 1;								\
+}										\
+										\
+static inline void NAME##_free(NAME *q) {					\
+	NAME##_array *a = atomic_load(&q->array);				\
+	while (a) {								\
+		NAME##_array *prev = a->prev;					\
+		free(a);							\
+		a = prev;							\
+	}									\
+	atomic_store(&q->array, NULL);						\
+}										\
+										\
+/* Owner only */								\
+static inline int NAME##_push(NAME *q, TYPE push) {				\
+	int64_t b = atomic_load_explicit(&q->bottom, memory_order_relaxed);	\
+	int64_t t = atomic_load_explicit(&q->top, memory_order_acquire);	\
+	NAME##_array *a = atomic_load_explicit(&q->array, memory_order_relaxed);\
+										\
+	if (b - t > (int64_t) a->size - 1) {					\
+		NAME##_array *new = NAME##_array_new(a->size * 2);		\
+		if (!new) {							\
+			return 0;						\
+		}								\
+		for (int64_t i = t;i < b;++i) {					\
+			atomic_store_explicit(&new->items[i & (new->size - 1)],	\
+				atomic_load_explicit(&a->items[i & (a->size - 1)],\
+					memory_order_relaxed),			\
+				memory_order_relaxed);				\
+		}								\
+		new->prev = a;							\
+		atomic_store_explicit(&q->array, new, memory_order_release);	\
+		a = new;							\
+	}									\
+										\
+	atomic_store_explicit(&a->items[b & (a->size - 1)], push,		\
+			memory_order_relaxed);					\
+	atomic_store_explicit(&q->bottom, b + 1, memory_order_release);		\
+	return 1;								\
+}										\
+										\
+/* Owner only */								\
+static inline int NAME##_pop(NAME *q, TYPE *pop) {				\
+	int64_t b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;	\
+	NAME##_array *a = atomic_load_explicit(&q->array, memory_order_relaxed);\
+	atomic_store_explicit(&q->bottom, b, memory_order_relaxed);		\
+	atomic_thread_fence(memory_order_seq_cst);				\
+	int64_t t = atomic_load_explicit(&q->top, memory_order_relaxed);	\
+										\
+	if (t > b) {								\
+		atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);	\
+		return 0;							\
+	}									\
+										\
+	*pop = atomic_load_explicit(&a->items[b & (a->size - 1)],		\
+			memory_order_relaxed);					\
+	if (t == b) {								\
+		/* Last item, race the stealers for it */			\
+		int won = atomic_compare_exchange_strong_explicit(&q->top,	\
+				&t, t + 1, memory_order_seq_cst,		\
+				memory_order_relaxed);				\
+		atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);	\
+		return won;							\
+	}									\
+	return 1;								\
+}										\
+										\
+/* Any thread, fails if empty or if another thread won the race */		\
+static inline int NAME##_steal(NAME *q, TYPE *steal) {				\
+	int64_t t = atomic_load_explicit(&q->top, memory_order_acquire);	\
+	atomic_thread_fence(memory_order_seq_cst);				\
+	int64_t b = atomic_load_explicit(&q->bottom, memory_order_acquire);	\
+										\
+	if (t >= b) {								\
+		return 0;							\
+	}									\
+										\
+	NAME##_array *a = atomic_load_explicit(&q->array, memory_order_acquire);\
+	TYPE item = atomic_load_explicit(&a->items[t & (a->size - 1)],		\
+			memory_order_relaxed);					\
+	if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,	\
+			memory_order_seq_cst, memory_order_relaxed)) {		\
+		return 0;							\
+	}									\
+	*steal = item;								\
+	return 1;								\
+}										\
+										\
+/* Approximate unless called by the owner */					\
+static inline int NAME##_empty(NAME *q) {					\
+	return atomic_load_explicit(&q->bottom, memory_order_relaxed)		\
+		<= atomic_load_explicit(&q->top, memory_order_relaxed);		\
+}										\
+
+#endif
@@ -0,0 +1,156 @@
+/*******************************************************************************
+* Copyright 2017-2020 James RH Ellis
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal 
+* in the Software without restriction, including without limitation the rights 
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+* copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all 
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+* SOFTWARE.
+*******************************************************************************/
+
+#include "rh_ws.h"
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+
+RH_WS_DEQ_MAKE(test_deq, uint64_t);
+
+#define ERROR_MSG(MSG, ...) fprintf(stderr, MSG "\nAt line: %d\n", ##__VA_ARGS__, __LINE__)
+
+int order(void) {
+	test_deq q;
+	if (!test_deq_init(&q, 1)) {
+		ERROR_MSG("Init test FAILED!");
+		return 1;
+	}
+
+	// Grows from 2 several times
+	for (uint64_t i = 0;i < 20;++i) {
+		test_deq_push(&q, i);
+	}
+	uint64_t item = 0;
+	int errors = 0;
+	// The owner pops newest first, stealers take the oldest
+	for (uint64_t i = 0;i < 5;++i) {
+		errors += !test_deq_steal(&q, &item) || item != i;
+		errors += !test_deq_pop(&q, &item) || item != 19 - i;
+	}
+	for (uint64_t i = 14;i >= 5;--i) {
+		errors += !test_deq_pop(&q, &item) || item != i;
+	}
+	errors += !test_deq_empty(&q);
+	errors += test_deq_pop(&q, &item) + test_deq_steal(&q, &item);
+
+	// Still usable after emptying
+	test_deq_push(&q, 7);
+	errors += !test_deq_steal(&q, &item) || item != 7;
+	test_deq_free(&q);
+	if (errors) {
+		ERROR_MSG("Order test FAILED! %d errors", errors);
+		return 1;
+	}
+	return 0;
+}
+
+// The owner pushes every item, popping some back as it goes, while thieves
+// steal; each item must be taken exactly once
+#define THIEVES 3
+#define ITEMS (1 << 18)
+
+typedef struct {
+	test_deq q;
+	_Atomic unsigned char taken[ITEMS];
+	_Atomic int done;
+} shared;
+
+static void take(shared *s, uint64_t item) {
+	if (item < ITEMS) {
+		atomic_fetch_add(&s->taken[item], 1);
+	}
+}
+
+static void *thief(void *arg) {
+	shared *s = arg;
+	uint64_t item;
+	for (;;) {
+		if (test_deq_steal(&s->q, &item)) {
+			take(s, item);
+		} else if (atomic_load(&s->done) && test_deq_empty(&s->q)) {
+			break;
+		} else {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+int steal(void) {
+	static shared s;
+	// Small, to be grown while being stolen from
+	if (!test_deq_init(&s.q, 2)) {
+		ERROR_MSG("Steal init test FAILED!");
+		return 1;
+	}
+
+	pthread_t threads[THIEVES];
+	for (int i = 0;i < THIEVES;++i) {
+		pthread_create(&threads[i], NULL, thief, &s);
+	}
+
+	uint64_t item;
+	for (uint64_t i = 0;i < ITEMS;++i) {
+		test_deq_push(&s.q, i);
+		if (i % 3 == 2 && test_deq_pop(&s.q, &item)) {
+			take(&s, item);
+		}
+		// Let the thieves in even on a single CPU
+		if (!(i % 1024)) {
+			sched_yield();
+		}
+	}
+	while (!test_deq_empty(&s.q)) {
+		if (test_deq_pop(&s.q, &item)) {
+			take(&s, item);
+		}
+	}
+	atomic_store(&s.done, 1);
+	for (int i = 0;i < THIEVES;++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	size_t wrong = 0;
+	for (size_t i = 0;i < ITEMS;++i) {
+		wrong += s.taken[i] != 1;
+	}
+	test_deq_free(&s.q);
+	if (wrong) {
+		ERROR_MSG("Steal test FAILED! %zu items not taken once", wrong);
+		return 1;
+	}
+	return 0;
+}
+
+int main() {
+	int no_errors = 0;
+
+	no_errors += order();
+	no_errors += steal();
+
+	if (no_errors) {
+		fprintf(stderr, "\n\n\tTotal number of TESTS FAILED: %d\n", no_errors);
+	}
+
+	return no_errors;
+}